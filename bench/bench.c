@@ -0,0 +1,312 @@
+// Benchmark harness: runs Scheme programs in each evaluation mode and prints
+// one line of tab-separated values per run (see usage below). Every run
+// happens in a child process of its own, so that runs don't share a heap and
+// the peak RSS reported is that of the run alone.
+//
+// A program may state the value of its last expression in a comment, e.g.
+// "; expect: 832040"; runs that evaluate to anything else are reported as
+// "wrong" rather than "ok".
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "inc/ast.h"
+#include "inc/env.h"
+#include "inc/eval.h"
+#include "inc/gc.h"
+#include "inc/reader.h"
+#include "inc/stdmacros.h"
+#include "inc/symbols.h"
+
+#define DEFAULT_INIT_PATH "scminit.scm"
+#define EXPECT_TAG "; expect:"
+
+static const struct {
+  const char *name;
+  enum eval_mode mode;
+} modes[] = {
+  { "ast", EVAL_MODE_AST },
+  { "bytecode", EVAL_MODE_BYTECODE },
+  { "analyze", EVAL_MODE_ANALYZE },
+  { "stack", EVAL_MODE_STACK },
+};
+#define NMODES (sizeof(modes) / sizeof(modes[0]))
+
+// What a child process sends back to the harness through a pipe.
+struct bench_result {
+  int err;			// From reading or evaluating the program
+  bool is_int;			// Whether the last value is an integer
+  int32_t value;		// The last value, if it is an integer
+  double wall_ms;		// Time spent evaluating the program
+  size_t nallocs;		// Objects allocated by the program
+  size_t ncollections;		// Collections run during the program
+  size_t heap_size;		// Bytes reserved for the heap at the end
+};
+
+// Reader
+
+// Reads every datum of the file at `path` into a list, which can't be empty.
+static int read_program(const char *path, struct astnode **ret)
+{
+  struct reader reader;
+  struct astnode **tail;
+  int err;
+
+  RETONERR(reader_open(&reader, path));
+  *ret = (struct astnode *) EMPTY_LIST;
+  tail = ret;
+  for (;;)
+    {
+      struct astnode_pair *pair;
+
+      err = alloc_astnode(TYPE_PAIR, (struct astnode **) &pair);
+      if (err != 0)
+	break;
+      pair->cdr = (struct astnode *) EMPTY_LIST;
+      err = reader_next(&reader, &pair->car);
+      if (err != 0 || pair->car == NULL)
+	break;
+      *tail = (struct astnode *) pair;
+      tail = &pair->cdr;
+    }
+  reader_close(&reader);
+  if (err == 0 && is_empty_list(*ret))
+    err = EBADMSG;
+
+  return err;
+}
+
+// Runner
+
+static double now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Runs the program at `path` in a new top-level environment, after the init
+// file at `init_path` (unless it is NULL). Only the evaluation of the program
+// itself is measured.
+static void run(const char *path, const char *init_path,
+		struct bench_result *result)
+{
+  struct astnode_env *env;
+  struct astnode *forms;
+  struct astnode *value;
+  struct gc_stats before;
+  struct gc_stats after;
+  double start;
+
+  memset(result, 0, sizeof(*result));
+
+  result->err = make_top_level_env(&env);
+  if (result->err == 0 && init_path != NULL)
+    {
+      result->err = read_program(init_path, &forms);
+      if (result->err == 0)
+	result->err = eval_many((struct astnode_pair *) forms, env, &value);
+    }
+  if (result->err == 0)
+    result->err = read_program(path, &forms);
+  if (result->err != 0)
+    return;
+
+  gc_get_stats(&before);
+  start = now_ms();
+  result->err = eval_many((struct astnode_pair *) forms, env, &value);
+  result->wall_ms = now_ms() - start;
+  gc_get_stats(&after);
+
+  result->nallocs = after.nallocs - before.nallocs;
+  result->ncollections = after.ncollections - before.ncollections;
+  result->heap_size = after.heap_size;
+  if (result->err == 0 && is_fixnum(value))
+    {
+      result->is_int = true;
+      result->value = fixnum_val(value);
+    }
+}
+
+// Returns true if the program at `path` states the value it should evaluate
+// to, and places it in `expected`.
+static bool read_expected(const char *path, int32_t *expected)
+{
+  char line[256];
+  FILE *file;
+  bool found;
+
+  file = fopen(path, "r");
+  if (file == NULL)
+    return false;
+
+  found = false;
+  while (!found && fgets(line, sizeof(line), file) != NULL)
+    {
+      if (strncmp(line, EXPECT_TAG, strlen(EXPECT_TAG)) == 0)
+	{
+	  *expected = strtol(line + strlen(EXPECT_TAG), NULL, 10);
+	  found = true;
+	}
+    }
+
+  fclose(file);
+  return found;
+}
+
+// Name of the benchmark: the base name of `path`, without its extension.
+static void bench_name(const char *path, char *name, size_t size)
+{
+  const char *base;
+  char *dot;
+
+  base = strrchr(path, '/');
+  base = base == NULL ? path : base + 1;
+  snprintf(name, size, "%s", base);
+  dot = strrchr(name, '.');
+  if (dot != NULL && dot != name)
+    *dot = '\0';
+}
+
+// Runs the program at `path` in a child process, and prints its line.
+static void bench(const char *path, const char *init_path, size_t mode,
+		  unsigned iter)
+{
+  struct bench_result result;
+  struct rusage usage;
+  char name[PATH_MAX];
+  const char *status;
+  char errbuf[32];
+  int32_t expected;
+  int fds[2];
+  pid_t pid;
+  int wstatus;
+  ssize_t nread;
+
+  bench_name(path, name, sizeof(name));
+  fflush(stdout);
+
+  if (pipe(fds) != 0 || (pid = fork()) < 0)
+    {
+      perror("bench");
+      exit(EXIT_FAILURE);
+    }
+  if (pid == 0)
+    {
+      close(fds[0]);
+      eval_mode = modes[mode].mode;
+      run(path, init_path, &result);
+      if (write(fds[1], &result, sizeof(result)) != sizeof(result))
+	_exit(EXIT_FAILURE);
+      _exit(EXIT_SUCCESS);
+    }
+
+  close(fds[1]);
+  nread = read(fds[0], &result, sizeof(result));
+  close(fds[0]);
+  memset(&usage, 0, sizeof(usage));
+  while (wait4(pid, &wstatus, 0, &usage) < 0 && errno == EINTR)
+    ;
+
+  if (nread != sizeof(result))
+    {
+      status = "crash";
+      memset(&result, 0, sizeof(result));
+    }
+  else if (result.err != 0)
+    {
+      snprintf(errbuf, sizeof(errbuf), "error:%d", result.err);
+      status = errbuf;
+    }
+  else if (read_expected(path, &expected) &&
+	   (!result.is_int || result.value != expected))
+    status = "wrong";
+  else
+    status = "ok";
+
+  // ru_maxrss is in KiB on Linux
+  printf("%s\t%s\t%u\t%s\t%.3f\t%zu\t%zu\t%zu\t%ld\n", name,
+	 modes[mode].name, iter, status, result.wall_ms, result.nallocs,
+	 result.ncollections, result.heap_size >> 10, usage.ru_maxrss);
+}
+
+static void usage(const char *argv0)
+{
+  fprintf(stderr,
+	  "Usage: %s [-i init_file_path | -I]"
+	  " [-m ast|bytecode|analyze|stack]... [-r runs] file.scm...\n"
+	  "Prints, for each file, mode and run:\n"
+	  "bench mode run status wall_ms allocs collections heap_kib"
+	  " peak_rss_kib\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+  const char *init_path = DEFAULT_INIT_PATH;
+  bool selected[NMODES] = { false };
+  bool any_selected = false;
+  unsigned runs = 1;
+  unsigned iter;
+  size_t mode;
+  int opt;
+  int i;
+
+  while ((opt = getopt(argc, argv, "i:Im:r:")) != -1)
+    {
+      switch (opt)
+	{
+	case 'i':
+	  init_path = optarg;
+	  break;
+	case 'I':
+	  init_path = NULL;
+	  break;
+	case 'm':
+	  for (mode = 0; mode < NMODES; mode++)
+	    if (strcmp(modes[mode].name, optarg) == 0)
+	      break;
+	  if (mode == NMODES)
+	    {
+	      fprintf(stderr, "Unknown evaluation mode: %s\n", optarg);
+	      return EINVAL;
+	    }
+	  selected[mode] = true;
+	  any_selected = true;
+	  break;
+	case 'r':
+	  runs = strtoul(optarg, NULL, 10);
+	  break;
+	default:
+	  usage(argv[0]);
+	  return EINVAL;
+	}
+    }
+  if (optind == argc)
+    {
+      usage(argv[0]);
+      return EINVAL;
+    }
+
+  printf("bench\tmode\trun\tstatus\twall_ms\tallocs\tcollections\theap_kib"
+	 "\tpeak_rss_kib\n");
+  for (i = optind; i < argc; i++)
+    for (mode = 0; mode < NMODES; mode++)
+      {
+	if (any_selected && !selected[mode])
+	  continue;
+	for (iter = 1; iter <= runs; iter++)
+	  bench(argv[i], init_path, mode, iter);
+      }
+
+  return 0;
+}
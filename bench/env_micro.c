@@ -0,0 +1,213 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench/micro.h"
+#include "inc/env.h"
+#include "inc/gc.h"
+#include "inc/stdmacros.h"
+#include "inc/symbols.h"
+
+// The top-level environment of every size: making one per size would leave
+// them all alive, as roots.
+static struct astnode_env *top_env;
+
+static int get_top_env(struct astnode_env **ret)
+{
+  if (top_env == NULL)
+    RETONERR(make_top_level_env(&top_env));
+
+  *ret = top_env;
+  return 0;
+}
+
+// Makes `n` distinct symbol nodes var0 to var<n - 1>, as a list (whose
+// elements can also be read through `*syms`, to be freed). The list must be
+// kept alive by the caller.
+static int make_symbols(uint32_t n, struct astnode_pair **list,
+			struct astnode_sym ***syms)
+{
+  struct astnode **tail;
+  char name[24];
+  uint32_t i;
+  int len;
+
+  *syms = malloc((size_t) n * sizeof(**syms));
+  if (*syms == NULL)
+    return ENOMEM;
+
+  *list = EMPTY_LIST;
+  tail = (struct astnode **) list;
+  for (i = 0; i < n; i++)
+    {
+      struct astnode_pair *pair;
+      int err;
+
+      err = alloc_astnode(TYPE_PAIR, (struct astnode **) &pair);
+      if (err == 0)
+	{
+	  pair->cdr = (struct astnode *) EMPTY_LIST;
+	  *tail = (struct astnode *) pair;
+	  tail = &pair->cdr;
+	  err = alloc_astnode(TYPE_SYM, &pair->car);
+	}
+      if (err == 0)
+	{
+	  (*syms)[i] = (struct astnode_sym *) pair->car;
+	  len = snprintf(name, sizeof(name), "var%u", i);
+	  err = putsym(name, name + len - 1, &(*syms)[i]->symi);
+	}
+      if (err != 0)
+	{
+	  free(*syms);
+	  return err;
+	}
+    }
+
+  return 0;
+}
+
+// Defines var0 to var<size - 1> in the top-level environment.
+static int make_globals(uint32_t size, struct astnode_env **env,
+			struct astnode_sym ***syms)
+{
+  struct astnode_pair *list;
+  uint32_t i;
+
+  RETONERR(get_top_env(env));
+  RETONERR(make_symbols(size, &list, syms));
+  RETONERR(micro_keep((struct astnode *) list));
+  for (i = 0; i < size; i++)
+    RETONERR(define_binding(*env, (*syms)[i], make_fixnum(i)));
+
+  return 0;
+}
+
+// lookup_env of a global, with `size` globals defined
+static int lookup_global_any(struct micro_timer *timer, uint32_t size)
+{
+  uint32_t indices[MICRO_NINDICES];
+  struct astnode_sym **syms;
+  struct astnode_env *env;
+  struct astnode *val;
+  uint64_t n;
+  uint64_t i;
+  int err;
+
+  RETONERR(make_globals(size, &env, &syms));
+  micro_indices(indices, size);
+
+  for (err = 0; err == 0 && (n = micro_batch(timer)) > 0; )
+    for (i = 0; err == 0 && i < n; i++)
+      err = lookup_env(env, syms[indices[i % MICRO_NINDICES]], &val);
+
+  free(syms);
+  return err;
+}
+
+// define_binding of an existing global, with `size` globals defined
+static int define_global(struct micro_timer *timer, uint32_t size)
+{
+  uint32_t indices[MICRO_NINDICES];
+  struct astnode_sym **syms;
+  struct astnode_env *env;
+  uint64_t n;
+  uint64_t i;
+  int err;
+
+  RETONERR(make_globals(size, &env, &syms));
+  micro_indices(indices, size);
+
+  for (err = 0; err == 0 && (n = micro_batch(timer)) > 0; )
+    for (i = 0; err == 0 && i < n; i++)
+      err = define_binding(env, syms[indices[i % MICRO_NINDICES]],
+			   make_fixnum(i));
+
+  free(syms);
+  return err;
+}
+
+// Makes a list of `size` parameters, for frames over the top-level
+// environment.
+static int make_params(uint32_t size, struct astnode_env **top,
+		       struct astnode_pair **params, struct astnode_sym ***syms)
+{
+  RETONERR(get_top_env(top));
+  RETONERR(make_symbols(size, params, syms));
+
+  return micro_keep((struct astnode *) *params);
+}
+
+// lookup_env of a parameter, in a frame of `size` parameters. Parameters are
+// found by name in the frame, so the cost grows with the frame; the lexical
+// addressing pass keeps procedure bodies from looking them up this way.
+static int lookup_param(struct micro_timer *timer, uint32_t size)
+{
+  uint32_t indices[MICRO_NINDICES];
+  struct astnode_sym **syms;
+  struct astnode_pair *params;
+  struct astnode_env *top;
+  struct astnode_env *frame;
+  struct astnode **args;
+  struct astnode *val;
+  uint64_t n;
+  uint64_t i;
+  int err;
+
+  RETONERR(make_params(size, &top, &params, &syms));
+  args = calloc(size, sizeof(*args));
+  err = args == NULL ? ENOMEM : 0;
+  if (err == 0)
+    err = extend_env_array(top, params, args, size, &frame);
+  if (err == 0)
+    err = micro_keep((struct astnode *) frame);
+  free(args);
+  micro_indices(indices, size);
+
+  for ( ; err == 0 && (n = micro_batch(timer)) > 0; )
+    for (i = 0; err == 0 && i < n; i++)
+      err = lookup_env(frame, syms[indices[i % MICRO_NINDICES]], &val);
+
+  free(syms);
+  return err;
+}
+
+// extend_env_array with `size` arguments: allocates and fills a frame of
+// `size` slots.
+static int extend_frame(struct micro_timer *timer, uint32_t size)
+{
+  struct astnode_sym **syms;
+  struct astnode_pair *params;
+  struct astnode_env *top;
+  struct astnode_env *frame;
+  struct astnode **args;
+  uint64_t n;
+  uint64_t i;
+  int err;
+
+  RETONERR(make_params(size, &top, &params, &syms));
+  free(syms);
+  args = calloc(size, sizeof(*args));
+  if (args == NULL)
+    return ENOMEM;
+  for (i = 0; i < size; i++)
+    args[i] = make_fixnum(i);
+
+  for (err = 0; err == 0 && (n = micro_batch(timer)) > 0; )
+    for (i = 0; err == 0 && i < n; i++)
+      err = extend_env_array(top, params, args, size, &frame);
+
+  free(args);
+  return err;
+}
+
+static const struct micro_bench benches[] = {
+  { "lookup_global", 0, lookup_global_any },
+  { "define_global", 0, define_global },
+  { "lookup_param", 4096, lookup_param },
+  { "extend_env", 4096, extend_frame },
+};
+
+const struct micro_suite env_micro_suite = {
+  "env", benches, sizeof(benches) / sizeof(benches[0])
+};
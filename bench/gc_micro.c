@@ -0,0 +1,75 @@
+#include <errno.h>
+
+#include "bench/micro.h"
+#include "inc/gc.h"
+#include "inc/stdmacros.h"
+
+// Keeps a list of `size` pairs alive, so that collections have that many
+// objects to mark.
+static int keep_live_pairs(uint32_t size)
+{
+  struct astnode_pair *holder;
+  uint32_t i;
+
+  // The list hangs from the car of `holder`
+  RETONERR(alloc_astnode(TYPE_PAIR, (struct astnode **) &holder));
+  holder->car = (struct astnode *) EMPTY_LIST;
+  holder->cdr = (struct astnode *) EMPTY_LIST;
+  RETONERR(micro_keep((struct astnode *) holder));
+  for (i = 0; i < size; i++)
+    {
+      struct astnode_pair *pair;
+
+      RETONERR(alloc_astnode(TYPE_PAIR, (struct astnode **) &pair));
+      pair->car = make_fixnum(i);
+      pair->cdr = holder->car;
+      holder->car = (struct astnode *) pair;
+    }
+
+  return 0;
+}
+
+// alloc_astnode of a pair, with `size` pairs alive: includes the collections
+// the allocations trigger.
+static int alloc_pair(struct micro_timer *timer, uint32_t size)
+{
+  struct astnode *pair;
+  uint64_t n;
+  uint64_t i;
+  int err;
+
+  RETONERR(keep_live_pairs(size));
+
+  for (err = 0; err == 0 && (n = micro_batch(timer)) > 0; )
+    for (i = 0; err == 0 && i < n; i++)
+      err = alloc_astnode(TYPE_PAIR, &pair);
+
+  return err;
+}
+
+// alloc_astnode_sized of a 4-slot frame, with `size` pairs alive
+static int alloc_frame(struct micro_timer *timer, uint32_t size)
+{
+  struct astnode *frame;
+  uint64_t n;
+  uint64_t i;
+  int err;
+
+  RETONERR(keep_live_pairs(size));
+
+  for (err = 0; err == 0 && (n = micro_batch(timer)) > 0; )
+    for (i = 0; err == 0 && i < n; i++)
+      err = alloc_astnode_sized(TYPE_ENV, sizeof(struct astnode_env) +
+				4 * sizeof(struct astnode *), &frame);
+
+  return err;
+}
+
+static const struct micro_bench benches[] = {
+  { "alloc_pair", 0, alloc_pair },
+  { "alloc_frame", 0, alloc_frame },
+};
+
+const struct micro_suite gc_micro_suite = {
+  "gc", benches, sizeof(benches) / sizeof(benches[0])
+};
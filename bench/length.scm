@@ -0,0 +1,16 @@
+; Calls `length` from scminit.scm on a list of 10000 elements: non-tail
+; recursion 10000 calls deep.
+; expect: 1000000
+(define (build n l)
+  (if (= n 0)
+      l
+      (build (- n 1) (cons n l))))
+
+(define l (build 10000 ()))
+
+(define (loop i acc)
+  (if (= i 0)
+      acc
+      (loop (- i 1) (+ acc (length l)))))
+
+(loop 100 0)
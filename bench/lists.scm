@@ -0,0 +1,18 @@
+; Builds and reverses lists of 10000 elements: allocation and collection.
+; expect: 10000
+(define (build n l)
+  (if (= n 0)
+      l
+      (build (- n 1) (cons n l))))
+
+(define (rev l acc)
+  (if (eq? l ())
+      acc
+      (rev (cdr l) (cons (car l) acc))))
+
+(define (loop i r)
+  (if (= i 0)
+      r
+      (loop (- i 1) (car (rev (build 10000 ()) ())))))
+
+(loop 100 0)
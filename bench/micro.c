@@ -0,0 +1,242 @@
+// Runs the microbenchmarks of every suite below at growing sizes, and prints
+// one line of tab-separated values per benchmark and size: suite, benchmark,
+// size, operations timed, ns per operation, and ns per operation relative to
+// the smallest size (the scale curve: it stays near 1 for operations whose
+// cost doesn't depend on the size).
+//
+// Each benchmark runs in a child process of its own, so that it starts from an
+// empty symbol table and heap whatever ran before it. Its sizes run in
+// increasing order in that process: what a benchmark sets up for a size (e.g.
+// interned symbols) is still there for the next ones.
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench/micro.h"
+#include "inc/gc.h"
+#include "inc/stdmacros.h"
+
+extern const struct micro_suite symbols_micro_suite;
+extern const struct micro_suite env_micro_suite;
+extern const struct micro_suite gc_micro_suite;
+
+static const struct micro_suite *const suites[] = {
+  &symbols_micro_suite,
+  &env_micro_suite,
+  &gc_micro_suite,
+};
+#define NSUITES (sizeof(suites) / sizeof(suites[0]))
+
+#define MIN_SIZE 16
+#define SIZE_FACTOR 4
+#define DEFAULT_MAX_SIZE 262144
+#define DEFAULT_MIN_MS 50
+
+#define MAX_KEPT 16
+
+static struct astnode *kept[MAX_KEPT];
+static size_t nkept;
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+uint64_t micro_batch(struct micro_timer *timer)
+{
+  uint64_t now;
+
+  now = now_ns();
+  if (timer->batch == 0)
+    {
+      timer->start_ns = now;
+      timer->batch = 1;
+      return timer->batch;
+    }
+
+  timer->ops += timer->batch;
+  timer->elapsed_ns = now - timer->start_ns;
+  if (timer->elapsed_ns >= timer->min_ns ||
+      (timer->max_ops != 0 && timer->ops >= timer->max_ops))
+    return 0;
+
+  // Reading the clock every few operations would cost more than they do
+  timer->batch *= 2;
+  if (timer->max_ops != 0 && timer->batch > timer->max_ops - timer->ops)
+    timer->batch = timer->max_ops - timer->ops;
+
+  return timer->batch;
+}
+
+void micro_indices(uint32_t *indices, uint32_t size)
+{
+  uint32_t x = 2463534242u;	// xorshift32
+  uint32_t i;
+
+  for (i = 0; i < MICRO_NINDICES; i++)
+    {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      indices[i] = x % size;
+    }
+}
+
+int micro_keep(struct astnode *node)
+{
+  static struct astnode **roots;
+
+  if (roots == NULL)
+    {
+      roots = kept;
+      RETONERR(gc_add_root_array(&roots, &nkept));
+    }
+  if (nkept == MAX_KEPT)
+    return ENOMEM;
+
+  kept[nkept++] = node;
+  return 0;
+}
+
+// Whether the benchmark `bench` of `suite` was selected by the `nfilters`
+// arguments: "suite" or "suite/bench" (all benchmarks without arguments).
+static bool is_selected(const struct micro_suite *suite,
+			const struct micro_bench *bench, char **filters,
+			int nfilters)
+{
+  size_t len;
+  int i;
+
+  if (nfilters == 0)
+    return true;
+
+  len = strlen(suite->name);
+  for (i = 0; i < nfilters; i++)
+    {
+      if (strncmp(filters[i], suite->name, len) != 0)
+	continue;
+      if (filters[i][len] == '\0' ||
+	  (filters[i][len] == '/' && strcmp(filters[i] + len + 1,
+					    bench->name) == 0))
+	return true;
+    }
+
+  return false;
+}
+
+static int run_sizes(const struct micro_suite *suite,
+		     const struct micro_bench *bench, uint32_t max_size,
+		     uint64_t min_ns)
+{
+  struct micro_timer timer;
+  double base_ns_per_op;
+  double ns_per_op;
+  uint64_t size;
+  int err;
+
+  if (bench->max_size != 0 && bench->max_size < max_size)
+    max_size = bench->max_size;
+
+  base_ns_per_op = 0;
+  for (size = MIN_SIZE; size <= max_size; size *= SIZE_FACTOR)
+    {
+      memset(&timer, 0, sizeof(timer));
+      timer.min_ns = min_ns;
+      err = bench->run(&timer, size);
+      nkept = 0;
+      if (err != 0)
+	{
+	  fprintf(stderr, "%s/%s failed at size %lu: %s\n", suite->name,
+		  bench->name, (unsigned long) size, strerror(err));
+	  return err;
+	}
+
+      ns_per_op = timer.ops == 0 ? 0 : (double) timer.elapsed_ns / timer.ops;
+      if (base_ns_per_op == 0)
+	base_ns_per_op = ns_per_op;
+      printf("%s\t%s\t%lu\t%lu\t%.2f\t%.2f\n", suite->name, bench->name,
+	     (unsigned long) size, (unsigned long) timer.ops, ns_per_op,
+	     base_ns_per_op == 0 ? 0 : ns_per_op / base_ns_per_op);
+      fflush(stdout);
+    }
+
+  return 0;
+}
+
+// Runs `bench` in a child process. Returns false if it failed.
+static bool run_bench(const struct micro_suite *suite,
+		      const struct micro_bench *bench, uint32_t max_size,
+		      uint64_t min_ns)
+{
+  pid_t pid;
+  int status;
+
+  fflush(stdout);
+  pid = fork();
+  if (pid < 0)
+    {
+      perror("fork");
+      return false;
+    }
+  if (pid == 0)
+    _exit(run_sizes(suite, bench, max_size, min_ns) == 0 ?
+	  EXIT_SUCCESS : EXIT_FAILURE);
+
+  while (waitpid(pid, &status, 0) < 0)
+    {
+      if (errno != EINTR)
+	return false;
+    }
+
+  return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t max_size = DEFAULT_MAX_SIZE;
+  uint64_t min_ns = DEFAULT_MIN_MS * 1000000ul;
+  size_t i;
+  uint32_t j;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:t:")) != -1)
+    {
+      switch (opt)
+	{
+	case 'n':
+	  max_size = strtoul(optarg, NULL, 10);
+	  break;
+	case 't':
+	  min_ns = strtoull(optarg, NULL, 10) * 1000000ul;
+	  break;
+	default:
+	  fprintf(stderr,
+		  "Usage: %s [-n max_size] [-t min_ms_per_size]"
+		  " [suite[/bench]]...\n", argv[0]);
+	  return EINVAL;
+	}
+    }
+
+  printf("suite\tbench\tsize\tops\tns_per_op\tvs_smallest\n");
+  for (i = 0; i < NSUITES; i++)
+    for (j = 0; j < suites[i]->nbenches; j++)
+      {
+	if (!is_selected(suites[i], &suites[i]->benches[j], argv + optind,
+			 argc - optind))
+	  continue;
+	if (!run_bench(suites[i], &suites[i]->benches[j], max_size, min_ns))
+	  return EXIT_FAILURE;
+      }
+
+  return 0;
+}
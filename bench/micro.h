@@ -0,0 +1,59 @@
+#ifndef MICRO_H
+#define MICRO_H
+
+#include <stdint.h>
+
+#include "inc/ast.h"
+
+// C-level microbenchmarks of the interpreter's internals. Like the test suites
+// in tests/, benchmarks are grouped in one suite per module, each defined in a
+// bench/<module>_micro.c file and registered in bench/micro.c.
+
+// Decides how many operations a benchmark times: see micro_batch.
+struct micro_timer {
+  uint64_t min_ns;		// Stop once this much time has elapsed...
+  uint64_t max_ops;		// ... or this many operations ran (0: no limit)
+  uint64_t ops;			// Operations timed so far
+  uint64_t batch;		// Operations in the current batch
+  uint64_t start_ns;
+  uint64_t elapsed_ns;
+};
+
+// A benchmark sets up a structure of `size` elements (symbols, bindings, live
+// objects...), then times operations on it:
+//
+//   while ((n = micro_batch(timer)) > 0)
+//     for (i = 0; i < n; i++)
+//       <one operation>
+//
+// Possible errors: any error from the operations, which stops the suite.
+struct micro_bench {
+  const char *name;
+  uint32_t max_size;		// Largest size it runs at (0: no limit)
+  int (*run)(struct micro_timer *timer, uint32_t size);
+};
+
+struct micro_suite {
+  const char *name;
+  const struct micro_bench *benches;
+  uint32_t nbenches;
+};
+
+// Returns the number of operations to run next, or 0 once enough ran. The
+// clock starts at the first call.
+uint64_t micro_batch(struct micro_timer *timer);
+
+// Number of random indices micro_indices returns; index `i` of a loop should
+// use indices[i % MICRO_NINDICES].
+#define MICRO_NINDICES 4096
+
+// Fills `indices` with MICRO_NINDICES pseudo-random values below `size`, the
+// same ones for the same size.
+void micro_indices(uint32_t *indices, uint32_t size);
+
+// Keeps `node` alive until the current benchmark returns.
+// Possible errors:
+// + ENOMEM: Too many nodes are kept already.
+int micro_keep(struct astnode *node);
+
+#endif
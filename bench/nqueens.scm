@@ -0,0 +1,36 @@
+; Number of solutions of the 8 queens problem: list allocation and
+; many short-lived environment frames.
+; expect: 92
+(define (iota1 n)
+  (define (loop i l)
+    (if (= i 0)
+        l
+        (loop (- i 1) (cons i l))))
+  (loop n ()))
+
+(define (append2 a b)
+  (if (eq? a ())
+      b
+      (cons (car a) (append2 (cdr a) b))))
+
+(define (ok? row dist placed)
+  (if (eq? placed ())
+      #t
+      (if (= (car placed) (+ row dist))
+          #f
+          (if (= (car placed) (- row dist))
+              #f
+              (ok? row (+ dist 1) (cdr placed))))))
+
+(define (try x y z)
+  (if (eq? x ())
+      (if (eq? y ()) 1 0)
+      (+ (if (ok? (car x) 1 z)
+             (try (append2 (cdr x) y) () (cons (car x) z))
+             0)
+         (try (cdr x) (cons (car x) y) z))))
+
+(define (queens n)
+  (try (iota1 n) () ()))
+
+(queens 8)
@@ -0,0 +1,134 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench/micro.h"
+#include "inc/stdmacros.h"
+#include "inc/symbols.h"
+
+#define NAME_SIZE 24
+
+// Formats the names of symbols `prefix`0 to `prefix`<n - 1> in a buffer of n
+// NAME_SIZE-byte entries, which must be freed, and places their lengths in
+// `*lens` (also to be freed).
+static int make_names(const char *prefix, uint32_t n, char **names,
+		      size_t **lens)
+{
+  uint32_t i;
+
+  *names = malloc((size_t) n * NAME_SIZE);
+  *lens = malloc((size_t) n * sizeof(**lens));
+  if (*names == NULL || *lens == NULL)
+    {
+      free(*names);
+      free(*lens);
+      return ENOMEM;
+    }
+
+  for (i = 0; i < n; i++)
+    (*lens)[i] = snprintf(*names + (size_t) i * NAME_SIZE, NAME_SIZE, "%s%u",
+			  prefix, i);
+
+  return 0;
+}
+
+// Interns symbols sym0 to sym<size - 1>, so that the table holds at least
+// `size` symbols.
+static int intern_names(uint32_t size)
+{
+  size_t *lens;
+  char *names;
+  uint32_t i;
+  int err;
+
+  RETONERR(make_names("sym", size, &names, &lens));
+  for (err = 0, i = 0; err == 0 && i < size; i++)
+    err = putsym(names + (size_t) i * NAME_SIZE,
+		 names + (size_t) i * NAME_SIZE + lens[i] - 1, NULL);
+
+  free(names);
+  free(lens);
+  return err;
+}
+
+// putsym of a symbol already in a table of `size` symbols
+static int putsym_hit(struct micro_timer *timer, uint32_t size)
+{
+  uint32_t indices[MICRO_NINDICES];
+  char names[MICRO_NINDICES][NAME_SIZE];
+  size_t lens[MICRO_NINDICES];
+  uint32_t index;
+  uint64_t n;
+  uint64_t i;
+
+  RETONERR(intern_names(size));
+  micro_indices(indices, size);
+  for (i = 0; i < MICRO_NINDICES; i++)
+    lens[i] = snprintf(names[i], NAME_SIZE, "sym%u", indices[i]);
+
+  while ((n = micro_batch(timer)) > 0)
+    for (i = 0; i < n; i++)
+      {
+	uint32_t k = i % MICRO_NINDICES;
+
+	RETONERR(putsym(names[k], names[k] + lens[k] - 1, &index));
+      }
+
+  return 0;
+}
+
+// putsym of `size` new symbols, one after the other: includes the growth of
+// the table.
+static int putsym_new(struct micro_timer *timer, uint32_t size)
+{
+  char prefix[NAME_SIZE];
+  size_t *lens;
+  char *names;
+  uint32_t index;
+  uint64_t done;
+  uint64_t n;
+  uint64_t i;
+  int err;
+
+  // Names no other run of the benchmark used
+  snprintf(prefix, sizeof(prefix), "new%u_", size);
+  RETONERR(make_names(prefix, size, &names, &lens));
+
+  timer->max_ops = size;
+  for (err = 0, done = 0; err == 0 && (n = micro_batch(timer)) > 0; )
+    for (i = 0; err == 0 && i < n; i++, done++)
+      err = putsym(names + done * NAME_SIZE,
+		   names + done * NAME_SIZE + lens[done] - 1, &index);
+
+  free(names);
+  free(lens);
+  return err;
+}
+
+// getsym in a table of at least `size` symbols
+static int getsym_any(struct micro_timer *timer, uint32_t size)
+{
+  uint32_t indices[MICRO_NINDICES];
+  const char *symval;
+  uint64_t n;
+  uint64_t i;
+
+  RETONERR(intern_names(size));
+  micro_indices(indices, size);
+
+  while ((n = micro_batch(timer)) > 0)
+    for (i = 0; i < n; i++)
+      RETONERR(getsym(indices[i % MICRO_NINDICES], &symval));
+
+  return 0;
+}
+
+static const struct micro_bench benches[] = {
+  { "putsym_hit", 0, putsym_hit },
+  { "putsym_new", 0, putsym_new },
+  { "getsym", 0, getsym_any },
+};
+
+const struct micro_suite symbols_micro_suite = {
+  "symbols", benches, sizeof(benches) / sizeof(benches[0])
+};
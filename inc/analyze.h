@@ -0,0 +1,44 @@
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include "inc/ast.h"
+
+// Analyzing evaluator, after the one in SICP section 4.1.7.
+//
+// In EVAL_MODE_ANALYZE, the body of a procedure created at top level is
+// analyzed once, when the procedure is created, into a tree of struct
+// astnode_exec: each expression becomes the C function that runs that kind of
+// expression, along with its already analyzed subexpressions. Keywords and the
+// syntax of special forms are dealt with during the analysis, so running the
+// body only does the work left for run time. The lambdas nested in the body are
+// analyzed along with it into templates: procedures without an environment,
+// which are copied when the lambda is evaluated.
+//
+// Tail calls between analyzed procedures don't recurse on the C stack: the node
+// in tail position is handed back to the loop that runs the body (see
+// exec_handler).
+
+// Analyzes the body of `proc` and stores the result in `proc->exec`. Must run
+// after resolve_lexaddrs.
+//
+// Does nothing unless eval_mode is EVAL_MODE_ANALYZE and `proc` was created in
+// the top-level environment. A body that can't be analyzed (e.g. malformed
+// special forms) is left as is, and is run by eval like in EVAL_MODE_AST; this
+// is not an error.
+// Possible errors:
+// + EINVAL: `proc` was NULL.
+// + ENOMEM: Failed to allocate the analyzed body.
+int analyze_proc(struct astnode_compproc *proc);
+
+// Applies the analyzed procedure `proc` to the `nargs` arguments starting at
+// `args`, which must already have been evaluated (see apply_args).
+// Possible errors:
+// + EINVAL: `proc` or `ret` was NULL, `args` was NULL while `nargs` isn't 0,
+// or `proc` was not analyzed.
+// + EBADMSG: Wrong number of arguments, or an error while running the body
+// (see eval).
+// + ENOMEM: Out of memory.
+int exec_apply(struct astnode_compproc *proc, struct astnode **args,
+	       uint32_t nargs, struct astnode **ret);
+
+#endif
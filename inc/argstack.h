@@ -0,0 +1,35 @@
+#ifndef ARGSTACK_H
+#define ARGSTACK_H
+
+#include <stddef.h>
+
+#include "inc/ast.h"
+
+// The argument stack. eval and the analyzing evaluator push the arguments of a
+// call on it as they evaluate them, and hand the procedure a pointer to the
+// first one along with their number, rather than a freshly allocated list.
+// Nested calls push above the arguments of the calls around them, so a caller
+// only has to remember the size of the stack before it started pushing, and
+// truncate the stack back to it when the call is done (or failed).
+//
+// The stack is a GC root. Pushing may move it: pointers returned by
+// argstack_from are only valid until the next push.
+
+// Pushes `val` on the stack.
+// Possible errors:
+// + ENOMEM: Failed to grow the stack.
+int argstack_push(struct astnode *val);
+
+// Returns the number of values on the stack.
+size_t argstack_size(void);
+
+// Returns a pointer to the value at index `base`, the first of the values
+// pushed since the stack had `base` values. May be NULL if nothing was pushed
+// since.
+struct astnode **argstack_from(size_t base);
+
+// Pops values until `size` values are left. `size` must not be larger than
+// the size of the stack.
+void argstack_truncate(size_t size);
+
+#endif
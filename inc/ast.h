@@ -1,13 +1,15 @@
 #ifndef AST_H
 #define AST_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
 #define ASTNODE_BASE astnode_type type
 
 // No strings for now.
-// Only one type of number for now: 32 bit signed int.
+// Only one type of number for now: 32 bit signed int, stored as a fixnum (see
+// below).
 typedef enum {
   TYPE_SYM = 0,
   TYPE_INT,
@@ -17,6 +19,12 @@ typedef enum {
   TYPE_KEYWORD,
   TYPE_PRMTPROC,
   TYPE_COMPPROC,
+  TYPE_LEXADDR,
+  TYPE_CODE,
+  TYPE_EXEC,
+  TYPE_CONT,
+  TYPE_VECTOR,
+  TYPE_NUMVECTOR,
   TYPE_MAX,
 } astnode_type;
 
@@ -26,13 +34,35 @@ struct astnode {
 
 struct astnode_sym {
   ASTNODE_BASE;
-  void *symi;
+  uint32_t symi;		// Index in the symbol table
 };
 
-struct astnode_int {
-  ASTNODE_BASE;
-  int32_t intval;
-};
+// Integers are never allocated: their value is stored directly in the pointer
+// word, shifted left by one, with the lowest bit set. Actual astnodes are at
+// least 8-byte aligned, so that bit is always clear in a pointer to an object.
+// Use astnode_type_of(node) rather than node->type whenever `node` may be an
+// integer.
+#define FIXNUM_TAG ((uintptr_t) 1)
+
+static inline bool is_fixnum(const struct astnode *node)
+{
+  return ((uintptr_t) node & FIXNUM_TAG) != 0;
+}
+
+static inline struct astnode *make_fixnum(int32_t val)
+{
+  return (struct astnode *) (((uintptr_t) (intptr_t) val << 1) | FIXNUM_TAG);
+}
+
+static inline int32_t fixnum_val(const struct astnode *node)
+{
+  return (int32_t) ((intptr_t) node >> 1);
+}
+
+static inline astnode_type astnode_type_of(const struct astnode *node)
+{
+  return is_fixnum(node) ? TYPE_INT : node->type;
+}
 
 // 1. #t and #f are NOT symbols, and evaluate to themselves
 // https://www.gnu.org/software/mit-scheme/documentation/mit-scheme-ref/Booleans.html
@@ -47,10 +77,25 @@ struct astnode_boolean {
 extern struct astnode_boolean _boolean_true;
 extern struct astnode_boolean _boolean_false;
 
+// There are only two booleans: the objects below. Booleans are never
+// allocated, so they can be compared by identity.
 #define BOOLEAN_TRUE  ((struct astnode_boolean *) &_boolean_true)
 #define BOOLEAN_FALSE ((struct astnode_boolean *) &_boolean_false)
 
+static inline struct astnode *make_boolean(bool val)
+{
+  return (struct astnode *) (val ? BOOLEAN_TRUE : BOOLEAN_FALSE);
+}
+
+// Only #f counts as false
+static inline bool is_false(const struct astnode *node)
+{
+  return node == (struct astnode *) BOOLEAN_FALSE;
+}
+
 // Functions should use is_empty_list(node) to check if a node is the empty list.
+// There is only one empty list, EMPTY_LIST; a pair whose car and cdr are NULL
+// is not the empty list.
 // Note: (pair? '()) must return false.
 struct astnode_pair {
   ASTNODE_BASE;
@@ -62,11 +107,28 @@ extern struct astnode_pair _empty_list;
 
 #define EMPTY_LIST &_empty_list
 
-// Example bindings: ((+ <proc>) (var <int>) ...)
+// The bindings of the top-level environment: values[i] is the value bound to
+// the symbol of index i (see inc/symbols.h), or NULL if it is unbound. Not
+// managed by the GC.
+struct env_globals {
+  uint32_t cap;
+  struct astnode *values[];
+};
+
+// An environment frame. The arguments of a procedure call are stored by
+// position in `slots`: slots[i] is the value of the ith symbol of `params`,
+// which is the parameter list of the procedure itself, not a copy. Bindings
+// made with define to names other than the parameters are kept in `bindings`,
+// e.g. ((+ <proc>) (var <int>) ...). The top-level environment has neither:
+// all its bindings are in `globals`, which is NULL in every other frame.
 struct astnode_env {
   ASTNODE_BASE;
+  uint32_t nslots;
   struct astnode_env *parent;
+  struct astnode_pair *params;
   struct astnode_pair *bindings;
+  struct env_globals *globals;
+  struct astnode *slots[];
 };
 
 typedef int (*kw_handler)(struct astnode_pair *args, struct astnode_env *env,
@@ -87,12 +149,17 @@ struct astnode_keyword {
   kw_handler handler;
 };
 
-// Must match signature of handlers in prmt_handlers.h
-typedef int (*prmt_handler)(struct astnode_pair *args, struct astnode **ret);
+// Must match signature of handlers in prmt_handlers.h. The arguments are the
+// `nargs` values starting at `args`, which may be NULL if there are none.
+typedef int (*prmt_handler)(struct astnode **args, uint32_t nargs,
+			    struct astnode **ret);
+
+// Describes a primitive procedure (see inc/prmt_handlers.h).
+struct prmt_desc;
 
 struct astnode_prmtproc {
   ASTNODE_BASE;
-  prmt_handler handler;
+  const struct prmt_desc *desc;
 };
 
 struct astnode_compproc {
@@ -100,8 +167,104 @@ struct astnode_compproc {
   struct astnode_pair *body;
   struct astnode_env *env;
   struct astnode_pair *params;
+  struct astnode_code *code;	// Compiled body, or NULL (see inc/vm.h)
+  struct astnode_exec *exec;	// Analyzed body, or NULL (see inc/analyze.h)
+};
+
+// A reference to a local variable whose position is known before the procedure
+// runs: the variable is in the `index`th slot of the frame `depth` frames up
+// from the current one. The lexical addressing pass (see inc/lexaddr.h)
+// replaces such symbols in procedure bodies with these nodes.
+struct astnode_lexaddr {
+  ASTNODE_BASE;
+  uint32_t depth;
+  uint32_t index;
+  struct astnode_sym *sym;	// The symbol that was resolved, for printing
 };
 
-bool is_empty_list(struct astnode *node);
+// The body of a compound procedure compiled to bytecode (see inc/vm.h). The
+// instructions are stored right after the constants they refer to; use
+// code_insns to get to them.
+struct astnode_code {
+  ASTNODE_BASE;
+  uint32_t nconsts;
+  uint32_t ninsns;
+  uint32_t max_stack;		// Stack slots the body needs at most
+  struct astnode *consts[];
+};
+
+static inline uint32_t *code_insns(struct astnode_code *code)
+{
+  return (uint32_t *) &code->consts[code->nconsts];
+}
+
+struct astnode_exec;
+
+// Runs `exec` in `*env`. Either places the value in `ret`, or places in `next`
+// the node whose value is the value of `exec` (a tail call), along with the
+// environment it must run in in `env`, for the caller to run it without
+// recursing.
+typedef int (*exec_handler)(struct astnode_exec *exec, struct astnode_env **env,
+			    struct astnode_exec **next, struct astnode **ret);
+
+// An expression analyzed ahead of time (see inc/analyze.h): the C function that
+// runs it, along with its operands (constants, symbols and subexpressions).
+struct astnode_exec {
+  ASTNODE_BASE;
+  uint32_t nops;
+  exec_handler handler;
+  struct astnode *ops[];
+};
+
+struct cont_escape;
+
+enum cont_state {
+  CONT_ACTIVE,			// Its call/cc has not returned
+  CONT_SAVED,			// Its frames were saved, to be re-entered
+  CONT_DEAD,			// It can't be called anymore
+};
+
+// A continuation captured by call/cc (see inc/cont.h). Calling it with a value
+// makes the call/cc return that value.
+struct astnode_cont {
+  ASTNODE_BASE;
+  enum cont_state state;
+  struct cont_escape *escape;	// Where control goes back to, while active
+  struct astnode_cont *prev;	// The next active continuation, while active
+  size_t height;		// Height of the control stack at the call/cc
+  struct astnode *frames;	// Saved control stack, bottom first, once saved
+};
+
+// A vector, whose `len` elements are stored right after the header. Long
+// vectors are large objects (see inc/gc.h).
+struct astnode_vector {
+  ASTNODE_BASE;
+  uint32_t len;
+  struct astnode *elts[];
+};
+
+enum numvec_kind {
+  NUMVEC_S32,			// int32_t elements
+  NUMVEC_S64,			// int64_t elements
+  NUMVEC_F64,			// double elements
+  NUMVEC_NKINDS,
+};
+
+// A homogeneous numeric vector (see inc/numvec.h): `len` unboxed elements of
+// the C type given by `kind`, stored in `data`.
+struct astnode_numvector {
+  ASTNODE_BASE;
+  enum numvec_kind kind;
+  uint32_t len;
+  _Alignas(8) unsigned char data[];
+};
+
+static inline bool is_empty_list(const struct astnode *node)
+{
+  return node == (struct astnode *) EMPTY_LIST;
+}
+
+// Returns the number of elements of `list`, or -1 if it isn't a proper list.
+int64_t list_length(struct astnode *list);
 
 #endif
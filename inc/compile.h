@@ -0,0 +1,20 @@
+#ifndef COMPILE_H
+#define COMPILE_H
+
+#include "inc/ast.h"
+
+// Bytecode compiler (see inc/vm.h). Compiles the body of `proc` and the bodies
+// of the lambdas nested in it, and stores the result in `proc->code`. Must run
+// after resolve_lexaddrs.
+//
+// Does nothing unless eval_mode is EVAL_MODE_BYTECODE and `proc` was created in
+// the top-level environment (the procedures nested in it are compiled along
+// with it). A body that can't be compiled (e.g. malformed special forms, or too
+// big for a code object) is left without code, and is run by eval like in
+// EVAL_MODE_AST; this is not an error.
+// Possible errors:
+// + EINVAL: `proc` was NULL.
+// + ENOMEM: Failed to allocate the code.
+int compile_proc(struct astnode_compproc *proc);
+
+#endif
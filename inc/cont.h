@@ -0,0 +1,87 @@
+#ifndef CONT_H
+#define CONT_H
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "inc/ast.h"
+
+// Continuations captured by call-with-current-continuation (call/cc).
+//
+// Calling a continuation while the call/cc that captured it has not returned
+// (an escape) is a non-copying unwind: the stacks are cut back to the heights
+// they had at the call/cc, and control goes back there with longjmp, or by
+// truncating the control stack when the stack evaluator (see inc/stackeval.h)
+// made the call/cc and runs the call. Its cost doesn't depend on how deep the
+// evaluation got in the meantime.
+//
+// In EVAL_MODE_STACK, a continuation can also be called once its call/cc
+// returned (a re-entry): when it leaves the control stack, the frames below its
+// call/cc are saved in it, and calling it puts them back in place of those of
+// the innermost evaluation. Continuations are delimited by that evaluation
+// (e.g. the top-level form being evaluated). In the other modes, the rest of
+// the computation is on the C stack and can't be saved; calling such a
+// continuation fails.
+
+// A point control can come back to when a continuation is called: a call/cc
+// run on the C stack, or an evaluation by the stack evaluator. They live on the
+// C stack of the function that set them up with cont_enter and setjmp.
+struct cont_escape {
+  jmp_buf buf;
+  struct cont_escape *prev;	// The escape this one is nested in
+  uint32_t level;		// Number of escapes it is nested in
+  bool is_run;			// An evaluation by the stack evaluator
+  // Heights of the stacks when the escape was set up
+  size_t argstack_height;
+  size_t vm_height;
+  size_t cstack_height;
+  // Set before control comes back to the escape
+  struct astnode_cont *thrown;	// The continuation that was called
+  struct astnode *val;		// The value it was called with
+  bool reenter;			// `thrown` is re-entered rather than escaped to
+};
+
+// Makes `escape` the innermost escape, recording the current stack heights.
+// Its owner must then call setjmp(escape->buf).
+void cont_enter(struct cont_escape *escape, bool is_run);
+
+// Removes `escape`, which must be the innermost escape.
+void cont_leave(struct cont_escape *escape);
+
+// Returns the innermost escape, or NULL if there is none.
+struct cont_escape *cont_innermost(void);
+
+// Allocates a continuation that comes back to `escape`, where the control
+// stack has height `height`. It is active until cont_deactivate.
+// Possible errors:
+// + ENOMEM: Out of memory.
+int cont_make(struct cont_escape *escape, size_t height,
+	      struct astnode_cont **ret);
+
+// Ends the extent of the active continuations made for `escape` or for the
+// escapes nested in it. Those of the stack evaluator save their frames so that
+// they can be re-entered.
+void cont_deactivate(struct cont_escape *escape);
+
+// Ends the extent of `cont`, which must be the innermost active continuation.
+void cont_pop(struct astnode_cont *cont);
+
+// Prepares the call of `cont` with `val`: ends the extent of the continuations
+// it unwinds, and fills in the escape control must go back to, returned in
+// `target`. The caller must then either carry on from `target` itself, if it
+// owns it, or call cont_jump.
+// Possible errors:
+// + EINVAL: An argument was NULL.
+// + ENOTSUP: `cont` can't be re-entered.
+int cont_prepare_throw(struct astnode_cont *cont, struct astnode *val,
+		       struct cont_escape **target);
+
+// Cuts the stacks back to the heights recorded in `target`, and longjmps to it.
+void cont_jump(struct cont_escape *target) __attribute__((noreturn));
+
+// Calls `cont` with `val`. Only returns on error.
+// Possible errors: see cont_prepare_throw.
+int cont_throw(struct astnode_cont *cont, struct astnode *val);
+
+#endif
@@ -4,22 +4,34 @@
 #include "inc/ast.h"
 
 // Makes top level environment, which includes primitive procedures' and keyword
-// bindings.
+// bindings. Its bindings are kept in one cell per symbol, so looking up or
+// defining a global takes the same time however many globals there are.
 // Possible errors:
 // + EINVAL: An argument was NULL.
 // + ENOMEM: Failed to allocate the new environment.
 int make_top_level_env(struct astnode_env **ret);
 
 // Adds a new frame to `env` and binds the formal parameters to the supplied
-// arguments. The resulting environment is placed in `extended`.
+// arguments. The resulting environment is placed in `extended`. The new frame
+// is a single allocation: the nth argument goes in its nth slot, and the frame
+// keeps a reference to `formal_params` for the names.
 // Possible errors:
 // + EINVAL: An argument was NULL.
 // + EBADMSG: The number of arguments does not match the number of formal
 // parameters.
-// + ENOMEM: Failed to allocate the new frame.
+// + ENOMEM: Failed to allocate the new frame, or it has too many slots for
+// any size class (see alloc_astnode_sized).
 int extend_env(struct astnode_env *env, struct astnode_pair *formal_params,
 	       struct astnode_pair *args, struct astnode_env **extended);
 
+// Same as extend_env, but the arguments are the `nargs` values starting at
+// `args` rather than a list.
+// Possible errors:
+// See extend_env.
+int extend_env_array(struct astnode_env *env, struct astnode_pair *formal_params,
+		     struct astnode **args, uint32_t nargs,
+		     struct astnode_env **extended);
+
 // Looks up a binding for `sym` in `env`, placing the first one it finds in
 // `ret`.
 // Possible errors:
@@ -27,6 +39,23 @@ int extend_env(struct astnode_env *env, struct astnode_pair *formal_params,
 // + EBADMSG: No binding was found for `sym`
 int lookup_env(struct astnode_env *env, struct astnode_sym *sym, struct astnode **ret);
 
+// Looks up a binding for `sym` in the top-level environment `env` is nested in,
+// skipping every other frame. Only use this when no frame between `env` and
+// the top level can bind `sym`.
+// Possible errors:
+// + EINVAL: An argument was NULL.
+// + EBADMSG: `sym` is not bound at the top level.
+int lookup_global(struct astnode_env *env, struct astnode_sym *sym,
+		  struct astnode **ret);
+
+// Places in `ret` the value in the `index`th slot of the frame `depth` frames
+// up from the first frame of `env` (see struct astnode_lexaddr).
+// Possible errors:
+// + EINVAL: An argument was NULL.
+// + EBADMSG: No such frame or slot exists.
+int lookup_lexaddr(struct astnode_env *env, uint32_t depth, uint32_t index,
+		   struct astnode **ret);
+
 // Adds a binding from `sym` to `val` in the first frame in `env`. If a binding
 // already exists, the previous one is silently removed.
 // Possible errors:
@@ -4,6 +4,20 @@
 #include "inc/ast.h"
 #include "inc/env.h"
 
+// How compound procedures are run. Changing it only affects the procedures
+// created afterwards, except for EVAL_MODE_STACK which is checked by eval
+// itself.
+enum eval_mode {
+  EVAL_MODE_AST,		// Walk their body (the reference implementation)
+  EVAL_MODE_BYTECODE,		// Compile their body and run it on the VM
+  EVAL_MODE_ANALYZE,		// Analyze their body into a tree of C
+				// functions (see inc/analyze.h)
+  EVAL_MODE_STACK,		// Walk their body without recursing on the C
+				// stack (see inc/stackeval.h)
+};
+
+extern enum eval_mode eval_mode;
+
 // The Scheme evaluator. Evaluates `node` with respect to `env`, and returns the
 // resulting astnode in `ret`.
 // Possible errors:
@@ -13,13 +27,6 @@
 // + ENOMEM: Out of memory.
 int eval(struct astnode *node, struct astnode_env *env, struct astnode **ret);
 
-// Evaluate each element in `unevaled_args` and placed a list of the evaluated
-// arguments in `ret`.
-// Possible errors:
-// See eval.
-int eval_list(struct astnode_pair *unevaled_args, struct astnode_env *env,
-	      struct astnode_pair **ret);
-
 // Convenience procedure that evaluates each element in `stmts` and returns the
 // value of the last one. Return value is unspecified if `stmts` is the empty
 // list.
@@ -28,12 +35,26 @@ int eval_list(struct astnode_pair *unevaled_args, struct astnode_env *env,
 int eval_many(struct astnode_pair *stmts, struct astnode_env *env,
 	      struct astnode **ret);
 
-// Apply `proc` to `args`. `proc` can either be a primitive or compound
-// procedure. `args` must already have been evaluated.
+// Apply `proc` to the `nargs` arguments starting at `args`, which must already
+// have been evaluated. `proc` can either be a primitive or compound procedure,
+// or a continuation (see inc/cont.h), in which case this doesn't return unless
+// the continuation can't be called. This is how eval calls procedures: the arguments are usually on the argument
+// stack (see inc/argstack.h). `args` is not read once the body of a compound
+// procedure starts running, so it may point into a stack that the body grows.
 // Possible errors:
-// + EINVAL: An argument was NULL.
+// + EINVAL: `proc` or `ret` was NULL, or `args` was NULL while `nargs` isn't 0.
 // + EBADMSG: `proc` is not a primitive nor a compound procedure. Invalid
 // arguments to the procedure.
+// + ENOMEM: Out of memory.
+// + ENOTSUP: `proc` is a continuation that can't be re-entered.
+int apply_args(struct astnode *proc, struct astnode **args, uint32_t nargs,
+	       struct astnode **ret);
+
+// Same as apply_args, but the arguments are the elements of the list `args`.
+// Possible errors:
+// + EINVAL: An argument was NULL.
+// + EBADMSG: `args` is not a proper list. See apply_args.
+// + ENOMEM: See apply_args.
 int apply(struct astnode *proc, struct astnode_pair *args, struct astnode **ret);
 
 #endif
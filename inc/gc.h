@@ -2,13 +2,94 @@
 #define GC_H
 
 #include <stddef.h>
+#include <stdio.h>
 
 #include "inc/ast.h"
 
+// The largest object that fits in a size class. alloc_astnode_sized gives
+// bigger objects a block of their own.
+#define GC_MAX_OBJ_SIZE ((size_t) 16384)
+
+// Size and alignment of the pages of the heap (see gc_load_image).
+#define GC_PAGE_SIZE ((size_t) 1 << 16)
+
+// Counters describing the state of the managed heap. Pages are never given back
+// to the OS, only the blocks of large objects are, so under a steady load
+// `heap_size` should flatten out once the working set fits in the heap.
+struct gc_stats {
+  size_t heap_size;		// Bytes reserved for the heap
+  size_t bytes_in_use;		// Bytes occupied by allocated objects
+  size_t nallocs;		// Number of objects allocated since startup
+  size_t ncollections;		// Number of completed collections
+};
+
 // Allocates an astnode of type `type` and initializes the header. Places the
-// allocated and initialized object in ret.
+// allocated and initialized object in ret. A collection may be triggered
+// before the allocation if the heap is full.
 // Possible errors:
+// + EINVAL: `ret` is NULL, or `type` is TYPE_INT (integers are fixnums, see
+// make_fixnum) or TYPE_BOOLEAN (see make_boolean).
 // + ENOMEM: Out of memory.
 int alloc_astnode(astnode_type type, struct astnode **ret);
 
+// Like alloc_astnode, but the object is `size` bytes big, which may be more
+// than sizeof the type's struct (e.g. for the slots of an environment frame).
+// Objects larger than GC_MAX_OBJ_SIZE are allocated one by one with malloc.
+// Possible errors:
+// + EINVAL: Same as alloc_astnode.
+// + ENOMEM: Out of memory.
+int alloc_astnode_sized(astnode_type type, size_t size, struct astnode **ret);
+
+// Registers `root` as a GC root: it (and everything reachable from it) will
+// survive every collection. The C stack is always scanned, so this is only
+// needed for objects referenced from static storage or from memory outside of
+// the managed heap (e.g. the top-level environment).
+// Possible errors:
+// + EINVAL: `root` is NULL.
+// + ENOMEM: Failed to grow the root set.
+int gc_add_root(struct astnode *root);
+
+// Registers the `*len` first elements of the array `*array` as GC roots. Both
+// are read again at every collection, so the array may be reallocated and its
+// length may change after registration. Elements may be NULL or fixnums.
+// Possible errors:
+// + EINVAL: An argument was NULL.
+// + ENOMEM: Failed to grow the root set.
+int gc_add_root_array(struct astnode ***array, size_t *len);
+
+// Runs a full mark and sweep collection.
+// Possible errors:
+// + ENOMEM: Failed to allocate the mark stack. No object was freed.
+int gc_collect(void);
+
+// Copies the current heap counters in `stats`.
+void gc_get_stats(struct gc_stats *stats);
+
+// Writes the objects reachable from `root` to `file`, in the format
+// gc_load_image reads: the pages that hold them, as they are in memory, then
+// the large objects and the blocks of the top-level environments' globals.
+// The image only holds pointers to those objects, to static objects (e.g.
+// EMPTY_LIST) and to functions and descriptors of the executable, so it can
+// only be loaded by the same executable.
+// Possible errors:
+// + EINVAL: An argument was NULL.
+// + ENOMEM: Failed to allocate the mark stack or a buffer.
+// + ENOTSUP: A reachable object points outside of the heap and of the
+// executable (e.g. to a node built on the stack).
+// + EIO: Failed to write to `file`.
+int gc_write_image(FILE *file, struct astnode *root);
+
+// Adds the objects of an image written by gc_write_image to the heap, and
+// places the object that was its root in `root`. The image is the `size`
+// bytes at `image`, which must be aligned on GC_PAGE_SIZE, writable, and never
+// freed: its pages become pages of the heap in place, and only need their
+// pointers adjusted. Continuations that were active when the image was written
+// can't be called anymore. The root isn't registered with gc_add_root. Either
+// the whole image is loaded, or the heap is left as it was.
+// Possible errors:
+// + EINVAL: An argument was NULL, `image` is misaligned, or it doesn't hold an
+// image written by this executable.
+// + ENOMEM: Failed to allocate large objects, globals or the page index.
+int gc_load_image(void *image, size_t size, struct astnode **root);
+
 #endif
@@ -0,0 +1,40 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "inc/ast.h"
+
+// Heap images: a snapshot of a top-level environment, taken once it's fully
+// initialized (e.g. after the init file is loaded), that later runs of the
+// same executable start from instead of initializing it again.
+//
+// An image holds the symbol table and everything reachable from the
+// environment: its globals, the procedures they are bound to, along with their
+// bytecode or analyzed bodies if they were compiled already. It's laid out so
+// that loading it takes a single mmap of the file, plus a pass adjusting the
+// pointers of the objects to where they were mapped (see gc_load_image): the
+// pages of the heap and the names of the symbols are used in place.
+
+// Writes the heap image of the top-level environment `env` to the file at
+// `path`, which is created or truncated.
+// Possible errors:
+// + EINVAL: An argument was NULL, or `env` isn't a top-level environment.
+// + ENOTSUP: See gc_write_image.
+// + ENOMEM: Out of memory.
+// + Any error of fopen, or EIO: Failed to write the image.
+int image_save(const char *path, struct astnode_env *env);
+
+// Maps the heap image at `path`, written by image_save, adds its symbols and
+// objects to the current ones, and places its top-level environment in `ret`
+// (registered as a GC root). Symbols interned before the call must be the
+// first symbols of the image, in the same order: load images right at startup.
+// If loading fails, the heap is left as it was, but the symbols of the image
+// may have been interned already, in which case the file stays mapped.
+// Possible errors:
+// + EINVAL: An argument was NULL, or the file isn't an image written by this
+// executable.
+// + EBUSY: See load_symbols.
+// + ENOMEM: Out of memory.
+// + Any error of open, fstat or mmap.
+int image_load(const char *path, struct astnode_env **ret);
+
+#endif
@@ -16,6 +16,16 @@ int kw_define(struct astnode_pair *args, struct astnode_env *env,
 int kw_if(struct astnode_pair *args, struct astnode_env *env,
 	  struct astnode **ret);
 
+// The part of kw_if that evaluates the condition: places the branch that must
+// be evaluated in `branch`, without evaluating it. This lets eval evaluate the
+// branch as a tail call.
+// Possible errors:
+// + EINVAL: An argument was NULL.
+// + EBADMSG: Wrong number of arguments.
+// + Any error from evaluating the condition (see eval).
+int kw_if_branch(struct astnode_pair *args, struct astnode_env *env,
+		 struct astnode **branch);
+
 int kw_quote(struct astnode_pair *args, struct astnode_env *env,
 	     struct astnode **ret);
 
@@ -0,0 +1,64 @@
+#ifndef LEXADDR_H
+#define LEXADDR_H
+
+#include <stdint.h>
+
+#include "inc/ast.h"
+
+// The frame a call to a procedure creates, as seen by the passes that process
+// its body before it runs (this one and the bytecode compiler).
+struct lexscope {
+  struct lexscope *parent;
+  struct astnode_pair *params;	// Bound in order by extend_env
+  uint32_t *defines;		// Symbols defined in the body
+  uint32_t ndefines;
+  uint32_t defines_cap;
+};
+
+enum lexbinding {
+  LEXBINDING_GLOBAL,		// Not bound by any scope
+  LEXBINDING_PARAM,		// A parameter: has a lexical address
+  LEXBINDING_DEFINE,		// Bound by define at run time
+};
+
+// Initializes `scope` for the body `body` of a procedure with the parameters
+// `params`, nested in `parent` (NULL for a procedure created at top level).
+// Keywords are those bound in `global_env`. `scope` must be closed with
+// lexscope_close.
+// Possible errors:
+// + EINVAL: An argument other than `parent` was NULL.
+// + EBADMSG: `params` is not a proper list of distinct symbols.
+// + ENOMEM: Failed to allocate the list of definitions.
+int lexscope_open(struct lexscope *scope, struct lexscope *parent,
+		  struct astnode *params, struct astnode *body,
+		  struct astnode_env *global_env);
+
+void lexscope_close(struct lexscope *scope);
+
+// Finds the innermost scope that binds `sym`. For parameters, `depth` and
+// `index` are set to its lexical address.
+enum lexbinding lexscope_find(struct lexscope *scope, struct astnode_sym *sym,
+			      uint32_t *depth, uint32_t *index);
+
+// Returns the handler of the keyword `node` names, or NULL if it isn't a
+// keyword in `scope` (e.g. because a parameter shadows it).
+kw_handler lexscope_keyword(struct lexscope *scope, struct astnode *node,
+			    struct astnode_env *global_env);
+
+// Lexical addressing pass. Replaces, in place, every reference to a parameter
+// in the body of `proc` (and in the bodies of the lambdas and procedure
+// definitions nested in it) with a struct astnode_lexaddr, so that eval fetches
+// it by position instead of looking it up by name.
+//
+// Only procedures created in the top-level environment are processed: the
+// procedures nested in them were resolved along with them. Names defined inside
+// a body with `define` shadow outer variables but are still looked up by name,
+// since whether and in which order they get bound is only known at run time.
+// Quoted data, malformed lambdas and lambdas with duplicate parameters are left
+// untouched.
+// Possible errors:
+// + EINVAL: `proc` was NULL.
+// + ENOMEM: Failed to allocate a lexical address.
+int resolve_lexaddrs(struct astnode_compproc *proc);
+
+#endif
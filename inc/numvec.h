@@ -0,0 +1,122 @@
+#ifndef NUMVEC_H
+#define NUMVEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "inc/ast.h"
+
+// Homogeneous numeric vectors (SRFI-4's s32vector, s64vector and f64vector):
+// the elements are stored unboxed, as a C array of int32_t, int64_t or double
+// right after the header (see struct astnode_numvector).
+//
+// The bulk operations run on kernels written with GCC's vector extensions, and
+// built twice: with 128-bit vectors (SSE2 on x86-64, the baseline there) and,
+// on x86, with 256-bit vectors for CPUs that have AVX2. The best set the CPU
+// supports is picked the first time numvec_kernels is called.
+
+// Instruction sets the kernels are built for.
+enum numvec_isa {
+  NUMVEC_ISA_VEC128,		// 128-bit vectors (SSE2 on x86-64)
+  NUMVEC_ISA_AVX2,		// 256-bit vectors, x86 only
+  NUMVEC_NISAS,
+};
+
+// Kernels of one element type. `n` is the number of elements; min and max
+// must not be called with 0. Integer arithmetic wraps around.
+#define NUMVEC_KERNELS(T)						\
+  struct {								\
+    void (*add)(T *dst, const T *a, const T *b, uint32_t n);		\
+    void (*mul)(T *dst, const T *a, const T *b, uint32_t n);		\
+    void (*scale)(T *dst, const T *a, T k, uint32_t n);		\
+    T (*dot)(const T *a, const T *b, uint32_t n);			\
+    T (*sum)(const T *a, uint32_t n);					\
+    T (*min)(const T *a, uint32_t n);					\
+    T (*max)(const T *a, uint32_t n);					\
+  }
+
+struct numvec_kernels {
+  const char *name;
+  NUMVEC_KERNELS(int32_t) s32;
+  NUMVEC_KERNELS(int64_t) s64;
+  NUMVEC_KERNELS(double) f64;
+};
+
+// Returns the kernels for the best instruction set the CPU supports.
+const struct numvec_kernels *numvec_kernels(void);
+
+// Returns the kernels built for `isa`, or NULL if they weren't built or the
+// CPU doesn't support them.
+const struct numvec_kernels *numvec_kernels_for(enum numvec_isa isa);
+
+// Size in bytes of an element of a vector of kind `kind`.
+size_t numvec_elt_size(enum numvec_kind kind);
+
+// Allocates a numeric vector of kind `kind` with `len` elements, all zero.
+// Possible errors:
+// + EINVAL: `ret` was NULL, or `kind` is invalid.
+// + ENOMEM: Out of memory.
+int numvec_alloc(enum numvec_kind kind, uint32_t len,
+		 struct astnode_numvector **ret);
+
+// Elements are read and written as fixnums: s64 and f64 values (elements,
+// sums, dot products...) that don't fit in a fixnum can't be read, and f64
+// values are truncated toward zero.
+
+// Places the `k`th element of `vec` in `ret`.
+// Possible errors:
+// + EINVAL: An argument was NULL, or `k` is out of range.
+// + EOVERFLOW: The element doesn't fit in a fixnum.
+int numvec_ref(const struct astnode_numvector *vec, uint32_t k,
+	       struct astnode **ret);
+
+// Sets the `k`th element of `vec`, which must be in range, to `val`.
+void numvec_set(struct astnode_numvector *vec, uint32_t k, int32_t val);
+
+// Sets every element of `vec` to `val`.
+void numvec_fill(struct astnode_numvector *vec, int32_t val);
+
+enum numvec_op {
+  NUMVEC_ADD,
+  NUMVEC_MUL,
+};
+
+// Sets each element of `dst` to the sum or product (depending on `op`) of the
+// elements of `a` and `b` at the same index. `dst` may be `a` or `b`.
+// Possible errors:
+// + EINVAL: An argument was NULL, or the vectors don't have the same kind and
+// length.
+int numvec_map(struct astnode_numvector *dst,
+	       const struct astnode_numvector *a,
+	       const struct astnode_numvector *b, enum numvec_op op);
+
+// Sets each element of `dst` to the element of `a` at the same index times
+// `k`. `dst` may be `a`.
+// Possible errors:
+// + EINVAL: Same as numvec_map.
+int numvec_scale(struct astnode_numvector *dst,
+		 const struct astnode_numvector *a, int32_t k);
+
+// Places the dot product of `a` and `b` in `ret`.
+// Possible errors:
+// + EINVAL: An argument was NULL, or `a` and `b` don't have the same kind and
+// length.
+// + EOVERFLOW: The result doesn't fit in a fixnum.
+int numvec_dot(const struct astnode_numvector *a,
+	       const struct astnode_numvector *b, struct astnode **ret);
+
+enum numvec_reduction {
+  NUMVEC_SUM,
+  NUMVEC_MIN,
+  NUMVEC_MAX,
+};
+
+// Places the sum, smallest or largest element (depending on `op`) of `vec` in
+// `ret`. The sum of no elements is 0.
+// Possible errors:
+// + EINVAL: An argument was NULL, or `vec` is empty and `op` isn't NUMVEC_SUM.
+// + EOVERFLOW: The result doesn't fit in a fixnum.
+int numvec_reduce(const struct astnode_numvector *vec,
+		  enum numvec_reduction op, struct astnode **ret);
+
+#endif
@@ -1,39 +1,175 @@
 #ifndef PRMT_HANDLERS_H
 #define PRMT_HANDLERS_H
 
+#include <stdint.h>
+
 #include "inc/ast.h"
 
+// Primitive procedures. They take their `nargs` arguments, already evaluated,
+// from the array `args` (see prmt_handler).
+
+// Fixed-arity entry points of primitives. They are only called through
+// prmt_apply, once the arguments were checked against the descriptor.
+typedef int (*prmt_handler1)(struct astnode *arg, struct astnode **ret);
+typedef int (*prmt_handler2)(struct astnode *arg1, struct astnode *arg2,
+			     struct astnode **ret);
+
+// Bit of a type in the arg_types masks of struct prmt_desc.
+#define PRMT_TYPE(type) (1u << (type))
+#define PRMT_ANY 0		// No type check
+
+#define PRMT_VARIADIC UINT32_MAX
+#define PRMT_MAX_TYPED_ARGS 3
+
+// Everything apply needs to know about a primitive procedure to check its
+// arguments once, and to call it the fastest way it can.
+struct prmt_desc {
+  const char *name;		// Name bound in the top-level environment
+  uint32_t min_args;
+  uint32_t max_args;		// PRMT_VARIADIC if there is no maximum
+  // Mask of the allowed types of each argument (PRMT_ANY for no check, which
+  // is also what entries left out of an initializer are). Arguments past
+  // PRMT_MAX_TYPED_ARGS are checked against the last slot,
+  // arg_types[PRMT_MAX_TYPED_ARGS - 1].
+  uint32_t arg_types[PRMT_MAX_TYPED_ARGS];
+  prmt_handler handler;		// Takes any number of arguments
+  prmt_handler1 handler1;	// If not NULL, used for calls with 1 argument
+  prmt_handler2 handler2;	// If not NULL, used for calls with 2 arguments
+};
+
+// The primitives bound in every top-level environment.
+extern const struct prmt_desc prmt_descs[];
+extern const uint32_t prmt_ndescs;
+
+// Calls the primitive described by `desc` with the `nargs` arguments starting
+// at `args`, after checking their number and types against `desc`.
+// Possible errors:
+// + EINVAL: `desc` or `ret` was NULL, or `args` was NULL while `nargs` isn't
+// 0.
+// + EBADMSG: Wrong number or type of arguments.
+// + Any error from the primitive.
+int prmt_apply(const struct prmt_desc *desc, struct astnode **args,
+	       uint32_t nargs, struct astnode **ret);
+
+// The handlers below can also be called directly: they check their arguments
+// themselves.
+
 // Scheme's cons.
 // Possible errors:
-// + EINVAL: An argument was NULL.
+// + EINVAL: `ret` was NULL.
 // + EBADMSG: Wrong number or type of arguments.
 // + ENOMEM: Failed to allocate an object.
-int prmt_cons(struct astnode_pair *args, struct astnode **ret);
+int prmt_cons(struct astnode **args, uint32_t nargs, struct astnode **ret);
 
 // Scheme's car.
 // Possible errors:
-// + EINVAL: An argument was NULL.
+// + EINVAL: `ret` was NULL.
 // + EBADMSG: Wrong number or type of arguments.
-int prmt_car(struct astnode_pair *args, struct astnode **ret);
+int prmt_car(struct astnode **args, uint32_t nargs, struct astnode **ret);
 
 // Scheme's cdr.
 // Possible errors:
-// + EINVAL: An argument was NULL.
+// + EINVAL: `ret` was NULL.
 // + EBADMSG: Wrong number or type of arguments.
-int prmt_cdr(struct astnode_pair *args, struct astnode **ret);
+int prmt_cdr(struct astnode **args, uint32_t nargs, struct astnode **ret);
 
 // `ret` is set to boolean #t if `node` is a pair. The empty list is not a pair.
 // Possible errors:
-// + EINVAL: Either argument is NULL.
+// + EINVAL: `ret` is NULL.
 // + EBADMSG: Wrong number or type of arguments.
-int prmt_is_pair(struct astnode_pair *args, struct astnode **ret);
+int prmt_is_pair(struct astnode **args, uint32_t nargs, struct astnode **ret);
+
+int prmt_plus(struct astnode **args, uint32_t nargs, struct astnode **ret);
+int prmt_minus(struct astnode **args, uint32_t nargs, struct astnode **ret);
+int prmt_mult(struct astnode **args, uint32_t nargs, struct astnode **ret);
+
+// Scheme's / on integers, truncating the quotient.
+// Possible errors:
+// + EINVAL: `ret` is NULL.
+// + EBADMSG: Wrong number or type of arguments, division by zero, or
+// overflow (the smallest integer divided by -1).
+int prmt_div(struct astnode **args, uint32_t nargs, struct astnode **ret);
+
+int prmt_equal(struct astnode **args, uint32_t nargs, struct astnode **ret);
+int prmt_less(struct astnode **args, uint32_t nargs, struct astnode **ret);
+int prmt_greater(struct astnode **args, uint32_t nargs, struct astnode **ret);
 
-int prmt_plus(struct astnode_pair *args, struct astnode **ret);
-int prmt_minus(struct astnode_pair *args, struct astnode **ret);
-int prmt_mult(struct astnode_pair *args, struct astnode **ret);
-int prmt_div(struct astnode_pair *args, struct astnode **ret);
-int prmt_equal(struct astnode_pair *args, struct astnode **ret);
+int prmt_is_eq(struct astnode **args, uint32_t nargs, struct astnode **ret);
 
-int prmt_is_eq(struct astnode_pair *args, struct astnode **ret);
+// Vectors. Indices out of range are EBADMSG, like arguments of the wrong type.
+// Possible errors:
+// + EINVAL: `ret` was NULL.
+// + EBADMSG: Wrong number or type of arguments, or index out of range.
+// + ENOMEM: Failed to allocate the vector (make-vector).
+int prmt_make_vector(struct astnode **args, uint32_t nargs,
+		     struct astnode **ret);
+int prmt_vector_ref(struct astnode **args, uint32_t nargs,
+		    struct astnode **ret);
+int prmt_vector_set(struct astnode **args, uint32_t nargs,
+		    struct astnode **ret);
+int prmt_vector_length(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_vector_fill(struct astnode **args, uint32_t nargs,
+		     struct astnode **ret);
+
+// Numeric vectors (see inc/numvec.h): make-s32vector, s32vector-ref,
+// s32vector-set! and s32vector-length, and likewise for s64 and f64. Elements
+// are set from integers, and the fill is 0 by default. The numvector-*
+// primitives work on vectors of any kind: add, mul and scale return a new
+// vector, dot, sum, min and max an integer.
+// Possible errors:
+// + EINVAL: `ret` was NULL.
+// + EBADMSG: Wrong number or type of arguments, vector of the wrong kind,
+// index out of range, vectors of different kinds or lengths, or min or max of
+// an empty vector.
+// + EOVERFLOW: An s64 or f64 result doesn't fit in an integer.
+// + ENOMEM: Failed to allocate the vector.
+int prmt_make_s32vector(struct astnode **args, uint32_t nargs,
+			struct astnode **ret);
+int prmt_s32vector_ref(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_s32vector_set(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_s32vector_length(struct astnode **args, uint32_t nargs,
+			  struct astnode **ret);
+int prmt_make_s64vector(struct astnode **args, uint32_t nargs,
+			struct astnode **ret);
+int prmt_s64vector_ref(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_s64vector_set(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_s64vector_length(struct astnode **args, uint32_t nargs,
+			  struct astnode **ret);
+int prmt_make_f64vector(struct astnode **args, uint32_t nargs,
+			struct astnode **ret);
+int prmt_f64vector_ref(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_f64vector_set(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_f64vector_length(struct astnode **args, uint32_t nargs,
+			  struct astnode **ret);
+int prmt_numvector_add(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_numvector_mul(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_numvector_scale(struct astnode **args, uint32_t nargs,
+			 struct astnode **ret);
+int prmt_numvector_dot(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_numvector_sum(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_numvector_min(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+int prmt_numvector_max(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret);
+
+// Scheme's call-with-current-continuation (also bound to call/cc). Calls its
+// argument with the continuation of the call (see inc/cont.h).
+// Possible errors:
+// + EINVAL: `ret` was NULL.
+// + EBADMSG: Wrong number of arguments.
+// + ENOMEM: Out of memory.
+// + Any error from the call of the argument.
+int prmt_call_cc(struct astnode **args, uint32_t nargs, struct astnode **ret);
 
 #endif
@@ -0,0 +1,57 @@
+#ifndef READER_H
+#define READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "inc/ast.h"
+
+// A reader of s-expressions from a buffer in memory, usually a file mapped by
+// reader_open: an alternative to the flex lexer and bison parser for loading
+// files, which tokenizes the buffer in place. Symbols are interned straight
+// from its bytes (only new ones are copied, by putsym), integers are parsed
+// without copies either, and the nodes are allocated from the managed heap.
+//
+// The syntax is the same as that of the lexer and parser: integers, #t and #f,
+// symbols, lists and dotted pairs, 'x for (quote x), and comments from ';' to
+// the end of the line.
+// Deepest nesting of lists and quotes a datum may have: the reader recurses
+// on them, so this bounds its use of the C stack. It is the parser's limit
+// too (bison's YYMAXDEPTH).
+#define READER_MAX_DEPTH 10000
+
+struct reader {
+  const char *pos;		// Next byte to read
+  const char *end;
+  uint32_t line;		// Line of `pos`, from 1
+  uint32_t depth;		// Lists and quotes open at `pos`
+  void *map;			// Mapping made by reader_open, or NULL
+  size_t map_size;
+};
+
+// Maps the file at `path` and sets up `reader` to read it. The file is mapped
+// until reader_close is called.
+// Possible errors:
+// + EINVAL: An argument was NULL.
+// + Any error of open, fstat or mmap.
+int reader_open(struct reader *reader, const char *path);
+
+// Sets up `reader` to read the `len` bytes at `buf`, which must stay valid and
+// unchanged while it is used.
+void reader_init(struct reader *reader, const char *buf, size_t len);
+
+// Reads the next top-level datum and places it in `ret`, or places NULL there
+// at the end of the input.
+// Possible errors:
+// + EINVAL: An argument was NULL.
+// + EBADMSG: Syntax error, found on line `reader->line`.
+// + EOVERFLOW: An integer doesn't fit in a fixnum.
+// + ENOMEM: Out of memory, or the datum is nested deeper than
+// READER_MAX_DEPTH.
+int reader_next(struct reader *reader, struct astnode **ret);
+
+// Unmaps the file of a reader set up by reader_open (does nothing for one set
+// up by reader_init).
+void reader_close(struct reader *reader);
+
+#endif
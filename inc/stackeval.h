@@ -0,0 +1,51 @@
+#ifndef STACKEVAL_H
+#define STACKEVAL_H
+
+#include <stddef.h>
+
+#include "inc/ast.h"
+
+// Explicit-stack evaluator, used by eval in EVAL_MODE_STACK.
+//
+// Evaluates like eval in EVAL_MODE_AST, but what is left to do once a
+// subexpression has a value (the rest of the arguments of a call, the branches
+// of an if, the rest of a body, ...) is kept as a frame on a heap-allocated
+// control stack instead of as a recursive call on the C stack. Recursion depth
+// is then only limited by the size of the control stack, which grows on demand
+// up to stackeval_max_bytes.
+//
+// quote, if, lambda, define and call/cc are run by the evaluator itself. Other
+// keywords, and procedures compiled or analyzed in another mode, are called
+// like eval does, on the C stack.
+
+// The largest the control stack may grow, in bytes. Evaluations that need more
+// fail with ENOMEM.
+#define STACKEVAL_DEFAULT_MAX_BYTES ((size_t) 256 << 20)
+
+extern size_t stackeval_max_bytes;
+
+// Evaluates `node` with respect to `env`, and returns the result in `ret`.
+// Possible errors:
+// + EINVAL: An argument was NULL.
+// + EBADMSG: See eval.
+// + ENOMEM: Out of memory, or the control stack would grow past
+// stackeval_max_bytes.
+// + ENOTSUP: A continuation that can't be re-entered was called.
+int stackeval(struct astnode *node, struct astnode_env *env,
+	      struct astnode **ret);
+
+// Returns the number of words on the control stack.
+size_t stackeval_height(void);
+
+// Pops words until `height` words are left, for continuations that unwind
+// evaluations (see inc/cont.h).
+void stackeval_truncate(size_t height);
+
+// Places in `ret` a list of the words of the control stack from index `from`
+// to index `to` (excluded), bottom first, for a continuation to put them back.
+// Possible errors:
+// + EINVAL: `ret` was NULL, or the range is not on the stack.
+// + ENOMEM: Out of memory.
+int stackeval_copy_frames(size_t from, size_t to, struct astnode **ret);
+
+#endif
@@ -26,14 +26,19 @@
       (arg3) == NULL || (arg4) == NULL)				\
     return EINVAL
 
-#define TYPE_CHECK(astnode, type_req)		\
-  if ((astnode == NULL) || (astnode)->type != (type_req))		\
+// `node` may be a fixnum; see inc/ast.h.
+#define TYPE_CHECK(node, type_req)					\
+  if ((node == NULL) ||							\
+      astnode_type_of((struct astnode *) (node)) != (type_req))		\
     return EBADMSG
 
-#define TYPE_CHECK2(astnode, type1, type2)				\
-  if ((astnode == NULL) ||						\
-      ((astnode)->type != (type1) && (astnode)->type != (type2)))	\
+#define TYPE_CHECK2(node, type1, type2)					\
+  if ((node == NULL) ||							\
+      (astnode_type_of((struct astnode *) (node)) != (type1) &&		\
+       astnode_type_of((struct astnode *) (node)) != (type2)))		\
     return EBADMSG
 
+// For parameters a function must take to match a function pointer type.
+#define UNUSED __attribute__((unused))
 
 #endif
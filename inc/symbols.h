@@ -1,22 +1,45 @@
 #ifndef SYMBOLS_H
 #define SYMBOLS_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 // Insert a symbol [symval_start, symval_end] into the symbol table. `putsym`
 // will allocate its own buffer for `symval` and copy its contents into it; it
 // will not touch the memory between [symval_start, symval_end]. If `index` is
 // not NULL, the index of `symval` in the table is written in `index`. If the
 // symbol is already in the table, its index is simply written in `index`.
+// Indexes are dense: the nth distinct symbol interned gets index n - 1.
 // Possible errors:
 // + EINVAL: symval_start > symval_end, or either are NULL
 // + ENOMEM: Failed to allocate memory for the table or internal buffer.
-int putsym(char *symval_start, char *symval_end, void **index);
+int putsym(char *symval_start, char *symval_end, uint32_t *index);
 
 // Retrieve a symbol from the symbol table at index `index`. `symval` is
 // modified to point to the internal buffer that contains the symbol value.
 // Possible errors:
 // + EINVAL: There is no symbol at index `index`, or `symval` is NULL
-int getsym(void *index, const char **symval);
+int getsym(uint32_t index, const char **symval);
+
+// Writes the names of all the symbols to `file`, in index order, each followed
+// by a NUL byte (the format load_symbols reads). Places the number of symbols
+// in `n`, and the number of bytes written in `size`.
+// Possible errors:
+// + EINVAL: An argument was NULL.
+// + EIO: Failed to write to `file`.
+int write_symbols(FILE *file, uint32_t *n, size_t *size);
+
+// Interns the `n` names that write_symbols wrote in the `size` bytes at
+// `names`, so that the ith name gets index i. The symbols already in the table
+// must be the first names, in the same order: e.g. the table is empty, or the
+// names were written by this process. The new symbols keep their buffer in
+// `names`, which must thus never be freed nor modified. Either all the names
+// are interned, or the table is left as it was.
+// Possible errors:
+// + EINVAL: `names` is NULL, or doesn't hold `n` distinct names.
+// + EBUSY: A symbol of the table has another index in `names`.
+// + ENOMEM: Failed to grow the table.
+int load_symbols(char *names, size_t size, uint32_t n);
 
 #endif
@@ -0,0 +1,59 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stddef.h>
+
+#include "inc/ast.h"
+
+// Bytecode virtual machine for compound procedures.
+//
+// In EVAL_MODE_BYTECODE, the body of a procedure created at top level is
+// compiled once, when the procedure is created (see inc/compile.h), into a
+// struct astnode_code. The lambdas nested in it are compiled along with it into
+// templates: procedures without an environment, which OP_CLOSURE copies.
+//
+// The VM is a stack machine. Each instruction is one opcode word followed by
+// its operands. A call saves the caller's code, frame and program counter on
+// the value stack, so calls between compiled procedures don't recurse on the C
+// stack, and OP_TAIL_CALL reuses the caller's slot. Anything else is called
+// through apply_args, with its arguments left on the stack.
+enum opcode {
+  OP_CONST,			// k: push consts[k]
+  OP_LOCAL,			// depth index: push the value at that lexical
+				// address
+  OP_GLOBAL,			// k: push the top-level value of the symbol
+				// consts[k]
+  OP_LOOKUP,			// k: push the value of the symbol consts[k],
+				// looked up by name from the current frame
+  OP_DEFINE,			// k: bind the symbol consts[k] to the top of the
+				// stack in the current frame
+  OP_POP,			// Drop the top of the stack
+  OP_JUMP,			// target: continue at instruction `target`
+  OP_JUMP_IF_FALSE,		// target: pop, and jump if it was #f
+  OP_CLOSURE,			// k: push a procedure made of the template
+				// consts[k] and the current frame
+  OP_CALL,			// n: call the procedure found under the n
+				// arguments on top of the stack
+  OP_TAIL_CALL,			// n: same, replacing the current call
+  OP_RETURN,			// Return the top of the stack
+};
+
+// Applies the compiled procedure `proc` to the `nargs` arguments starting at
+// `args`, which must already have been evaluated (see apply_args).
+// Possible errors:
+// + EINVAL: `proc` or `ret` was NULL, `args` was NULL while `nargs` isn't 0,
+// or `proc` has no code.
+// + EBADMSG: Wrong number of arguments, or an error while running the body
+// (see eval).
+// + ENOMEM: Out of memory.
+int vm_apply(struct astnode_compproc *proc, struct astnode **args,
+	     uint32_t nargs, struct astnode **ret);
+
+// Returns the number of values on the value stack.
+size_t vm_stack_height(void);
+
+// Pops values until `height` values are left, for continuations that unwind
+// procedures running on the VM (see inc/cont.h).
+void vm_stack_truncate(size_t height);
+
+#endif
@@ -0,0 +1,475 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inc/analyze.h"
+#include "inc/argstack.h"
+#include "inc/ast.h"
+#include "inc/env.h"
+#include "inc/eval.h"
+#include "inc/gc.h"
+#include "inc/kw_handlers.h"
+#include "inc/lexaddr.h"
+#include "inc/stdmacros.h"
+
+// In the functions below, EBADMSG means that the body can't be analyzed, and
+// must be left to eval.
+
+static int analyze_expr(struct astnode *node, struct lexscope *scope,
+			struct astnode_env *global_env,
+			struct astnode_exec **ret);
+
+// Runs `exec` in `env` to completion, running the nodes in tail position it
+// hands back in the same loop.
+static int run(struct astnode_exec *exec, struct astnode_env *env,
+	       struct astnode **ret)
+{
+  struct astnode_exec *next;
+
+  for (;;)
+    {
+      next = NULL;
+      RETONERR(exec->handler(exec, &env, &next, ret));
+      if (next == NULL)
+	return 0;
+      exec = next;
+    }
+}
+
+// ops: value
+static int exec_const(struct astnode_exec *exec,
+		      UNUSED struct astnode_env **env,
+		      UNUSED struct astnode_exec **next,
+		      struct astnode **ret)
+{
+  *ret = exec->ops[0];
+  return 0;
+}
+
+// ops: depth index (as fixnums)
+static int exec_local(struct astnode_exec *exec, struct astnode_env **env,
+		      UNUSED struct astnode_exec **next,
+		      struct astnode **ret)
+{
+  return lookup_lexaddr(*env, fixnum_val(exec->ops[0]),
+			fixnum_val(exec->ops[1]), ret);
+}
+
+// ops: sym
+static int exec_global(struct astnode_exec *exec, struct astnode_env **env,
+		       UNUSED struct astnode_exec **next,
+		       struct astnode **ret)
+{
+  return lookup_global(*env, (struct astnode_sym *) exec->ops[0], ret);
+}
+
+// ops: sym
+static int exec_lookup(struct astnode_exec *exec, struct astnode_env **env,
+		       UNUSED struct astnode_exec **next,
+		       struct astnode **ret)
+{
+  return lookup_env(*env, (struct astnode_sym *) exec->ops[0], ret);
+}
+
+// ops: cond truepath falsepath
+static int exec_if(struct astnode_exec *exec, struct astnode_env **env,
+		   struct astnode_exec **next,
+		   UNUSED struct astnode **ret)
+{
+  struct astnode *evaled_cond;
+
+  RETONERR(run((struct astnode_exec *) exec->ops[0], *env, &evaled_cond));
+
+  if (is_false(evaled_cond))
+    *next = (struct astnode_exec *) exec->ops[2];
+  else
+    *next = (struct astnode_exec *) exec->ops[1];
+
+  return 0;
+}
+
+// ops: template
+static int exec_lambda(struct astnode_exec *exec, struct astnode_env **env,
+		       UNUSED struct astnode_exec **next,
+		       struct astnode **ret)
+{
+  struct astnode_compproc *proc;
+
+  RETONERR(alloc_astnode(TYPE_COMPPROC, (struct astnode **) &proc));
+  *proc = *(struct astnode_compproc *) exec->ops[0];
+  proc->env = *env;
+
+  *ret = (struct astnode *) proc;
+  return 0;
+}
+
+// ops: sym value
+static int exec_define(struct astnode_exec *exec, struct astnode_env **env,
+		       UNUSED struct astnode_exec **next,
+		       struct astnode **ret)
+{
+  struct astnode *val;
+
+  RETONERR(run((struct astnode_exec *) exec->ops[1], *env, &val));
+  RETONERR(define_binding(*env, (struct astnode_sym *) exec->ops[0], val));
+
+  // Like kw_define, the value of the form is the defined value
+  *ret = val;
+  return 0;
+}
+
+// ops: expr...
+static int exec_sequence(struct astnode_exec *exec, struct astnode_env **env,
+			 struct astnode_exec **next,
+			 UNUSED struct astnode **ret)
+{
+  struct astnode *dummy;
+  uint32_t i;
+
+  for (i = 0; i < exec->nops - 1; i++)
+    RETONERR(run((struct astnode_exec *) exec->ops[i], *env, &dummy));
+
+  *next = (struct astnode_exec *) exec->ops[exec->nops - 1];
+  return 0;
+}
+
+// ops: operator operand...
+static int exec_call(struct astnode_exec *exec, struct astnode_env **env,
+		     struct astnode_exec **next, struct astnode **ret)
+{
+  struct astnode *evaled_car;
+  struct astnode *evaled_arg;
+  struct astnode_compproc *proc;
+  size_t base;
+  uint32_t i;
+  int err;
+
+  RETONERR(run((struct astnode_exec *) exec->ops[0], *env, &evaled_car));
+
+  base = argstack_size();
+  for (i = 1, err = 0; err == 0 && i < exec->nops; i++)
+    {
+      err = run((struct astnode_exec *) exec->ops[i], *env, &evaled_arg);
+      if (err == 0)
+	err = argstack_push(evaled_arg);
+    }
+
+  if (err == 0)
+    {
+      proc = (struct astnode_compproc *) evaled_car;
+      if (astnode_type_of(evaled_car) == TYPE_COMPPROC && proc->exec != NULL)
+	{
+	  err = extend_env_array(proc->env, proc->params, argstack_from(base),
+				 exec->nops - 1, env);
+	  if (err == 0)
+	    *next = proc->exec;
+	}
+      else
+	err = apply_args(evaled_car, argstack_from(base), exec->nops - 1, ret);
+    }
+
+  argstack_truncate(base);
+
+  return err;
+}
+
+static int make_exec(exec_handler handler, uint32_t nops,
+		     struct astnode_exec **ret)
+{
+  size_t size;
+
+  size = sizeof(struct astnode_exec) + nops * sizeof(struct astnode *);
+  RETONERR(alloc_astnode_sized(TYPE_EXEC, size, (struct astnode **) ret));
+  (*ret)->handler = handler;
+  (*ret)->nops = nops;
+
+  return 0;
+}
+
+static int make_exec1(exec_handler handler, struct astnode *op,
+		      struct astnode_exec **ret)
+{
+  RETONERR(make_exec(handler, 1, ret));
+  (*ret)->ops[0] = op;
+
+  return 0;
+}
+
+// Analyzes the list of expressions `body` into a single node.
+static int analyze_body(struct astnode *body, struct lexscope *scope,
+			struct astnode_env *global_env,
+			struct astnode_exec **ret)
+{
+  struct astnode_pair *scanner;
+  int64_t len;
+  uint32_t i;
+
+  len = list_length(body);
+  if (len <= 0)
+    return EBADMSG;
+  if (len == 1)
+    return analyze_expr(((struct astnode_pair *) body)->car, scope,
+			global_env, ret);
+
+  RETONERR(make_exec(exec_sequence, len, ret));
+  for (i = 0, scanner = (struct astnode_pair *) body;
+       !is_empty_list((struct astnode *) scanner);
+       i++, scanner = (struct astnode_pair *) scanner->cdr)
+    {
+      RETONERR(analyze_expr(scanner->car, scope, global_env,
+			    (struct astnode_exec **) &(*ret)->ops[i]));
+    }
+
+  return 0;
+}
+
+// Analyzes the body of a procedure with parameters `params`, nested in
+// `parent`. `exec` is set to NULL if the body can't be analyzed.
+static int analyze_proc_body(struct astnode *params, struct astnode *body,
+			     struct lexscope *parent,
+			     struct astnode_env *global_env,
+			     struct astnode_exec **exec)
+{
+  struct lexscope scope;
+  int err;
+
+  *exec = NULL;
+
+  err = lexscope_open(&scope, parent, params, body, global_env);
+  if (err == 0)
+    {
+      err = analyze_body(body, &scope, global_env, exec);
+      lexscope_close(&scope);
+    }
+
+  if (err == EBADMSG)
+    {
+      *exec = NULL;
+      return 0;
+    }
+
+  return err;
+}
+
+static int analyze_lambda(struct astnode *params, struct astnode *body,
+			  struct lexscope *scope,
+			  struct astnode_env *global_env,
+			  struct astnode_exec **ret)
+{
+  struct astnode_compproc *template;
+  struct astnode_exec *exec;
+
+  if (astnode_type_of(params) != TYPE_PAIR || list_length(body) <= 0)
+    return EBADMSG;
+
+  RETONERR(analyze_proc_body(params, body, scope, global_env, &exec));
+
+  RETONERR(alloc_astnode(TYPE_COMPPROC, (struct astnode **) &template));
+  template->params = (struct astnode_pair *) params;
+  template->body = (struct astnode_pair *) body;
+  template->env = NULL;
+  template->exec = exec;
+
+  return make_exec1(exec_lambda, (struct astnode *) template, ret);
+}
+
+static int analyze_if(struct astnode_pair *args, struct lexscope *scope,
+		      struct astnode_env *global_env,
+		      struct astnode_exec **ret)
+{
+  struct astnode_pair *truepath;
+  struct astnode_pair *falsepath;
+
+  if (list_length((struct astnode *) args) != 3)
+    return EBADMSG;
+  truepath = (struct astnode_pair *) args->cdr;
+  falsepath = (struct astnode_pair *) truepath->cdr;
+
+  RETONERR(make_exec(exec_if, 3, ret));
+  RETONERR(analyze_expr(args->car, scope, global_env,
+			(struct astnode_exec **) &(*ret)->ops[0]));
+  RETONERR(analyze_expr(truepath->car, scope, global_env,
+			(struct astnode_exec **) &(*ret)->ops[1]));
+  RETONERR(analyze_expr(falsepath->car, scope, global_env,
+			(struct astnode_exec **) &(*ret)->ops[2]));
+
+  return 0;
+}
+
+static int analyze_define(struct astnode_pair *args, struct lexscope *scope,
+			  struct astnode_env *global_env,
+			  struct astnode_exec **ret)
+{
+  struct astnode *target;
+  struct astnode_exec *value;
+
+  if (list_length((struct astnode *) args) < 2)
+    return EBADMSG;
+  target = args->car;
+
+  if (astnode_type_of(target) == TYPE_PAIR)
+    {
+      // (define (fn a) ...)
+      struct astnode *name = ((struct astnode_pair *) target)->car;
+
+      if (astnode_type_of(name) != TYPE_SYM)
+	return EBADMSG;
+      RETONERR(analyze_lambda(((struct astnode_pair *) target)->cdr,
+			      args->cdr, scope, global_env, &value));
+      target = name;
+    }
+  else if (astnode_type_of(target) == TYPE_SYM)
+    {
+      // (define a 3)
+      if (list_length((struct astnode *) args) != 2)
+	return EBADMSG;
+      RETONERR(analyze_expr(((struct astnode_pair *) args->cdr)->car, scope,
+			    global_env, &value));
+    }
+  else
+    return EBADMSG;
+
+  RETONERR(make_exec(exec_define, 2, ret));
+  (*ret)->ops[0] = target;
+  (*ret)->ops[1] = (struct astnode *) value;
+
+  return 0;
+}
+
+static int analyze_call(struct astnode_pair *node, struct lexscope *scope,
+			struct astnode_env *global_env,
+			struct astnode_exec **ret)
+{
+  struct astnode_pair *scanner;
+  int64_t nargs;
+  uint32_t i;
+
+  nargs = list_length(node->cdr);
+  if (nargs < 0)
+    return EBADMSG;
+
+  RETONERR(make_exec(exec_call, nargs + 1, ret));
+  RETONERR(analyze_expr(node->car, scope, global_env,
+			(struct astnode_exec **) &(*ret)->ops[0]));
+  for (i = 1, scanner = (struct astnode_pair *) node->cdr;
+       !is_empty_list((struct astnode *) scanner);
+       i++, scanner = (struct astnode_pair *) scanner->cdr)
+    {
+      RETONERR(analyze_expr(scanner->car, scope, global_env,
+			    (struct astnode_exec **) &(*ret)->ops[i]));
+    }
+
+  return 0;
+}
+
+static int analyze_expr(struct astnode *node, struct lexscope *scope,
+			struct astnode_env *global_env,
+			struct astnode_exec **ret)
+{
+  struct astnode_pair *pair;
+  struct astnode_pair *args;
+  kw_handler kw;
+  uint32_t depth;
+  uint32_t index;
+
+  switch (astnode_type_of(node))
+    {
+    case TYPE_SYM:
+      switch (lexscope_find(scope, (struct astnode_sym *) node, &depth, &index))
+	{
+	case LEXBINDING_PARAM:
+	  RETONERR(make_exec(exec_local, 2, ret));
+	  (*ret)->ops[0] = make_fixnum(depth);
+	  (*ret)->ops[1] = make_fixnum(index);
+	  return 0;
+	case LEXBINDING_DEFINE:
+	  return make_exec1(exec_lookup, node, ret);
+	case LEXBINDING_GLOBAL:
+	  return make_exec1(exec_global, node, ret);
+	}
+      return EBADMSG;
+
+    case TYPE_LEXADDR:
+      RETONERR(make_exec(exec_local, 2, ret));
+      (*ret)->ops[0] = make_fixnum(((struct astnode_lexaddr *) node)->depth);
+      (*ret)->ops[1] = make_fixnum(((struct astnode_lexaddr *) node)->index);
+      return 0;
+
+    case TYPE_PAIR:
+      if (is_empty_list(node))
+	break;
+
+      pair = (struct astnode_pair *) node;
+      args = (struct astnode_pair *) pair->cdr;
+      kw = lexscope_keyword(scope, pair->car, global_env);
+
+      if (kw == kw_quote)
+	{
+	  if (list_length((struct astnode *) args) != 1)
+	    return EBADMSG;
+	  return make_exec1(exec_const, args->car, ret);
+	}
+      else if (kw == kw_if)
+	return analyze_if(args, scope, global_env, ret);
+      else if (kw == kw_lambda)
+	{
+	  if (list_length((struct astnode *) args) < 2)
+	    return EBADMSG;
+	  return analyze_lambda(args->car, args->cdr, scope, global_env, ret);
+	}
+      else if (kw == kw_define)
+	return analyze_define(args, scope, global_env, ret);
+      else if (kw != NULL)
+	return EBADMSG;
+
+      return analyze_call(pair, scope, global_env, ret);
+
+      // Keywords are not expressions
+    case TYPE_KEYWORD:
+      return EBADMSG;
+
+      // Everything else evaluates to itself
+    case TYPE_INT:
+    case TYPE_BOOLEAN:
+    case TYPE_ENV:
+    case TYPE_PRMTPROC:
+    case TYPE_COMPPROC:
+    case TYPE_CODE:
+    case TYPE_EXEC:
+    case TYPE_CONT:
+    case TYPE_VECTOR:
+    case TYPE_NUMVECTOR:
+      break;
+
+    case TYPE_MAX:
+      return EBADMSG;
+    }
+
+  return make_exec1(exec_const, node, ret);
+}
+
+int analyze_proc(struct astnode_compproc *proc)
+{
+  NULL_CHECK1(proc);
+
+  if (eval_mode != EVAL_MODE_ANALYZE || proc->env->parent != NULL)
+    return 0;
+
+  return analyze_proc_body((struct astnode *) proc->params,
+			   (struct astnode *) proc->body, NULL, proc->env,
+			   &proc->exec);
+}
+
+int exec_apply(struct astnode_compproc *proc, struct astnode **args,
+	       uint32_t nargs, struct astnode **ret)
+{
+  struct astnode_env *env;
+
+  NULL_CHECK2(proc, ret);
+  if (proc->exec == NULL || (args == NULL && nargs > 0))
+    return EINVAL;
+
+  RETONERR(extend_env_array(proc->env, proc->params, args, nargs, &env));
+
+  return run(proc->exec, env, ret);
+}
@@ -0,0 +1,59 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include "inc/argstack.h"
+#include "inc/ast.h"
+#include "inc/gc.h"
+#include "inc/stdmacros.h"
+
+#define ARGSTACK_INITIAL_CAP 256
+
+static struct astnode **values;
+static size_t nvalues;
+static size_t cap;
+
+int argstack_push(struct astnode *val)
+{
+  if (nvalues == cap)
+    {
+      struct astnode **new_values;
+      size_t new_cap;
+
+      if (values == NULL)
+	RETONERR(gc_add_root_array(&values, &nvalues));
+
+      new_cap = cap == 0 ? ARGSTACK_INITIAL_CAP : cap * 2;
+      new_values = realloc(values, new_cap * sizeof(*values));
+      if (new_values == NULL)
+	return ENOMEM;
+      values = new_values;
+      cap = new_cap;
+    }
+
+  values[nvalues++] = val;
+
+  return 0;
+}
+
+size_t argstack_size(void)
+{
+  return nvalues;
+}
+
+struct astnode **argstack_from(size_t base)
+{
+  assert(base <= nvalues);
+
+  if (values == NULL)
+    return NULL;
+
+  return &values[base];
+}
+
+void argstack_truncate(size_t size)
+{
+  assert(size <= nvalues);
+
+  nvalues = size;
+}
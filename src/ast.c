@@ -18,9 +18,17 @@ struct astnode_pair _empty_list = {
   .cdr = NULL
 };
 
-bool is_empty_list(struct astnode *node)
+
+int64_t list_length(struct astnode *list)
 {
-  return node != NULL && node->type == TYPE_PAIR &&
-    ((struct astnode_pair *)node)->car == NULL &&
-    ((struct astnode_pair *)node)->cdr == NULL;
+  int64_t len;
+
+  for (len = 0; !is_empty_list(list); len++)
+    {
+      if (astnode_type_of(list) != TYPE_PAIR)
+	return -1;
+      list = ((struct astnode_pair *) list)->cdr;
+    }
+
+  return len;
 }
@@ -0,0 +1,429 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "inc/ast.h"
+#include "inc/compile.h"
+#include "inc/eval.h"
+#include "inc/gc.h"
+#include "inc/kw_handlers.h"
+#include "inc/lexaddr.h"
+#include "inc/stdmacros.h"
+#include "inc/vm.h"
+
+// In the functions below, EBADMSG means that the body can't be compiled, and
+// must be left to eval.
+
+struct compiler {
+  struct astnode_env *global_env;
+  uint32_t *insns;
+  uint32_t ninsns;
+  uint32_t insns_cap;
+  // Constants, most recent first. They live in the gc heap, where the stack
+  // scan finds them through this struct, since templates are not referenced
+  // from anywhere else until the code object is built.
+  struct astnode_pair *consts;
+  uint32_t nconsts;
+  uint32_t depth;		// Values on the stack at this point of the body
+  uint32_t max_depth;
+};
+
+static int compile_expr(struct compiler *c, struct astnode *node,
+			struct lexscope *scope, bool tail);
+
+static int emit(struct compiler *c, uint32_t word)
+{
+  if (c->ninsns == c->insns_cap)
+    {
+      uint32_t *new_insns;
+      uint32_t new_cap;
+
+      new_cap = c->insns_cap == 0 ? 64 : c->insns_cap * 2;
+      new_insns = realloc(c->insns, new_cap * sizeof(*new_insns));
+      if (new_insns == NULL)
+	return ENOMEM;
+      c->insns = new_insns;
+      c->insns_cap = new_cap;
+    }
+
+  c->insns[c->ninsns++] = word;
+
+  return 0;
+}
+
+static void push(struct compiler *c, uint32_t n)
+{
+  c->depth += n;
+  if (c->depth > c->max_depth)
+    c->max_depth = c->depth;
+}
+
+static void pop(struct compiler *c, uint32_t n)
+{
+  assert(c->depth >= n);
+  c->depth -= n;
+}
+
+static int add_const(struct compiler *c, struct astnode *node, uint32_t *index)
+{
+  struct astnode_pair *scanner;
+  struct astnode_pair *pair;
+  uint32_t i;
+
+  for (i = c->nconsts, scanner = c->consts;
+       !is_empty_list((struct astnode *) scanner);
+       scanner = (struct astnode_pair *) scanner->cdr)
+    {
+      i--;
+      if (scanner->car == node)
+	{
+	  *index = i;
+	  return 0;
+	}
+    }
+
+  RETONERR(alloc_astnode(TYPE_PAIR, (struct astnode **) &pair));
+  pair->car = node;
+  pair->cdr = (struct astnode *) c->consts;
+  c->consts = pair;
+
+  *index = c->nconsts++;
+
+  return 0;
+}
+
+static int emit_const_op(struct compiler *c, enum opcode op,
+			 struct astnode *node)
+{
+  uint32_t index;
+
+  RETONERR(add_const(c, node, &index));
+  RETONERR(emit(c, op));
+  RETONERR(emit(c, index));
+
+  return 0;
+}
+
+static int compile_body(struct compiler *c, struct astnode *body,
+			struct lexscope *scope)
+{
+  struct astnode_pair *scanner;
+
+  if (list_length(body) <= 0)
+    return EBADMSG;
+
+  for (scanner = (struct astnode_pair *) body;
+       !is_empty_list(scanner->cdr);
+       scanner = (struct astnode_pair *) scanner->cdr)
+    {
+      RETONERR(compile_expr(c, scanner->car, scope, false));
+      RETONERR(emit(c, OP_POP));
+      pop(c, 1);
+    }
+
+  RETONERR(compile_expr(c, scanner->car, scope, true));
+  RETONERR(emit(c, OP_RETURN));
+  pop(c, 1);
+
+  return 0;
+}
+
+static int make_code(struct compiler *c, struct astnode_code **ret)
+{
+  struct astnode_code *code;
+  struct astnode_pair *scanner;
+  size_t size;
+  uint32_t i;
+
+  size = sizeof(struct astnode_code) + c->nconsts * sizeof(struct astnode *) +
+    c->ninsns * sizeof(uint32_t);
+  RETONERR(alloc_astnode_sized(TYPE_CODE, size, (struct astnode **) &code));
+  code->nconsts = c->nconsts;
+  code->ninsns = c->ninsns;
+  code->max_stack = c->max_depth;
+
+  for (i = c->nconsts, scanner = c->consts;
+       !is_empty_list((struct astnode *) scanner);
+       scanner = (struct astnode_pair *) scanner->cdr)
+    {
+      code->consts[--i] = scanner->car;
+    }
+  memcpy(code_insns(code), c->insns, c->ninsns * sizeof(uint32_t));
+
+  *ret = code;
+  return 0;
+}
+
+// Compiles the body of a procedure with parameters `params`, nested in
+// `parent`. `code` is set to NULL if the body can't be compiled.
+static int compile_proc_body(struct astnode *params, struct astnode *body,
+			     struct lexscope *parent,
+			     struct astnode_env *global_env,
+			     struct astnode_code **code)
+{
+  struct compiler c = {
+    .global_env = global_env,
+    .insns = NULL,
+    .ninsns = 0,
+    .insns_cap = 0,
+    .consts = EMPTY_LIST,
+    .nconsts = 0,
+    .depth = 0,
+    .max_depth = 0
+  };
+  struct lexscope scope;
+  int err;
+
+  *code = NULL;
+
+  err = lexscope_open(&scope, parent, params, body, global_env);
+  if (err == 0)
+    {
+      err = compile_body(&c, body, &scope);
+      if (err == 0)
+	err = make_code(&c, code);
+      lexscope_close(&scope);
+    }
+
+  free(c.insns);
+
+  if (err == EBADMSG)
+    {
+      *code = NULL;
+      return 0;
+    }
+
+  return err;
+}
+
+// Emits an OP_CLOSURE for a lambda with parameters `params` and body `body`.
+static int compile_lambda(struct compiler *c, struct astnode *params,
+			  struct astnode *body, struct lexscope *scope)
+{
+  struct astnode_compproc *template;
+  struct astnode_code *code;
+
+  if (astnode_type_of(params) != TYPE_PAIR || list_length(body) <= 0)
+    return EBADMSG;
+
+  RETONERR(compile_proc_body(params, body, scope, c->global_env, &code));
+
+  RETONERR(alloc_astnode(TYPE_COMPPROC, (struct astnode **) &template));
+  template->params = (struct astnode_pair *) params;
+  template->body = (struct astnode_pair *) body;
+  template->env = NULL;
+  template->code = code;
+
+  RETONERR(emit_const_op(c, OP_CLOSURE, (struct astnode *) template));
+  push(c, 1);
+
+  return 0;
+}
+
+static int compile_if(struct compiler *c, struct astnode_pair *args,
+		      struct lexscope *scope, bool tail)
+{
+  struct astnode_pair *truepath;
+  struct astnode_pair *falsepath;
+  uint32_t jump_false;
+  uint32_t jump_end;
+  uint32_t depth;
+
+  if (list_length((struct astnode *) args) != 3)
+    return EBADMSG;
+  truepath = (struct astnode_pair *) args->cdr;
+  falsepath = (struct astnode_pair *) truepath->cdr;
+
+  RETONERR(compile_expr(c, args->car, scope, false));
+  RETONERR(emit(c, OP_JUMP_IF_FALSE));
+  jump_false = c->ninsns;
+  RETONERR(emit(c, 0));
+  pop(c, 1);
+  depth = c->depth;
+
+  RETONERR(compile_expr(c, truepath->car, scope, tail));
+  RETONERR(emit(c, OP_JUMP));
+  jump_end = c->ninsns;
+  RETONERR(emit(c, 0));
+
+  c->depth = depth;
+  c->insns[jump_false] = c->ninsns;
+  RETONERR(compile_expr(c, falsepath->car, scope, tail));
+  c->insns[jump_end] = c->ninsns;
+
+  return 0;
+}
+
+static int compile_define(struct compiler *c, struct astnode_pair *args,
+			  struct lexscope *scope)
+{
+  struct astnode *target;
+
+  if (list_length((struct astnode *) args) < 2)
+    return EBADMSG;
+  target = args->car;
+
+  if (astnode_type_of(target) == TYPE_PAIR)
+    {
+      // (define (fn a) ...)
+      struct astnode *name = ((struct astnode_pair *) target)->car;
+
+      if (astnode_type_of(name) != TYPE_SYM)
+	return EBADMSG;
+      RETONERR(compile_lambda(c, ((struct astnode_pair *) target)->cdr,
+			      args->cdr, scope));
+      target = name;
+    }
+  else if (astnode_type_of(target) == TYPE_SYM)
+    {
+      // (define a 3)
+      if (list_length((struct astnode *) args) != 2)
+	return EBADMSG;
+      RETONERR(compile_expr(c, ((struct astnode_pair *) args->cdr)->car, scope,
+			    false));
+    }
+  else
+    return EBADMSG;
+
+  // The value stays on the stack: it is the value of the define form
+  RETONERR(emit_const_op(c, OP_DEFINE, target));
+
+  return 0;
+}
+
+static int compile_call(struct compiler *c, struct astnode_pair *node,
+			struct lexscope *scope, bool tail)
+{
+  struct astnode_pair *scanner;
+  int64_t nargs;
+
+  nargs = list_length(node->cdr);
+  if (nargs < 0)
+    return EBADMSG;
+
+  RETONERR(compile_expr(c, node->car, scope, false));
+  for (scanner = (struct astnode_pair *) node->cdr;
+       !is_empty_list((struct astnode *) scanner);
+       scanner = (struct astnode_pair *) scanner->cdr)
+    {
+      RETONERR(compile_expr(c, scanner->car, scope, false));
+    }
+
+  RETONERR(emit(c, tail ? OP_TAIL_CALL : OP_CALL));
+  RETONERR(emit(c, nargs));
+  pop(c, nargs + 1);
+  push(c, 1);
+
+  return 0;
+}
+
+// Emits code that leaves the value of `node` on the stack. If `tail`, `node`
+// is in tail position.
+static int compile_expr(struct compiler *c, struct astnode *node,
+			struct lexscope *scope, bool tail)
+{
+  struct astnode_pair *pair;
+  struct astnode_pair *args;
+  kw_handler kw;
+  uint32_t depth;
+  uint32_t index;
+
+  switch (astnode_type_of(node))
+    {
+    case TYPE_SYM:
+      switch (lexscope_find(scope, (struct astnode_sym *) node, &depth, &index))
+	{
+	case LEXBINDING_PARAM:
+	  RETONERR(emit(c, OP_LOCAL));
+	  RETONERR(emit(c, depth));
+	  RETONERR(emit(c, index));
+	  break;
+	case LEXBINDING_DEFINE:
+	  RETONERR(emit_const_op(c, OP_LOOKUP, node));
+	  break;
+	case LEXBINDING_GLOBAL:
+	  RETONERR(emit_const_op(c, OP_GLOBAL, node));
+	  break;
+	}
+      push(c, 1);
+      return 0;
+
+    case TYPE_LEXADDR:
+      RETONERR(emit(c, OP_LOCAL));
+      RETONERR(emit(c, ((struct astnode_lexaddr *) node)->depth));
+      RETONERR(emit(c, ((struct astnode_lexaddr *) node)->index));
+      push(c, 1);
+      return 0;
+
+    case TYPE_PAIR:
+      if (is_empty_list(node))
+	break;
+
+      pair = (struct astnode_pair *) node;
+      args = (struct astnode_pair *) pair->cdr;
+      kw = lexscope_keyword(scope, pair->car, c->global_env);
+
+      if (kw == kw_quote)
+	{
+	  if (list_length((struct astnode *) args) != 1)
+	    return EBADMSG;
+	  RETONERR(emit_const_op(c, OP_CONST, args->car));
+	  push(c, 1);
+	  return 0;
+	}
+      else if (kw == kw_if)
+	return compile_if(c, args, scope, tail);
+      else if (kw == kw_lambda)
+	{
+	  if (list_length((struct astnode *) args) < 2)
+	    return EBADMSG;
+	  return compile_lambda(c, args->car, args->cdr, scope);
+	}
+      else if (kw == kw_define)
+	return compile_define(c, args, scope);
+      else if (kw != NULL)
+	return EBADMSG;
+
+      return compile_call(c, pair, scope, tail);
+
+      // Keywords are not expressions
+    case TYPE_KEYWORD:
+      return EBADMSG;
+
+      // Everything else evaluates to itself
+    case TYPE_INT:
+    case TYPE_BOOLEAN:
+    case TYPE_ENV:
+    case TYPE_PRMTPROC:
+    case TYPE_COMPPROC:
+    case TYPE_CODE:
+    case TYPE_EXEC:
+    case TYPE_CONT:
+    case TYPE_VECTOR:
+    case TYPE_NUMVECTOR:
+      break;
+
+    case TYPE_MAX:
+      return EBADMSG;
+    }
+
+  RETONERR(emit_const_op(c, OP_CONST, node));
+  push(c, 1);
+
+  return 0;
+}
+
+int compile_proc(struct astnode_compproc *proc)
+{
+  NULL_CHECK1(proc);
+
+  if (eval_mode != EVAL_MODE_BYTECODE || proc->env->parent != NULL)
+    return 0;
+
+  return compile_proc_body((struct astnode *) proc->params,
+			   (struct astnode *) proc->body, NULL, proc->env,
+			   &proc->code);
+}
@@ -0,0 +1,157 @@
+#include <errno.h>
+#include <setjmp.h>
+#include <stddef.h>
+
+#include "inc/argstack.h"
+#include "inc/ast.h"
+#include "inc/cont.h"
+#include "inc/gc.h"
+#include "inc/stackeval.h"
+#include "inc/stdmacros.h"
+#include "inc/vm.h"
+
+// Innermost first. Each escape is on the C stack of a function that is still
+// running.
+static struct cont_escape *escapes;
+
+// The active continuations, innermost first, linked by their `prev` field.
+// Each one is referenced by its call/cc frame (on the C stack or on the control
+// stack), so the list needs no root of its own.
+static struct astnode_cont *active;
+
+void cont_enter(struct cont_escape *escape, bool is_run)
+{
+  escape->prev = escapes;
+  escape->level = escapes == NULL ? 0 : escapes->level + 1;
+  escape->is_run = is_run;
+  escape->argstack_height = argstack_size();
+  escape->vm_height = vm_stack_height();
+  escape->cstack_height = stackeval_height();
+  escape->thrown = NULL;
+  escape->val = NULL;
+  escape->reenter = false;
+  escapes = escape;
+}
+
+void cont_leave(struct cont_escape *escape)
+{
+  escapes = escape->prev;
+}
+
+struct cont_escape *cont_innermost(void)
+{
+  return escapes;
+}
+
+int cont_make(struct cont_escape *escape, size_t height,
+	      struct astnode_cont **ret)
+{
+  NULL_CHECK2(escape, ret);
+
+  RETONERR(alloc_astnode(TYPE_CONT, (struct astnode **) ret));
+  (*ret)->state = CONT_ACTIVE;
+  (*ret)->escape = escape;
+  (*ret)->height = height;
+  (*ret)->prev = active;
+  active = *ret;
+
+  return 0;
+}
+
+// Ends the extent of the innermost active continuation. Its frames, if the
+// stack evaluator made it, are still on the control stack.
+static void deactivate_innermost(void)
+{
+  struct astnode_cont *cont;
+  int err;
+
+  cont = active;
+  active = cont->prev;
+  cont->prev = NULL;
+
+  err = ENOTSUP;
+  if (cont->escape->is_run)
+    err = stackeval_copy_frames(cont->escape->cstack_height, cont->height,
+				&cont->frames);
+  // Without its frames, it can still be passed around, but not called
+  cont->state = err == 0 ? CONT_SAVED : CONT_DEAD;
+  cont->escape = NULL;
+}
+
+void cont_deactivate(struct cont_escape *escape)
+{
+  while (active != NULL && active->escape->level >= escape->level)
+    deactivate_innermost();
+}
+
+void cont_pop(struct astnode_cont *cont)
+{
+  // A frame put back by a re-entry may belong to a continuation that has
+  // already ended
+  if (cont == active)
+    deactivate_innermost();
+}
+
+int cont_prepare_throw(struct astnode_cont *cont, struct astnode *val,
+		       struct cont_escape **target)
+{
+  struct cont_escape *escape;
+  bool reenter;
+
+  NULL_CHECK3(cont, val, target);
+
+  switch (cont->state)
+    {
+    case CONT_ACTIVE:
+      // The call/cc returns, along with everything it called
+      escape = cont->escape;
+      while (active != cont)
+	deactivate_innermost();
+      deactivate_innermost();
+      reenter = false;
+      break;
+
+    case CONT_SAVED:
+      // Only the stack evaluator can put frames back
+      for (escape = escapes;
+	   escape != NULL && !escape->is_run;
+	   escape = escape->prev)
+	;
+      if (escape == NULL)
+	return ENOTSUP;
+      cont_deactivate(escape);
+      reenter = true;
+      break;
+
+    case CONT_DEAD:
+    default:
+      return ENOTSUP;
+    }
+
+  escape->thrown = cont;
+  escape->val = val;
+  escape->reenter = reenter;
+  *target = escape;
+
+  return 0;
+}
+
+void cont_jump(struct cont_escape *target)
+{
+  escapes = target;
+  argstack_truncate(target->argstack_height);
+  vm_stack_truncate(target->vm_height);
+  // An evaluation by the stack evaluator sets the height of its stack itself
+  if (!target->is_run)
+    stackeval_truncate(target->cstack_height);
+
+  longjmp(target->buf, 1);
+}
+
+int cont_throw(struct astnode_cont *cont, struct astnode *val)
+{
+  struct cont_escape *target;
+
+  RETONERR(cont_prepare_throw(cont, val, &target));
+  cont_jump(target);
+}
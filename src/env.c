@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "inc/ast.h"
@@ -14,20 +15,21 @@
 // Top level environment bindings
 // *******************************************************
 
-// Convenience function that takes a symbol string and a prmt_handler and binds
-// them in the environment.
-static int bind_rawsym_prmt(struct astnode_env *env, char *rawsym, prmt_handler hdl)
+// Convenience function that binds the primitive described by `desc` to its
+// name in the environment.
+static int bind_prmt(struct astnode_env *env, const struct prmt_desc *desc)
 {
   struct astnode_sym *symnode;
   struct astnode_prmtproc *hdlnode;
+  char *rawsym = (char *) desc->name;
 
   // Add symbol to symbol table
   RETONERR(alloc_astnode(TYPE_SYM, (struct astnode **) &symnode));
   RETONERR(putsym(rawsym, rawsym + strlen(rawsym) - 1, &symnode->symi));
 
-  // Wrap primitive handler in astnode
+  // Wrap primitive descriptor in astnode
   RETONERR(alloc_astnode(TYPE_PRMTPROC, (struct astnode **) &hdlnode));
-  hdlnode->handler = hdl;
+  hdlnode->desc = desc;
 
   // Bind symbol in environment
   RETONERR(define_binding(env, symnode, (struct astnode *) hdlnode));
@@ -56,18 +58,10 @@ static int bind_rawsym_kw(struct astnode_env *env, char *rawsym, kw_handler hdl)
 
 static int install_prmt_ops(struct astnode_env *env)
 {
-  RETONERR(bind_rawsym_prmt(env, "cons", prmt_cons));
-  RETONERR(bind_rawsym_prmt(env, "car", prmt_car));
-  RETONERR(bind_rawsym_prmt(env, "cdr", prmt_cdr));
-  RETONERR(bind_rawsym_prmt(env, "pair?", prmt_is_pair));
-
-  RETONERR(bind_rawsym_prmt(env, "+", prmt_plus));
-  RETONERR(bind_rawsym_prmt(env, "-", prmt_minus));
-  RETONERR(bind_rawsym_prmt(env, "*", prmt_mult));
-  RETONERR(bind_rawsym_prmt(env, "/", prmt_div));
-  RETONERR(bind_rawsym_prmt(env, "=", prmt_equal));
+  uint32_t i;
 
-  RETONERR(bind_rawsym_prmt(env, "eq?", prmt_is_eq));
+  for (i = 0; i < prmt_ndescs; i++)
+    RETONERR(bind_prmt(env, &prmt_descs[i]));
 
   return 0;
 }
@@ -86,18 +80,37 @@ static int install_keywords(struct astnode_env *env)
 // Environment manipulation
 // *******************************************************
 
-// Returns the binding of sym, or NULL if no such binding exists in local
-// environment (i.e. the first frame).
-static struct astnode_pair *find_local_binding(struct astnode_env *env,
-					       struct astnode_sym *sym)
+// Number of global cells the top-level environment starts with; the table then
+// doubles whenever a symbol with a larger index gets defined.
+#define GLOBALS_INITIAL_CAP 256
+
+// Returns the location of the value bound to sym in the local environment
+// (i.e. the first frame), or NULL if there is no such binding.
+static struct astnode **find_local_value(struct astnode_env *env,
+					 struct astnode_sym *sym)
 {
+  struct astnode_pair *param_scanner;
   struct astnode_pair *binding_scanner;
+  uint32_t i;
 
   assert(env != NULL);
   assert(sym->type == TYPE_SYM);
 
-  if (is_empty_list((struct astnode *) env->bindings))
-    return NULL;
+  if (env->globals != NULL)
+    {
+      if (sym->symi < env->globals->cap &&
+	  env->globals->values[sym->symi] != NULL)
+	return &env->globals->values[sym->symi];
+      return NULL;
+    }
+
+  for (i = 0, param_scanner = env->params;
+       i < env->nslots;
+       i++, param_scanner = (struct astnode_pair *) param_scanner->cdr)
+    {
+      if (((struct astnode_sym *) param_scanner->car)->symi == sym->symi)
+	return &env->slots[i];
+    }
 
   for (binding_scanner = env->bindings;
        !is_empty_list((struct astnode *) binding_scanner);
@@ -111,13 +124,49 @@ static struct astnode_pair *find_local_binding(struct astnode_env *env,
       if (binding->car->type == TYPE_SYM &&
 	  ((struct astnode_sym *)binding->car)->symi == sym->symi)
 	{
-	  return binding;
+	  return &binding->cdr;
 	}
     }
 
   return NULL;
 }
 
+// Makes sure `env`'s global cells can hold the value of the symbol at index
+// `symi`.
+static int reserve_global(struct astnode_env *env, uint32_t symi)
+{
+  struct env_globals *new_globals;
+  uint32_t old_cap;
+  uint32_t new_cap;
+
+  old_cap = env->globals == NULL ? 0 : env->globals->cap;
+  if (symi < old_cap)
+    return 0;
+
+  new_cap = old_cap == 0 ? GLOBALS_INITIAL_CAP : old_cap;
+  while (new_cap <= symi)
+    {
+      if (new_cap > UINT32_MAX / 2)
+	{
+	  new_cap = UINT32_MAX;
+	  break;
+	}
+      new_cap *= 2;
+    }
+
+  new_globals = realloc(env->globals, sizeof(struct env_globals) +
+			(size_t) new_cap * sizeof(struct astnode *));
+  if (new_globals == NULL)
+    return ENOMEM;
+
+  memset(&new_globals->values[old_cap], 0,
+	 (size_t) (new_cap - old_cap) * sizeof(struct astnode *));
+  new_globals->cap = new_cap;
+  env->globals = new_globals;
+
+  return 0;
+}
+
 static int make_empty_env(struct astnode_env **ret)
 {
   struct astnode_env *env;
@@ -126,11 +175,11 @@ static int make_empty_env(struct astnode_env **ret)
 
   RETONERR(alloc_astnode(TYPE_ENV, (struct astnode **)&env));
 
+  env->nslots = 0;
   env->parent = NULL;
-
-  RETONERR(alloc_astnode(TYPE_PAIR, (struct astnode **)&env->bindings));
-  env->bindings->car = NULL;
-  env->bindings->cdr = NULL;
+  env->params = EMPTY_LIST;
+  env->bindings = EMPTY_LIST;
+  env->globals = NULL;
 
   *ret = env;
 
@@ -140,6 +189,9 @@ static int make_empty_env(struct astnode_env **ret)
 int make_top_level_env(struct astnode_env **ret)
 {
   RETONERR(make_empty_env(ret));
+  RETONERR(reserve_global(*ret, 0));
+  // The top-level environment outlives any stack frame that refers to it.
+  RETONERR(gc_add_root((struct astnode *) *ret));
   RETONERR(install_prmt_ops(*ret));
   RETONERR(install_keywords(*ret));
 
@@ -148,16 +200,16 @@ int make_top_level_env(struct astnode_env **ret)
 
 int lookup_env(struct astnode_env *env, struct astnode_sym *sym, struct astnode **ret)
 {
-  struct astnode_pair *binding;
+  struct astnode **value;
 
   NULL_CHECK3(sym, env, ret);
 
   while (env != NULL)
     {
-      binding = find_local_binding(env, sym);
-      if (binding != NULL)
+      value = find_local_value(env, sym);
+      if (value != NULL)
 	{
-	  *ret = binding->cdr;
+	  *ret = *value;
 	  return 0;
 	}
       env = env->parent;
@@ -166,36 +218,84 @@ int lookup_env(struct astnode_env *env, struct astnode_sym *sym, struct astnode
   return EBADMSG;
 }
 
+int lookup_lexaddr(struct astnode_env *env, uint32_t depth, uint32_t index,
+		   struct astnode **ret)
+{
+  NULL_CHECK2(env, ret);
+
+  for ( ; depth > 0; depth--)
+    {
+      env = env->parent;
+      if (env == NULL)
+	return EBADMSG;
+    }
+
+  if (index >= env->nslots)
+    return EBADMSG;
+
+  *ret = env->slots[index];
+
+  return 0;
+}
+
+int lookup_global(struct astnode_env *env, struct astnode_sym *sym,
+		  struct astnode **ret)
+{
+  NULL_CHECK3(env, sym, ret);
+
+  while (env->parent != NULL)
+    env = env->parent;
+
+  if (env->globals == NULL || sym->symi >= env->globals->cap ||
+      env->globals->values[sym->symi] == NULL)
+    return EBADMSG;
+
+  *ret = env->globals->values[sym->symi];
+
+  return 0;
+}
+
+// Allocates a frame of `nslots` slots named by `formal_params`, whose slots are
+// left for the caller to fill.
+static int make_frame(struct astnode_env *env, struct astnode_pair *formal_params,
+		      uint32_t nslots, struct astnode_env **ret)
+{
+  struct astnode_env *frame;
+
+  RETONERR(alloc_astnode_sized(TYPE_ENV, sizeof(struct astnode_env) +
+			       nslots * sizeof(struct astnode *),
+			       (struct astnode **) &frame));
+  frame->nslots = nslots;
+  frame->parent = env;
+  frame->params = formal_params;
+  frame->bindings = EMPTY_LIST;
+  frame->globals = NULL;
+
+  *ret = frame;
+  return 0;
+}
+
 int extend_env(struct astnode_env *env, struct astnode_pair *formal_params,
 	       struct astnode_pair *args, struct astnode_env **extended)
 {
   struct astnode_env *extended_temp;
   struct astnode_pair *param_scanner;
   struct astnode_pair *arg_scanner;
+  uint32_t nslots;
+  uint32_t i;
 
   NULL_CHECK4(env, formal_params, args, extended);
 
-  RETONERR(make_empty_env(&extended_temp));
-  extended_temp->parent = env;
-
-  // bind formal_params to args in extended_temp->bindings
-  for (param_scanner = formal_params, arg_scanner = args;
+  // Check formal_params and args, and count them to size the frame
+  for (nslots = 0, param_scanner = formal_params, arg_scanner = args;
        !is_empty_list((struct astnode *) param_scanner) &&
 	 !is_empty_list((struct astnode *) arg_scanner);
-       param_scanner = (struct astnode_pair *)param_scanner->cdr,
+       nslots++, param_scanner = (struct astnode_pair *)param_scanner->cdr,
 	 arg_scanner = (struct astnode_pair *) arg_scanner->cdr)
     {
-      struct astnode_sym *param;
-      struct astnode *arg;
-
       TYPE_CHECK(param_scanner, TYPE_PAIR);
       TYPE_CHECK(arg_scanner, TYPE_PAIR);
-
-      param = (struct astnode_sym *) param_scanner->car;
-      TYPE_CHECK(param, TYPE_SYM);
-      arg = arg_scanner->car;
-
-      RETONERR(define_binding(extended_temp, param, arg));
+      TYPE_CHECK(param_scanner->car, TYPE_SYM);
     }
 
   // If params and args were of different lengths, fail.
@@ -204,6 +304,47 @@ int extend_env(struct astnode_env *env, struct astnode_pair *formal_params,
 	is_empty_list((struct astnode *) arg_scanner)))
     return EBADMSG;
 
+  RETONERR(make_frame(env, formal_params, nslots, &extended_temp));
+
+  // bind formal_params to args in extended_temp->slots
+  for (i = 0, arg_scanner = args;
+       i < nslots;
+       i++, arg_scanner = (struct astnode_pair *) arg_scanner->cdr)
+    {
+      extended_temp->slots[i] = arg_scanner->car;
+    }
+
+  *extended = extended_temp;
+  return 0;
+}
+
+int extend_env_array(struct astnode_env *env, struct astnode_pair *formal_params,
+		     struct astnode **args, uint32_t nargs,
+		     struct astnode_env **extended)
+{
+  struct astnode_env *extended_temp;
+  struct astnode_pair *param_scanner;
+  uint32_t nslots;
+
+  NULL_CHECK3(env, formal_params, extended);
+  if (args == NULL && nargs > 0)
+    return EINVAL;
+
+  for (nslots = 0, param_scanner = formal_params;
+       !is_empty_list((struct astnode *) param_scanner);
+       nslots++, param_scanner = (struct astnode_pair *) param_scanner->cdr)
+    {
+      TYPE_CHECK(param_scanner, TYPE_PAIR);
+      TYPE_CHECK(param_scanner->car, TYPE_SYM);
+    }
+
+  if (nslots != nargs)
+    return EBADMSG;
+
+  RETONERR(make_frame(env, formal_params, nslots, &extended_temp));
+  if (nargs > 0)
+    memcpy(extended_temp->slots, args, nargs * sizeof(struct astnode *));
+
   *extended = extended_temp;
   return 0;
 }
@@ -212,17 +353,23 @@ int extend_env(struct astnode_env *env, struct astnode_pair *formal_params,
 int define_binding(struct astnode_env *env, struct astnode_sym *sym,
 		      struct astnode *val)
 {
-  struct astnode_pair *binding;
+  struct astnode **value;
 
   NULL_CHECK3(env, sym, val);
 
-  binding = find_local_binding(env, sym);
-  if (binding != NULL)
+  value = find_local_value(env, sym);
+  if (value != NULL)
+    {
+      *value = val;
+    }
+  else if (env->globals != NULL)
     {
-      binding->cdr = val;
+      RETONERR(reserve_global(env, sym->symi));
+      env->globals->values[sym->symi] = val;
     }
   else
     {
+      struct astnode_pair *binding;
       struct astnode_pair *binding_wrapper;
 
       RETONERR(alloc_astnode(TYPE_PAIR, (struct astnode **) &binding));
@@ -3,60 +3,82 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include "inc/analyze.h"
+#include "inc/argstack.h"
 #include "inc/ast.h"
+#include "inc/cont.h"
 #include "inc/env.h"
 #include "inc/eval.h"
 #include "inc/gc.h"
+#include "inc/kw_handlers.h"
+#include "inc/prmt_handlers.h"
+#include "inc/stackeval.h"
 #include "inc/stdmacros.h"
+#include "inc/vm.h"
 
-// Takes a list of objects to evaluate and returns a list of the corresponding
-// objects evaluated.
-int eval_list(struct astnode_pair *unevaled_args, struct astnode_env *env,
-		     struct astnode_pair **ret)
+enum eval_mode eval_mode = EVAL_MODE_AST;
+
+// Evaluates each element of `unevaled_args` and pushes the result on the
+// argument stack. The number of values pushed is placed in `nargs`. On error,
+// the caller must still truncate the stack.
+static int eval_args(struct astnode_pair *unevaled_args,
+		     struct astnode_env *env, uint32_t *nargs)
 {
-  struct astnode_pair *evaled_args;
-  struct astnode_pair *evaled_args_prev;
-  struct astnode_pair *ret_temp;
+  struct astnode *evaled_arg;
+
+  for (*nargs = 0;
+       !is_empty_list((struct astnode *) unevaled_args);
+       unevaled_args = (struct astnode_pair *) unevaled_args->cdr, (*nargs)++)
+    {
+      TYPE_CHECK((struct astnode *) unevaled_args, TYPE_PAIR);
 
-  assert(unevaled_args != NULL && env != NULL && ret != NULL);
+      RETONERR(eval(unevaled_args->car, env, &evaled_arg));
+      RETONERR(argstack_push(evaled_arg));
+    }
+
+  return 0;
+}
+
+// Evaluates every expression of `body` but the last one, which is placed in
+// `last` for the caller to evaluate as a tail call.
+static int eval_body_but_last(struct astnode_pair *body,
+			      struct astnode_env *env, struct astnode **last)
+{
+  struct astnode *ret_temp;
 
-  if (is_empty_list((struct astnode *) unevaled_args))
+  TYPE_CHECK(body, TYPE_PAIR);
+  if (is_empty_list((struct astnode *) body))
     {
-      *ret = unevaled_args;
+      *last = (struct astnode *) body;
       return 0;
     }
 
-  for (evaled_args_prev = NULL;
-       !is_empty_list((struct astnode *) unevaled_args);
-       unevaled_args = (struct astnode_pair *) unevaled_args->cdr,
-       evaled_args_prev = evaled_args)
+  for ( ;
+	!is_empty_list(body->cdr);
+	body = (struct astnode_pair *) body->cdr)
     {
-      TYPE_CHECK((struct astnode *) unevaled_args, TYPE_PAIR);
-
-      // Allocate pair object and link to previous. Keep a reference to the
-      // beginning of the list on the first iteration.
-      RETONERR(alloc_astnode(TYPE_PAIR, (struct astnode **) &evaled_args));
-      if (evaled_args_prev == NULL)
-	ret_temp = evaled_args;
-      else
-	evaled_args_prev->cdr = (struct astnode *) evaled_args;
+      TYPE_CHECK(body->cdr, TYPE_PAIR);
 
-      // Eval current argument and store in `evaled_args` list
-      RETONERR(eval((struct astnode *) unevaled_args->car, env, &evaled_args->car));
+      RETONERR(eval(body->car, env, &ret_temp));
     }
 
-  evaled_args_prev->cdr = (struct astnode *) EMPTY_LIST;
-  *ret = ret_temp;
+  *last = body->car;
 
   return 0;
 }
 
 // Two possibilities: (define a 3) or (+ 1 2)
-static int eval_pair(struct astnode_pair *node, struct astnode_env *env,
-		     struct astnode **ret)
+// When the value of `node` is the value of an expression in tail position (a
+// branch of an if, or the last expression of a compound procedure's body),
+// that expression is placed in `tail` and the environment it must be evaluated
+// in in `env`, and `ret` is left untouched. Otherwise `tail` is set to NULL.
+static int eval_pair(struct astnode_pair *node, struct astnode_env **env,
+		     struct astnode **tail, struct astnode **ret)
 {
   struct astnode *evaled_car;
 
+  *tail = NULL;
+
   // If empty list, evaluate to itself
   if (is_empty_list((struct astnode *)node))
     {
@@ -64,9 +86,9 @@ static int eval_pair(struct astnode_pair *node, struct astnode_env *env,
       return 0;
     }
 
-  RETONERR(eval(node->car, env, &evaled_car));
+  RETONERR(eval(node->car, *env, &evaled_car));
 
-  if (evaled_car->type == TYPE_KEYWORD)
+  if (astnode_type_of(evaled_car) == TYPE_KEYWORD)
     {
       struct astnode_pair *args;
       struct astnode_keyword *keyword;
@@ -75,78 +97,129 @@ static int eval_pair(struct astnode_pair *node, struct astnode_env *env,
       args = (struct astnode_pair *) node->cdr;
       keyword = (struct astnode_keyword *) evaled_car;
 
-      RETONERR(keyword->handler(args, env, ret));
+      if (keyword->handler == kw_if)
+	RETONERR(kw_if_branch(args, *env, tail));
+      else
+	RETONERR(keyword->handler(args, *env, ret));
     }
   else
     {
-      struct astnode_pair *evaled_args;
+      struct astnode_compproc *proc;
+      size_t base;
+      uint32_t nargs;
+      int err;
 
-      RETONERR(eval_list((struct astnode_pair *) node->cdr, env, &evaled_args));
-      RETONERR(apply(evaled_car, evaled_args, ret));
+      base = argstack_size();
+      err = eval_args((struct astnode_pair *) node->cdr, *env, &nargs);
+      if (err == 0)
+	{
+	  proc = (struct astnode_compproc *) evaled_car;
+	  if (astnode_type_of(evaled_car) == TYPE_COMPPROC &&
+	      proc->code == NULL && proc->exec == NULL)
+	    {
+	      // The frame gets a copy of the arguments, so they are off the
+	      // stack before the body runs.
+	      err = extend_env_array(proc->env, proc->params,
+				     argstack_from(base), nargs, env);
+	      argstack_truncate(base);
+	      if (err != 0)
+		return err;
+	      return eval_body_but_last(proc->body, *env, tail);
+	    }
+	  else
+	    err = apply_args(evaled_car, argstack_from(base), nargs, ret);
+	}
+
+      argstack_truncate(base);
+      if (err != 0)
+	return err;
     }
 
   return 0;
 }
 
-// TODO: To support tail calls, we can add a flag `istailcall`, which will get
-// passed down to apply (which will decide whether to extend the environment or
-// reuse the same frame). `eval_list` (called by compound procedures) will set
-// the flag only on the last call.
+// Expressions in tail position are evaluated by going around the loop again
+// with a new `node` and `env` rather than by recursing (see eval_pair), so
+// that tail calls run in constant C stack.
 int eval(struct astnode *node, struct astnode_env *env, struct astnode **ret)
 {
   int err;
+  astnode_type type;
 
   NULL_CHECK3(node, env, ret);
 
-  assert(node->type < TYPE_MAX);
-  switch (node->type)
+  if (eval_mode == EVAL_MODE_STACK)
+    return stackeval(node, env, ret);
+
+  for (;;)
     {
-      // Symbols evaluate to their binding in the environment
-    case TYPE_SYM:
-      err = lookup_env(env, (struct astnode_sym *) node, ret);
-      break;
-      // Integers evaluate to themselves
-    case TYPE_INT:
-      *ret = node;
-      err = 0;
-      break;
-      // Booleans evaluate to themselves
-    case TYPE_BOOLEAN:
-      *ret = node;
-      err = 0;
-      break;
-      // Only Well-formed lists evaluate to a procedure application or a special
-      // form handler.
-      // The empty list evaluates to itself
-    case TYPE_PAIR:
-      err = eval_pair((struct astnode_pair *)node, env, ret);
-      break;
-      // An environment evaluates to itself
-    case TYPE_ENV:
-      *ret = node;
-      err = 0;
-      break;
-      // Keywords are not expressions; it is an error to evaluate them
-    case TYPE_KEYWORD:
-      *ret = NULL;
-      err = EBADMSG;
-      break;
-      // Primitive procedures evaluate to themselves
-    case TYPE_PRMTPROC:
-      *ret = node;
-      err = 0;
-      break;
-    case TYPE_COMPPROC:
-      *ret = node;
-      err = 0;
-      break;
-      // To keep compiler happy
-    case TYPE_MAX:
-      err = EINVAL;
-      break;
-    }
+      type = astnode_type_of(node);
+      assert(type < TYPE_MAX);
+      switch (type)
+	{
+	  // Symbols evaluate to their binding in the environment
+	case TYPE_SYM:
+	  err = lookup_env(env, (struct astnode_sym *) node, ret);
+	  break;
+	  // Integers evaluate to themselves
+	case TYPE_INT:
+	  *ret = node;
+	  err = 0;
+	  break;
+	  // Booleans evaluate to themselves
+	case TYPE_BOOLEAN:
+	  *ret = node;
+	  err = 0;
+	  break;
+	  // Only Well-formed lists evaluate to a procedure application or a
+	  // special form handler.
+	  // The empty list evaluates to itself
+	case TYPE_PAIR:
+	  err = eval_pair((struct astnode_pair *)node, &env, &node, ret);
+	  if (err == 0 && node != NULL)
+	    continue;
+	  break;
+	  // An environment or a compiled or analyzed body evaluates to itself
+	case TYPE_CODE:
+	case TYPE_EXEC:
+	case TYPE_ENV:
+	  *ret = node;
+	  err = 0;
+	  break;
+	  // Keywords are not expressions; it is an error to evaluate them
+	case TYPE_KEYWORD:
+	  *ret = NULL;
+	  err = EBADMSG;
+	  break;
+	  // Primitive procedures evaluate to themselves
+	case TYPE_PRMTPROC:
+	  *ret = node;
+	  err = 0;
+	  break;
+	case TYPE_COMPPROC:
+	case TYPE_CONT:
+	  *ret = node;
+	  err = 0;
+	  break;
+	  // Vectors evaluate to themselves
+	case TYPE_VECTOR:
+	case TYPE_NUMVECTOR:
+	  *ret = node;
+	  err = 0;
+	  break;
+	  // Resolved local variables are fetched straight from their frame
+	case TYPE_LEXADDR:
+	  err = lookup_lexaddr(env, ((struct astnode_lexaddr *) node)->depth,
+			       ((struct astnode_lexaddr *) node)->index, ret);
+	  break;
+	  // To keep compiler happy
+	case TYPE_MAX:
+	  err = EINVAL;
+	  break;
+	}
 
-  return err;
+      return err;
+    }
 }
 
 int eval_many(struct astnode_pair *stmts, struct astnode_env *env,
@@ -175,14 +248,26 @@ int eval_many(struct astnode_pair *stmts, struct astnode_env *env,
   return 0;
 }
 
-int apply(struct astnode *proc, struct astnode_pair *args, struct astnode **ret)
+int apply_args(struct astnode *proc, struct astnode **args, uint32_t nargs,
+	       struct astnode **ret)
 {
-  NULL_CHECK2(proc, args);
+  NULL_CHECK2(proc, ret);
+  if (args == NULL && nargs > 0)
+    return EINVAL;
+
+  // Calling a continuation only returns on error
+  if (astnode_type_of(proc) == TYPE_CONT)
+    {
+      if (nargs != 1)
+	return EBADMSG;
+      return cont_throw((struct astnode_cont *) proc, args[0]);
+    }
 
   TYPE_CHECK2(proc, TYPE_PRMTPROC, TYPE_COMPPROC);
   if (proc->type == TYPE_PRMTPROC)
     {
-      RETONERR(((struct astnode_prmtproc *) proc)->handler(args, ret));
+      RETONERR(prmt_apply(((struct astnode_prmtproc *) proc)->desc, args,
+			  nargs, ret));
     }
   else
     {
@@ -190,10 +275,42 @@ int apply(struct astnode *proc, struct astnode_pair *args, struct astnode **ret)
       struct astnode_env *extended_env;
 
       compound_proc = (struct astnode_compproc *) proc;
-      RETONERR(extend_env(compound_proc->env, compound_proc->params, args,
-			  &extended_env));
+      if (compound_proc->code != NULL)
+	return vm_apply(compound_proc, args, nargs, ret);
+      if (compound_proc->exec != NULL)
+	return exec_apply(compound_proc, args, nargs, ret);
+
+      RETONERR(extend_env_array(compound_proc->env, compound_proc->params,
+				args, nargs, &extended_env));
       RETONERR(eval_many(compound_proc->body, extended_env, ret));
     }
 
   return 0;
 }
+
+int apply(struct astnode *proc, struct astnode_pair *args, struct astnode **ret)
+{
+  size_t base;
+  uint32_t nargs;
+  int err;
+
+  NULL_CHECK3(proc, args, ret);
+
+  base = argstack_size();
+  for (nargs = 0, err = 0;
+       err == 0 && !is_empty_list((struct astnode *) args);
+       args = (struct astnode_pair *) args->cdr, nargs++)
+    {
+      if (astnode_type_of((struct astnode *) args) != TYPE_PAIR)
+	err = EBADMSG;
+      else
+	err = argstack_push(args->car);
+    }
+
+  if (err == 0)
+    err = apply_args(proc, argstack_from(base), nargs, ret);
+
+  argstack_truncate(base);
+
+  return err;
+}
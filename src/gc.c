@@ -1,76 +1,1550 @@
 #include <assert.h>
 #include <errno.h>
+#include <setjmp.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "inc/ast.h"
 #include "inc/gc.h"
 #include "inc/stdmacros.h"
 
-// This will be implemented as a mark and sweep GC. All astnodes will begin with
-// an object signature, and contain a "live" bit and a size parameter. When an
-// astnode is allocated and there is no more room in the heap, the following
-// happens:
+// Mark and sweep GC over a size-segregated heap.
+//
+// The heap is made of fixed-size, aligned pages. Each page belongs to one size
+// class and is carved into objects of that size, first with a bump pointer and
+// then, once objects start dying, through the size class' free list. Pairs,
+// environments and the other small nodes of the same size thus end up packed
+// next to each other, without any per-object header: the "allocated" and
+// "live" bits of the objects of a page are kept in two bitmaps at the start of
+// the page.
+//
+// When an astnode is allocated and its size class has neither a free object
+// nor room left in its current page, we collect if the heap has grown past the
+// collection threshold, and take a fresh page otherwise.
+//
+// Objects bigger than the largest size class (e.g. long vectors) are large
+// objects: each one gets a block of its own from malloc, with a small header
+// holding its size and live bit. The blocks are kept in an array sorted by
+// address, so that a pointer into one of them can be found by binary search,
+// and the blocks of dead objects are freed by the sweep.
 //
 // MARK PHASE
 // 1. For all roots, go to their location in memory.
 // 2. Set the "live" bit.
 // 3. Depending on the object's type (astnode.type), follow any link. (e.g. for
-// a pair, follow car and cdr pointers). (Note: currently, empty_list is a
-// variable in the data area i.e. outside the gc heap. Just something to keep in
-// mind).
+// a pair, follow car and cdr pointers). Links to objects outside the heap
+// (e.g. empty_list, which is a variable in the data area, or nodes that tests
+// build on the stack) are not followed.
 //
 // SWEEP PHASE
-// Start at the bottom of the heap. Begin a "free block". Scan until an object
-// signature is found (this delimits the end of the free block). Jump over the
-// object (using the size parameter in the header). Repeat, linking this new
-// free block with the previous one.
+// For each page, the live bits become the allocated bits, and every object
+// that isn't live is put back on the free list of its size class, in address
+// order. Pages left without a single live object are given back to the pool of
+// free pages, where any size class can pick them up.
 //
-// Note: the roots are all bindings in the top-level environment, as all
-// pointers on the C stack (anything that looks like a pointer in the gc heap
-// can be confirmed by making sure what it points to has a valid signature).
-int alloc_astnode(astnode_type type, struct astnode **ret)
+// Note: the roots are the objects registered with gc_add_root (the top-level
+// environment), the arrays registered with gc_add_root_array (the VM stack), as
+// well as all pointers on the C stack. Anything that looks
+// like a pointer in the gc heap is confirmed by looking up the page it points
+// into and the allocated bit of the object, so stale words on the stack can at
+// worst retain garbage, never corrupt the heap.
+
+#define GRANULE ((size_t) 8)
+#define PAGE_SIZE ((size_t) 1 << 16)
+#define PAGE_MAX_OBJS (PAGE_SIZE / GRANULE)
+#define NSIZE_CLASSES 24
+
+// The first NFIXED_CLASSES size classes are 1, 2, ... NFIXED_CLASSES granules
+// big, which is enough for every astnode type but environment frames with
+// slots (see alloc_astnode_sized). The other classes grow geometrically.
+#define NFIXED_CLASSES 8
+
+// A collection runs once the objects in use (those that survived the last
+// one plus those allocated since) reach GROWTH_FACTOR times what survived the
+// last one, and at least INITIAL_THRESHOLD bytes. The size of the heap doesn't
+// matter: freed pages stay in it, so it never goes back under the threshold.
+#define INITIAL_THRESHOLD ((size_t) 1 << 20)
+#define GROWTH_FACTOR 2
+
+struct gc_free_obj {
+  struct gc_free_obj *next;
+};
+
+struct gc_size_class;
+
+struct gc_page {
+  struct gc_size_class *class;	// NULL if the page is in the free page pool
+  size_t nobjs;			// Number of objects that fit in the page
+  size_t nbumped;		// Objects handed out by the bump pointer so far
+  size_t nlive;
+  struct gc_page *next_free;	// Link in the free page pool
+  uint64_t alloc_bits[PAGE_MAX_OBJS / 64];
+  uint64_t mark_bits[PAGE_MAX_OBJS / 64];
+  char objects[];
+};
+
+struct gc_size_class {
+  size_t obj_size;
+  struct gc_page *page;		// Page currently being bump allocated
+  struct gc_free_obj *free_list;
+};
+
+static struct gc_size_class classes[NSIZE_CLASSES] = {
+  { .obj_size = 1 * GRANULE },
+  { .obj_size = 2 * GRANULE },
+  { .obj_size = 3 * GRANULE },
+  { .obj_size = 4 * GRANULE },
+  { .obj_size = 5 * GRANULE },
+  { .obj_size = 6 * GRANULE },
+  { .obj_size = 7 * GRANULE },
+  { .obj_size = 8 * GRANULE },
+  { .obj_size = 12 * GRANULE },
+  { .obj_size = 16 * GRANULE },
+  { .obj_size = 24 * GRANULE },
+  { .obj_size = 32 * GRANULE },
+  { .obj_size = 48 * GRANULE },
+  { .obj_size = 64 * GRANULE },
+  { .obj_size = 96 * GRANULE },
+  { .obj_size = 128 * GRANULE },
+  { .obj_size = 192 * GRANULE },
+  { .obj_size = 256 * GRANULE },
+  { .obj_size = 384 * GRANULE },
+  { .obj_size = 512 * GRANULE },
+  { .obj_size = 768 * GRANULE },
+  { .obj_size = 1024 * GRANULE },
+  { .obj_size = 1536 * GRANULE },
+  { .obj_size = 2048 * GRANULE },
+};
+
+_Static_assert(GC_MAX_OBJ_SIZE == 2048 * GRANULE,
+	       "GC_MAX_OBJ_SIZE must be the size of the largest size class");
+
+#define ROUND_GRANULES(sz) (((sz) + GRANULE - 1) / GRANULE)
+
+// Size class index of each type. TYPE_INT and TYPE_BOOLEAN have none: integers
+// are fixnums, and booleans are the two static objects of inc/ast.h.
+static const uint8_t type_classes[TYPE_MAX] = {
+  [TYPE_SYM] = ROUND_GRANULES(sizeof(struct astnode_sym)) - 1,
+  [TYPE_PAIR] = ROUND_GRANULES(sizeof(struct astnode_pair)) - 1,
+  [TYPE_ENV] = ROUND_GRANULES(sizeof(struct astnode_env)) - 1,
+  [TYPE_KEYWORD] = ROUND_GRANULES(sizeof(struct astnode_keyword)) - 1,
+  [TYPE_PRMTPROC] = ROUND_GRANULES(sizeof(struct astnode_prmtproc)) - 1,
+  [TYPE_COMPPROC] = ROUND_GRANULES(sizeof(struct astnode_compproc)) - 1,
+  [TYPE_LEXADDR] = ROUND_GRANULES(sizeof(struct astnode_lexaddr)) - 1,
+  [TYPE_CODE] = ROUND_GRANULES(sizeof(struct astnode_code)) - 1,
+  [TYPE_EXEC] = ROUND_GRANULES(sizeof(struct astnode_exec)) - 1,
+  [TYPE_CONT] = ROUND_GRANULES(sizeof(struct astnode_cont)) - 1,
+  [TYPE_VECTOR] = ROUND_GRANULES(sizeof(struct astnode_vector)) - 1,
+  [TYPE_NUMVECTOR] = ROUND_GRANULES(sizeof(struct astnode_numvector)) - 1,
+};
+
+_Static_assert(sizeof(struct astnode_compproc) <= NFIXED_CLASSES * GRANULE &&
+	       sizeof(struct astnode_env) <= NFIXED_CLASSES * GRANULE,
+	       "Largest astnode does not fit in any fixed size class");
+
+// Sorted by address.
+static struct gc_page **pages;
+static size_t npages;
+static size_t pages_cap;
+
+static struct gc_page *free_pages;
+
+static size_t next_collection = INITIAL_THRESHOLD;
+
+static struct astnode **roots;
+static size_t nroots;
+static size_t roots_cap;
+
+struct gc_root_array {
+  struct astnode ***array;
+  size_t *len;
+};
+
+static struct gc_root_array *root_arrays;
+static size_t nroot_arrays;
+static size_t root_arrays_cap;
+
+struct gc_large {
+  size_t size;			// Size of the object
+  bool marked;
+  _Alignas(GRANULE) char object[];
+};
+
+_Static_assert(offsetof(struct gc_large, object) % GRANULE == 0,
+	       "Large objects must be aligned like the others");
+
+// Sorted by address.
+static struct gc_large **large_objs;
+static size_t nlarge;
+static size_t large_cap;
+
+static struct astnode **mark_stack;
+static size_t mark_stack_len;
+static size_t mark_stack_cap;
+static bool mark_stack_overflowed;
+
+static struct gc_stats stats;
+
+// Provided by glibc: the highest address of the main thread's stack.
+extern void *__libc_stack_end;
+
+// *******************************************************
+// Pages
+// *******************************************************
+
+static bool test_bit(const uint64_t *bits, size_t i)
 {
-  struct astnode *new_node;
+  return (bits[i / 64] & ((uint64_t) 1 << (i % 64))) != 0;
+}
 
-  NULL_CHECK1(ret);
+static void set_bit(uint64_t *bits, size_t i)
+{
+  bits[i / 64] |= (uint64_t) 1 << (i % 64);
+}
 
-  assert(type < TYPE_MAX);
-  switch (type)
+static struct gc_page *page_of(const void *ptr)
+{
+  return (struct gc_page *) ((uintptr_t) ptr & ~(uintptr_t) (PAGE_SIZE - 1));
+}
+
+// Returns true if `page` is one of ours. Pages are aligned on PAGE_SIZE, so
+// page_of gives the only candidate for any pointer.
+static bool is_heap_page(const struct gc_page *page)
+{
+  size_t lo = 0;
+  size_t hi = npages;
+
+  while (lo < hi)
     {
-    case TYPE_SYM:
-      new_node = malloc(sizeof(struct astnode_sym));
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (page < pages[mid])
+	hi = mid;
+      else if (page > pages[mid])
+	lo = mid + 1;
+      else
+	return true;
+    }
+
+  return false;
+}
+
+// Returns the index of the allocated object containing `ptr` (which may point
+// anywhere inside the object) in its page, or -1 if there is none.
+static ptrdiff_t find_object(struct gc_page *page, const void *ptr)
+{
+  size_t offset;
+  size_t i;
+
+  if (page->class == NULL || (const char *) ptr < page->objects)
+    return -1;
+
+  offset = (const char *) ptr - page->objects;
+  i = offset / page->class->obj_size;
+  if (i >= page->nbumped || !test_bit(page->alloc_bits, i))
+    return -1;
+
+  return i;
+}
+
+// Returns the large object containing `ptr`, or NULL if there is none.
+static struct gc_large *find_large(const void *ptr)
+{
+  size_t lo = 0;
+  size_t hi = nlarge;
+
+  // Find the last block starting at or before `ptr`
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if ((const void *) large_objs[mid]->object <= ptr)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+  if (lo == 0)
+    return NULL;
+  if ((const char *) ptr >= large_objs[lo - 1]->object + large_objs[lo - 1]->size)
+    return NULL;
+
+  return large_objs[lo - 1];
+}
+
+static int new_page(struct gc_page **ret)
+{
+  struct gc_page *page;
+  void *mem;
+  size_t i;
+
+  if (free_pages != NULL)
+    {
+      *ret = free_pages;
+      free_pages = free_pages->next_free;
+      return 0;
+    }
+
+  if (npages == pages_cap)
+    {
+      struct gc_page **new_pages;
+      size_t new_cap;
+
+      new_cap = pages_cap == 0 ? 64 : pages_cap * 2;
+      new_pages = realloc(pages, new_cap * sizeof(*pages));
+      if (new_pages == NULL)
+	return ENOMEM;
+      pages = new_pages;
+      pages_cap = new_cap;
+    }
+
+  if (posix_memalign(&mem, PAGE_SIZE, PAGE_SIZE) != 0)
+    return ENOMEM;
+  page = mem;
+  page->class = NULL;
+
+  // Keep the page array sorted for is_heap_page.
+  for (i = npages; i > 0 && pages[i - 1] > page; i--)
+    pages[i] = pages[i - 1];
+  pages[i] = page;
+  npages++;
+
+  stats.heap_size += PAGE_SIZE;
+
+  *ret = page;
+  return 0;
+}
+
+static void assign_page(struct gc_page *page, struct gc_size_class *class)
+{
+  page->class = class;
+  page->nobjs = (PAGE_SIZE - offsetof(struct gc_page, objects)) / class->obj_size;
+  page->nbumped = 0;
+  page->nlive = 0;
+  page->next_free = NULL;
+  memset(page->alloc_bits, 0, sizeof(page->alloc_bits));
+  memset(page->mark_bits, 0, sizeof(page->mark_bits));
+
+  class->page = page;
+}
+
+// *******************************************************
+// Mark phase
+// *******************************************************
+
+static void push_mark_stack(struct astnode *node)
+{
+  if (mark_stack_len == mark_stack_cap)
+    {
+      struct astnode **new_stack;
+      size_t new_cap;
+
+      new_cap = mark_stack_cap == 0 ? 1024 : mark_stack_cap * 2;
+      new_stack = realloc(mark_stack, new_cap * sizeof(*mark_stack));
+      if (new_stack == NULL)
+	{
+	  mark_stack_overflowed = true;
+	  return;
+	}
+      mark_stack = new_stack;
+      mark_stack_cap = new_cap;
+    }
+
+  mark_stack[mark_stack_len++] = node;
+}
+
+// Marks the object `ptr` points into, if it is in the heap.
+static void mark_ptr(const void *ptr)
+{
+  struct gc_page *page;
+  ptrdiff_t i;
+
+  if (ptr == NULL || is_fixnum(ptr))
+    return;
+
+  page = page_of(ptr);
+  if (!is_heap_page(page))
+    {
+      struct gc_large *large;
+
+      large = nlarge == 0 ? NULL : find_large(ptr);
+      if (large == NULL || large->marked)
+	return;
+
+      large->marked = true;
+      push_mark_stack((struct astnode *) large->object);
+      return;
+    }
+
+  i = find_object(page, ptr);
+  if (i < 0 || test_bit(page->mark_bits, i))
+    return;
+
+  set_bit(page->mark_bits, i);
+  page->nlive++;
+  push_mark_stack((struct astnode *) (page->objects + i * page->class->obj_size));
+}
+
+static void mark_children(struct astnode *node)
+{
+  switch (node->type)
+    {
+    case TYPE_PAIR:
+      mark_ptr(((struct astnode_pair *) node)->car);
+      mark_ptr(((struct astnode_pair *) node)->cdr);
       break;
-    case TYPE_INT:
-      new_node = malloc(sizeof(struct astnode_int));
+    case TYPE_ENV:
+      {
+	struct astnode_env *env = (struct astnode_env *) node;
+	uint32_t i;
+
+	mark_ptr(env->parent);
+	mark_ptr(env->params);
+	mark_ptr(env->bindings);
+	for (i = 0; i < env->nslots; i++)
+	  mark_ptr(env->slots[i]);
+	if (env->globals != NULL)
+	  {
+	    for (i = 0; i < env->globals->cap; i++)
+	      mark_ptr(env->globals->values[i]);
+	  }
+      }
+      break;
+    case TYPE_COMPPROC:
+      mark_ptr(((struct astnode_compproc *) node)->body);
+      mark_ptr(((struct astnode_compproc *) node)->env);
+      mark_ptr(((struct astnode_compproc *) node)->params);
+      mark_ptr(((struct astnode_compproc *) node)->code);
+      mark_ptr(((struct astnode_compproc *) node)->exec);
+      break;
+    case TYPE_CODE:
+      {
+	struct astnode_code *code = (struct astnode_code *) node;
+	uint32_t i;
+
+	for (i = 0; i < code->nconsts; i++)
+	  mark_ptr(code->consts[i]);
+      }
+      break;
+    case TYPE_EXEC:
+      {
+	struct astnode_exec *exec = (struct astnode_exec *) node;
+	uint32_t i;
+
+	for (i = 0; i < exec->nops; i++)
+	  mark_ptr(exec->ops[i]);
+      }
+      break;
+    case TYPE_LEXADDR:
+      mark_ptr(((struct astnode_lexaddr *) node)->sym);
       break;
+    case TYPE_CONT:
+      mark_ptr(((struct astnode_cont *) node)->prev);
+      mark_ptr(((struct astnode_cont *) node)->frames);
+      break;
+    case TYPE_VECTOR:
+      {
+	struct astnode_vector *vector = (struct astnode_vector *) node;
+	uint32_t i;
+
+	for (i = 0; i < vector->len; i++)
+	  mark_ptr(vector->elts[i]);
+      }
+      break;
+    case TYPE_SYM:
+    case TYPE_INT:
     case TYPE_BOOLEAN:
-      new_node = malloc(sizeof(struct astnode_boolean));
+    case TYPE_KEYWORD:
+    case TYPE_PRMTPROC:
+    case TYPE_NUMVECTOR:
+    case TYPE_MAX:
       break;
+    }
+}
+
+static void drain_mark_stack(void)
+{
+  while (mark_stack_len > 0)
+    mark_children(mark_stack[--mark_stack_len]);
+}
+
+static void scan_range(void **lo, void **hi)
+{
+  for ( ; lo < hi; lo++)
+    mark_ptr(*lo);
+}
+
+// Must not be inlined: its frame has to sit below the frames of all its
+// callers for them to be scanned.
+static __attribute__((noinline)) void scan_stack(void)
+{
+  jmp_buf regs;
+
+  // Spill callee-saved registers on the stack so that pointers only held in
+  // registers are seen too.
+  __builtin_unwind_init();
+  setjmp(regs);
+
+  scan_range((void **) &regs, (void **) __libc_stack_end);
+}
+
+// *******************************************************
+// Sweep phase
+// *******************************************************
+
+static void sweep_large(void)
+{
+  size_t i;
+  size_t nlive;
+
+  for (i = 0, nlive = 0; i < nlarge; i++)
+    {
+      struct gc_large *large = large_objs[i];
+
+      if (!large->marked)
+	{
+	  stats.heap_size -= large->size;
+	  free(large);
+	  continue;
+	}
+
+      large->marked = false;
+      stats.bytes_in_use += large->size;
+      large_objs[nlive++] = large;
+    }
+
+  nlarge = nlive;
+}
+
+static void sweep(void)
+{
+  size_t i;
+
+  for (i = 0; i < NSIZE_CLASSES; i++)
+    classes[i].free_list = NULL;
+  stats.bytes_in_use = 0;
+
+  // Walk the pages backwards, pushing free objects in reverse, so that the
+  // free lists end up in address order.
+  for (i = npages; i > 0; i--)
+    {
+      struct gc_page *page = pages[i - 1];
+      struct gc_size_class *class = page->class;
+      size_t j;
+
+      if (class == NULL)
+	continue;
+
+      if (page->nlive == 0)
+	{
+	  if (class->page == page)
+	    class->page = NULL;
+	  page->class = NULL;
+	  page->next_free = free_pages;
+	  free_pages = page;
+	  continue;
+	}
+
+      memcpy(page->alloc_bits, page->mark_bits, sizeof(page->alloc_bits));
+      memset(page->mark_bits, 0, sizeof(page->mark_bits));
+
+      for (j = page->nbumped; j > 0; j--)
+	{
+	  if (!test_bit(page->alloc_bits, j - 1))
+	    {
+	      struct gc_free_obj *obj;
+
+	      obj = (struct gc_free_obj *) (page->objects +
+					    (j - 1) * class->obj_size);
+	      obj->next = class->free_list;
+	      class->free_list = obj;
+	    }
+	}
+
+      stats.bytes_in_use += page->nlive * class->obj_size;
+      page->nlive = 0;
+    }
+
+  sweep_large();
+}
+
+// Only used when marking had to be aborted.
+static void clear_marks(void)
+{
+  size_t i;
+
+  for (i = 0; i < npages; i++)
+    {
+      memset(pages[i]->mark_bits, 0, sizeof(pages[i]->mark_bits));
+      pages[i]->nlive = 0;
+    }
+
+  for (i = 0; i < nlarge; i++)
+    large_objs[i]->marked = false;
+}
+
+// *******************************************************
+// Public interface
+// *******************************************************
+
+int gc_collect(void)
+{
+  size_t i;
+
+  mark_stack_overflowed = false;
+
+  for (i = 0; i < nroots; i++)
+    mark_ptr(roots[i]);
+  for (i = 0; i < nroot_arrays; i++)
+    {
+      if (*root_arrays[i].array != NULL)
+	scan_range((void **) *root_arrays[i].array,
+		   (void **) *root_arrays[i].array + *root_arrays[i].len);
+    }
+  scan_stack();
+  drain_mark_stack();
+
+  if (mark_stack_overflowed)
+    {
+      mark_stack_len = 0;
+      clear_marks();
+      return ENOMEM;
+    }
+
+  sweep();
+  stats.ncollections++;
+
+  next_collection = stats.bytes_in_use * GROWTH_FACTOR;
+  if (next_collection < INITIAL_THRESHOLD)
+    next_collection = INITIAL_THRESHOLD;
+
+  return 0;
+}
+
+int gc_add_root(struct astnode *root)
+{
+  NULL_CHECK1(root);
+
+  if (nroots == roots_cap)
+    {
+      struct astnode **new_roots;
+      size_t new_cap;
+
+      new_cap = roots_cap == 0 ? 16 : roots_cap * 2;
+      new_roots = realloc(roots, new_cap * sizeof(*roots));
+      if (new_roots == NULL)
+	return ENOMEM;
+      roots = new_roots;
+      roots_cap = new_cap;
+    }
+
+  roots[nroots++] = root;
+
+  return 0;
+}
+
+int gc_add_root_array(struct astnode ***array, size_t *len)
+{
+  NULL_CHECK2(array, len);
+
+  if (nroot_arrays == root_arrays_cap)
+    {
+      struct gc_root_array *new_arrays;
+      size_t new_cap;
+
+      new_cap = root_arrays_cap == 0 ? 4 : root_arrays_cap * 2;
+      new_arrays = realloc(root_arrays, new_cap * sizeof(*root_arrays));
+      if (new_arrays == NULL)
+	return ENOMEM;
+      root_arrays = new_arrays;
+      root_arrays_cap = new_cap;
+    }
+
+  root_arrays[nroot_arrays].array = array;
+  root_arrays[nroot_arrays].len = len;
+  nroot_arrays++;
+
+  return 0;
+}
+
+void gc_get_stats(struct gc_stats *ret)
+{
+  assert(ret != NULL);
+
+  *ret = stats;
+}
+
+// Whether allocating `size` more bytes should run a collection first.
+static bool should_collect(size_t size)
+{
+  return stats.bytes_in_use + size >= next_collection;
+}
+
+// Called when `class` has no free object and its current page is full.
+static int alloc_slow(struct gc_size_class *class, void **ret)
+{
+  struct gc_page *page;
+
+  // A failed collection simply means we'll have to grow the heap.
+  if (should_collect(class->obj_size) && gc_collect() == 0 &&
+      class->free_list != NULL)
+    {
+      *ret = class->free_list;
+      class->free_list = class->free_list->next;
+      return 0;
+    }
+
+  // The collection may have given the current page back to the pool.
+  page = class->page;
+  if (page == NULL || page->nbumped == page->nobjs)
+    {
+      RETONERR(new_page(&page));
+      assign_page(page, class);
+    }
+
+  *ret = page->objects + page->nbumped++ * class->obj_size;
+  return 0;
+}
+
+static int alloc_in_class(astnode_type type, struct gc_size_class *class,
+			  struct astnode **ret)
+{
+  struct gc_page *page;
+  void *obj;
+  size_t i;
+
+  if (class->free_list != NULL)
+    {
+      obj = class->free_list;
+      class->free_list = class->free_list->next;
+    }
+  else if (class->page != NULL && class->page->nbumped < class->page->nobjs)
+    {
+      page = class->page;
+      obj = page->objects + page->nbumped++ * class->obj_size;
+    }
+  else
+    {
+      RETONERR(alloc_slow(class, &obj));
+    }
+
+  page = page_of(obj);
+  i = ((char *) obj - page->objects) / class->obj_size;
+  set_bit(page->alloc_bits, i);
+
+  stats.bytes_in_use += class->obj_size;
+  stats.nallocs++;
+
+  // The object may be reachable (and thus traced) before its fields are all
+  // initialized, so it must not contain stale pointers.
+  memset(obj, 0, class->obj_size);
+  (*ret) = obj;
+  (*ret)->type = type;
+
+  return 0;
+}
+
+static int alloc_large(astnode_type type, size_t size, struct astnode **ret)
+{
+  struct gc_large *large;
+  size_t i;
+
+  // A failed collection simply means we'll have to grow the heap.
+  if (should_collect(size))
+    gc_collect();
+
+  if (nlarge == large_cap)
+    {
+      struct gc_large **new_objs;
+      size_t new_cap;
+
+      new_cap = large_cap == 0 ? 16 : large_cap * 2;
+      new_objs = realloc(large_objs, new_cap * sizeof(*large_objs));
+      if (new_objs == NULL)
+	return ENOMEM;
+      large_objs = new_objs;
+      large_cap = new_cap;
+    }
+
+  // Zeroed, for the same reason as in alloc_in_class
+  if (size > SIZE_MAX - sizeof(*large))
+    return ENOMEM;
+  large = calloc(1, sizeof(*large) + size);
+  if (large == NULL)
+    return ENOMEM;
+  large->size = size;
+
+  for (i = nlarge; i > 0 && large_objs[i - 1] > large; i--)
+    large_objs[i] = large_objs[i - 1];
+  large_objs[i] = large;
+  nlarge++;
+
+  stats.heap_size += size;
+  stats.bytes_in_use += size;
+  stats.nallocs++;
+
+  *ret = (struct astnode *) large->object;
+  (*ret)->type = type;
+
+  return 0;
+}
+
+int alloc_astnode(astnode_type type, struct astnode **ret)
+{
+  NULL_CHECK1(ret);
+
+  assert(type < TYPE_MAX);
+  if (type >= TYPE_MAX || type == TYPE_INT || type == TYPE_BOOLEAN)
+    return EINVAL;
+
+  return alloc_in_class(type, &classes[type_classes[type]], ret);
+}
+
+int alloc_astnode_sized(astnode_type type, size_t size, struct astnode **ret)
+{
+  size_t i;
+
+  NULL_CHECK1(ret);
+
+  assert(type < TYPE_MAX);
+  if (type >= TYPE_MAX || type == TYPE_INT || type == TYPE_BOOLEAN)
+    return EINVAL;
+
+  for (i = 0; i < NSIZE_CLASSES; i++)
+    {
+      if (classes[i].obj_size >= size)
+	return alloc_in_class(type, &classes[i], ret);
+    }
+
+  return alloc_large(type, size, ret);
+}
+
+// *******************************************************
+// Heap images
+// *******************************************************
+
+// An image is made of:
+// 1. The pages holding objects reachable from the root, each as it is in
+// memory, except that only the reachable objects are marked allocated.
+// 2. The address each page had, in the same (increasing) order.
+// 3. The blocks: the large objects reachable from the root, and the globals of
+// the top-level environments, each a struct gc_image_block followed by its
+// contents, padded to a whole number of granules.
+// 4. A struct gc_image_trailer.
+// Pages come first, so that they are aligned whenever the image is. Pointers
+// are stored as they were when the image was written: loading adjusts those
+// into pages by where the image is, those into blocks by where their copies
+// are, and those into the executable (static objects, handlers and primitive
+// descriptors) by where it is loaded now.
+
+#define IMAGE_MAGIC UINT64_C(0x70616568736a6373)	// "scjsheap"
+
+enum gc_block_kind {
+  BLOCK_LARGE,
+  BLOCK_GLOBALS,
+};
+
+struct gc_image_block {
+  uint64_t kind;
+  uint64_t size;		// Size of the contents
+  uint64_t addr;		// Address of the contents when written
+};
+
+struct gc_image_trailer {
+  uint64_t magic;
+  uint64_t npages;
+  uint64_t nblocks;
+  uint64_t exec_start;		// Where the executable was loaded...
+  uint64_t exec_size;		// ... and its size, to check it's the same
+  uint64_t empty_list;		// EMPTY_LIST, same
+  uint64_t root;
+};
+
+// Provided by the linker: the bounds of the executable in memory.
+extern char __executable_start[];
+extern char _end[];
+
+// A block of the image being loaded, and where its copy is.
+struct gc_loaded_block {
+  enum gc_block_kind kind;
+  uintptr_t addr;
+  uint64_t size;
+  void *copy;
+};
+
+// Where the objects of the image being loaded (or written) were, and where
+// they are now.
+struct gc_image_map {
+  const uint64_t *page_addrs;
+  size_t npages;
+  char *pages;
+  struct gc_loaded_block *blocks;	// Sorted by address
+  size_t nblocks;
+  uintptr_t exec_start;
+  uintptr_t exec_end;
+};
+
+typedef int (*field_visitor)(void *field, struct gc_image_map *map);
+
+static uintptr_t read_field(const void *field)
+{
+  uintptr_t val;
+
+  memcpy(&val, field, sizeof(val));
+  return val;
+}
+
+static void write_field(void *field, uintptr_t val)
+{
+  memcpy(field, &val, sizeof(val));
+}
+
+// Calls `visit` on the address of every pointer field of `node`: the ones
+// mark_children follows, plus the handlers and descriptors, which point into
+// the executable. The globals of environments and the escapes of continuations
+// are left to the caller.
+static int visit_fields(struct astnode *node, field_visitor visit,
+			struct gc_image_map *map)
+{
+  uint32_t i;
+
+#define VISIT(field) RETONERR(visit(&(field), map))
+
+  switch (node->type)
+    {
     case TYPE_PAIR:
-      new_node = malloc(sizeof(struct astnode_pair));
+      VISIT(((struct astnode_pair *) node)->car);
+      VISIT(((struct astnode_pair *) node)->cdr);
       break;
     case TYPE_ENV:
-      new_node = malloc(sizeof(struct astnode_env));
+      {
+	struct astnode_env *env = (struct astnode_env *) node;
+
+	VISIT(env->parent);
+	VISIT(env->params);
+	VISIT(env->bindings);
+	for (i = 0; i < env->nslots; i++)
+	  VISIT(env->slots[i]);
+      }
       break;
     case TYPE_KEYWORD:
-      new_node = malloc(sizeof(struct astnode_keyword));
+      VISIT(((struct astnode_keyword *) node)->handler);
       break;
     case TYPE_PRMTPROC:
-      new_node = malloc(sizeof(struct astnode_prmtproc));
+      VISIT(((struct astnode_prmtproc *) node)->desc);
       break;
     case TYPE_COMPPROC:
-      new_node = malloc(sizeof(struct astnode_compproc));
+      VISIT(((struct astnode_compproc *) node)->body);
+      VISIT(((struct astnode_compproc *) node)->env);
+      VISIT(((struct astnode_compproc *) node)->params);
+      VISIT(((struct astnode_compproc *) node)->code);
+      VISIT(((struct astnode_compproc *) node)->exec);
+      break;
+    case TYPE_CODE:
+      {
+	struct astnode_code *code = (struct astnode_code *) node;
+
+	for (i = 0; i < code->nconsts; i++)
+	  VISIT(code->consts[i]);
+      }
+      break;
+    case TYPE_EXEC:
+      {
+	struct astnode_exec *exec = (struct astnode_exec *) node;
+
+	VISIT(exec->handler);
+	for (i = 0; i < exec->nops; i++)
+	  VISIT(exec->ops[i]);
+      }
+      break;
+    case TYPE_LEXADDR:
+      VISIT(((struct astnode_lexaddr *) node)->sym);
+      break;
+    case TYPE_CONT:
+      VISIT(((struct astnode_cont *) node)->prev);
+      VISIT(((struct astnode_cont *) node)->frames);
       break;
+    case TYPE_VECTOR:
+      {
+	struct astnode_vector *vector = (struct astnode_vector *) node;
+
+	for (i = 0; i < vector->len; i++)
+	  VISIT(vector->elts[i]);
+      }
+      break;
+    case TYPE_SYM:
+    case TYPE_NUMVECTOR:
+      break;
+    case TYPE_INT:
+    case TYPE_BOOLEAN:
     case TYPE_MAX:
-      // Compiler happy
+    default:
       return EINVAL;
     }
 
-  if (new_node == NULL)
+#undef VISIT
+
+  return 0;
+}
+
+// Accepts the pointers an image can hold. `map` holds the bounds of the
+// executable.
+static int check_field(void *field, struct gc_image_map *map)
+{
+  uintptr_t ptr = read_field(field);
+
+  if (ptr == 0 || is_fixnum((struct astnode *) ptr))
+    return 0;
+  if (ptr >= map->exec_start && ptr < map->exec_end)
+    return 0;
+  if (is_heap_page(page_of((void *) ptr)))
+    return 0;
+  if (nlarge > 0 && find_large((void *) ptr) != NULL)
+    return 0;
+
+  return ENOTSUP;
+}
+
+static int write_all(FILE *file, const void *buf, size_t size)
+{
+  return fwrite(buf, 1, size, file) == size ? 0 : EIO;
+}
+
+static int write_block(FILE *file, enum gc_block_kind kind, const void *data,
+		       size_t size)
+{
+  static const char padding[GRANULE];
+  struct gc_image_block block;
+
+  block.kind = kind;
+  block.size = size;
+  block.addr = (uintptr_t) data;
+  RETONERR(write_all(file, &block, sizeof(block)));
+  RETONERR(write_all(file, data, size));
+
+  return write_all(file, padding, ROUND_GRANULES(size) * GRANULE - size);
+}
+
+// Writes a copy of `page` in which the objects marked live are the allocated
+// ones, and checks their fields.
+static int write_page(FILE *file, struct gc_page *page, struct gc_page *copy,
+		      struct gc_image_map *map)
+{
+  size_t i;
+
+  memcpy(copy, page, PAGE_SIZE);
+  memcpy(copy->alloc_bits, page->mark_bits, sizeof(copy->alloc_bits));
+  memset(copy->mark_bits, 0, sizeof(copy->mark_bits));
+  copy->nlive = 0;
+  copy->next_free = NULL;
+
+  for (i = 0; i < copy->nbumped; i++)
+    {
+      if (test_bit(copy->alloc_bits, i))
+	RETONERR(visit_fields((struct astnode *) (copy->objects +
+						  i * copy->class->obj_size),
+			      check_field, map));
+    }
+
+  return write_all(file, copy, PAGE_SIZE);
+}
+
+// Writes the globals of the marked environments of `page`.
+static int write_page_globals(FILE *file, struct gc_page *page,
+			      struct gc_image_map *map, uint64_t *nblocks)
+{
+  size_t i;
+  uint32_t j;
+
+  for (i = 0; i < page->nbumped; i++)
+    {
+      struct astnode_env *env;
+
+      env = (struct astnode_env *) (page->objects +
+				    i * page->class->obj_size);
+      if (!test_bit(page->mark_bits, i) || env->type != TYPE_ENV ||
+	  env->globals == NULL)
+	continue;
+
+      for (j = 0; j < env->globals->cap; j++)
+	RETONERR(check_field(&env->globals->values[j], map));
+      RETONERR(write_block(file, BLOCK_GLOBALS, env->globals,
+			   sizeof(*env->globals) +
+			   env->globals->cap * sizeof(struct astnode *)));
+      (*nblocks)++;
+    }
+
+  return 0;
+}
+
+// Writes the image of the marked objects.
+static int write_marked(FILE *file, struct astnode *root)
+{
+  struct gc_image_trailer trailer;
+  struct gc_image_map map;
+  struct gc_page *copy;
+  size_t i;
+  int err;
+
+  map.exec_start = (uintptr_t) __executable_start;
+  map.exec_end = (uintptr_t) _end;
+
+  if (posix_memalign((void **) &copy, PAGE_SIZE, PAGE_SIZE) != 0)
+    return ENOMEM;
+
+  trailer.magic = IMAGE_MAGIC;
+  trailer.npages = 0;
+  trailer.nblocks = 0;
+  trailer.exec_start = map.exec_start;
+  trailer.exec_size = map.exec_end - map.exec_start;
+  trailer.empty_list = (uintptr_t) EMPTY_LIST;
+  trailer.root = (uintptr_t) root;
+
+  for (i = 0, err = 0; err == 0 && i < npages; i++)
+    {
+      if (pages[i]->class != NULL && pages[i]->nlive > 0)
+	{
+	  err = write_page(file, pages[i], copy, &map);
+	  trailer.npages++;
+	}
+    }
+  free(copy);
+  if (err != 0)
+    return err;
+
+  for (i = 0; i < npages; i++)
+    {
+      uint64_t addr = (uintptr_t) pages[i];
+
+      if (pages[i]->class != NULL && pages[i]->nlive > 0)
+	RETONERR(write_all(file, &addr, sizeof(addr)));
+    }
+
+  for (i = 0; i < nlarge; i++)
+    {
+      if (!large_objs[i]->marked)
+	continue;
+      RETONERR(visit_fields((struct astnode *) large_objs[i]->object,
+			    check_field, &map));
+      RETONERR(write_block(file, BLOCK_LARGE, large_objs[i]->object,
+			   large_objs[i]->size));
+      trailer.nblocks++;
+    }
+
+  for (i = 0; i < npages; i++)
+    {
+      if (pages[i]->class != NULL && pages[i]->nlive > 0)
+	RETONERR(write_page_globals(file, pages[i], &map, &trailer.nblocks));
+    }
+
+  return write_all(file, &trailer, sizeof(trailer));
+}
+
+int gc_write_image(FILE *file, struct astnode *root)
+{
+  int err;
+
+  NULL_CHECK2(file, root);
+
+  // Mark what is reachable from the root only, as for a collection with no
+  // other root.
+  mark_stack_overflowed = false;
+  mark_ptr(root);
+  drain_mark_stack();
+
+  err = mark_stack_overflowed ? ENOMEM : write_marked(file, root);
+
+  mark_stack_len = 0;
+  clear_marks();
+  return err;
+}
+
+// Places in `*ptr` where the object `*ptr` pointed to when the image was
+// written is now.
+static int relocate(uintptr_t *ptr, struct gc_image_map *map)
+{
+  uintptr_t page = *ptr & ~(uintptr_t) (PAGE_SIZE - 1);
+  size_t lo;
+  size_t hi;
+
+  if (*ptr == 0 || is_fixnum((struct astnode *) *ptr))
+    return 0;
+
+  if (*ptr >= map->exec_start && *ptr < map->exec_end)
+    {
+      *ptr = *ptr - map->exec_start + (uintptr_t) __executable_start;
+      return 0;
+    }
+
+  for (lo = 0, hi = map->npages; lo < hi; )
+    {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (page < map->page_addrs[mid])
+	hi = mid;
+      else if (page > map->page_addrs[mid])
+	lo = mid + 1;
+      else
+	{
+	  *ptr = (uintptr_t) (map->pages + mid * PAGE_SIZE) + (*ptr - page);
+	  return 0;
+	}
+    }
+
+  // Find the last block starting at or before `*ptr`
+  for (lo = 0, hi = map->nblocks; lo < hi; )
+    {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (map->blocks[mid].addr <= *ptr)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  if (lo > 0 && *ptr - map->blocks[lo - 1].addr < map->blocks[lo - 1].size)
+    {
+      *ptr = (uintptr_t) map->blocks[lo - 1].copy +
+	(*ptr - map->blocks[lo - 1].addr);
+      return 0;
+    }
+
+  return EINVAL;
+}
+
+static int relocate_field(void *field, struct gc_image_map *map)
+{
+  uintptr_t ptr = read_field(field);
+
+  RETONERR(relocate(&ptr, map));
+  write_field(field, ptr);
+
+  return 0;
+}
+
+// Relocates the fields of `node`, a copy of an object of the image.
+static int relocate_object(struct astnode *node, struct gc_image_map *map)
+{
+  RETONERR(visit_fields(node, relocate_field, map));
+
+  if (node->type == TYPE_ENV && ((struct astnode_env *) node)->globals != NULL)
+    RETONERR(relocate_field(&((struct astnode_env *) node)->globals, map));
+
+  if (node->type == TYPE_CONT)
+    {
+      struct astnode_cont *cont = (struct astnode_cont *) node;
+
+      // Its call/cc returned in the process that wrote the image
+      if (cont->state == CONT_ACTIVE)
+	{
+	  cont->state = CONT_DEAD;
+	  cont->prev = NULL;
+	}
+      cont->escape = NULL;
+    }
+
+  return 0;
+}
+
+static int compare_blocks(const void *a, const void *b)
+{
+  const struct gc_loaded_block *block_a = a;
+  const struct gc_loaded_block *block_b = b;
+
+  return (block_a->addr > block_b->addr) - (block_a->addr < block_b->addr);
+}
+
+// Copies the blocks that start at `data` and end at `end` into
+// map->blocks[i].copy, as large objects (not yet in `large_objs`) or globals.
+static int copy_blocks(const char *data, const char *end,
+		       struct gc_image_map *map)
+{
+  size_t i;
+
+  for (i = 0; i < map->nblocks; i++)
+    {
+      struct gc_image_block block;
+      struct gc_large *large;
+
+      if ((size_t) (end - data) < sizeof(block))
+	return EINVAL;
+      memcpy(&block, data, sizeof(block));
+      data += sizeof(block);
+      if (block.size > (size_t) (end - data) ||
+	  block.size < sizeof(struct astnode) || block.addr % GRANULE != 0)
+	return EINVAL;
+
+      map->blocks[i].kind = block.kind;
+      map->blocks[i].addr = block.addr;
+      map->blocks[i].size = block.size;
+      switch (block.kind)
+	{
+	case BLOCK_LARGE:
+	  large = calloc(1, sizeof(*large) + block.size);
+	  if (large == NULL)
+	    return ENOMEM;
+	  large->size = block.size;
+	  memcpy(large->object, data, block.size);
+	  map->blocks[i].copy = large->object;
+	  break;
+	case BLOCK_GLOBALS:
+	  if (block.size < sizeof(struct env_globals) ||
+	      block.size != sizeof(struct env_globals) +
+	      ((const struct env_globals *) data)->cap *
+	      sizeof(struct astnode *))
+	    return EINVAL;
+	  map->blocks[i].copy = malloc(block.size);
+	  if (map->blocks[i].copy == NULL)
+	    return ENOMEM;
+	  memcpy(map->blocks[i].copy, data, block.size);
+	  break;
+	default:
+	  return EINVAL;
+	}
+
+      data += ROUND_GRANULES(block.size) * GRANULE;
+    }
+
+  return data == end ? 0 : EINVAL;
+}
+
+// Undoes copy_blocks.
+static void free_blocks(struct gc_image_map *map)
+{
+  size_t i;
+
+  for (i = 0; i < map->nblocks; i++)
+    {
+      if (map->blocks[i].copy == NULL)
+	continue;
+      if (map->blocks[i].kind == BLOCK_LARGE)
+	free((char *) map->blocks[i].copy - offsetof(struct gc_large, object));
+      else
+	free(map->blocks[i].copy);
+    }
+}
+
+// Relocates the header and the objects of `page`, a page of the image.
+static int relocate_page(struct gc_page *page, struct gc_image_map *map)
+{
+  uintptr_t class = (uintptr_t) page->class;
+  size_t offset;
+  size_t i;
+
+  RETONERR(relocate(&class, map));
+  offset = class - (uintptr_t) classes;
+  if (class < (uintptr_t) classes || offset >= sizeof(classes) ||
+      offset % sizeof(classes[0]) != 0)
+    return EINVAL;
+  page->class = (struct gc_size_class *) class;
+
+  if (page->nobjs != (PAGE_SIZE - offsetof(struct gc_page, objects)) /
+      page->class->obj_size || page->nbumped > page->nobjs)
+    return EINVAL;
+
+  for (i = 0; i < page->nbumped; i++)
+    {
+      if (test_bit(page->alloc_bits, i))
+	RETONERR(relocate_object((struct astnode *) (page->objects + i *
+						     page->class->obj_size),
+				 map));
+    }
+
+  return 0;
+}
+
+static int relocate_image(struct gc_image_map *map)
+{
+  size_t i;
+  uint32_t j;
+
+  for (i = 0; i < map->npages; i++)
+    RETONERR(relocate_page((struct gc_page *) (map->pages + i * PAGE_SIZE),
+			   map));
+
+  for (i = 0; i < map->nblocks; i++)
+    {
+      if (map->blocks[i].kind == BLOCK_LARGE)
+	RETONERR(relocate_object(map->blocks[i].copy, map));
+      else
+	{
+	  struct env_globals *globals = map->blocks[i].copy;
+
+	  for (j = 0; j < globals->cap; j++)
+	    RETONERR(relocate_field(&globals->values[j], map));
+	}
+    }
+
+  return 0;
+}
+
+// Makes room in `pages` and `large_objs` for the pages and large objects of
+// the image, so that adding them can't fail.
+static int reserve_image(struct gc_image_map *map)
+{
+  size_t nlarge_blocks;
+  size_t i;
+
+  for (i = 0, nlarge_blocks = 0; i < map->nblocks; i++)
+    nlarge_blocks += map->blocks[i].kind == BLOCK_LARGE;
+
+  if (npages + map->npages > pages_cap)
+    {
+      struct gc_page **new_pages;
+
+      new_pages = realloc(pages, (npages + map->npages) * sizeof(*pages));
+      if (new_pages == NULL)
+	return ENOMEM;
+      pages = new_pages;
+      pages_cap = npages + map->npages;
+    }
+
+  if (nlarge + nlarge_blocks > large_cap)
+    {
+      struct gc_large **new_objs;
+
+      new_objs = realloc(large_objs,
+			 (nlarge + nlarge_blocks) * sizeof(*large_objs));
+      if (new_objs == NULL)
+	return ENOMEM;
+      large_objs = new_objs;
+      large_cap = nlarge + nlarge_blocks;
+    }
+
+  return 0;
+}
+
+// Adds the relocated pages and large objects of the image to the heap. The
+// objects of its pages that aren't allocated go to the free lists.
+static void add_image(struct gc_image_map *map)
+{
+  size_t i;
+  size_t j;
+
+  for (i = 0; i < map->npages; i++)
+    {
+      struct gc_page *page = (struct gc_page *) (map->pages + i * PAGE_SIZE);
+      struct gc_size_class *class = page->class;
+
+      for (j = npages; j > 0 && pages[j - 1] > page; j--)
+	pages[j] = pages[j - 1];
+      pages[j] = page;
+      npages++;
+
+      for (j = page->nobjs; j > 0; j--)
+	{
+	  struct gc_free_obj *obj;
+
+	  if (j <= page->nbumped && test_bit(page->alloc_bits, j - 1))
+	    {
+	      stats.bytes_in_use += class->obj_size;
+	      stats.nallocs++;
+	      continue;
+	    }
+
+	  obj = (struct gc_free_obj *) (page->objects +
+					(j - 1) * class->obj_size);
+	  obj->next = class->free_list;
+	  class->free_list = obj;
+	}
+
+      page->nbumped = page->nobjs;
+      page->nlive = 0;
+      page->next_free = NULL;
+      memset(page->mark_bits, 0, sizeof(page->mark_bits));
+      stats.heap_size += PAGE_SIZE;
+    }
+
+  for (i = 0; i < map->nblocks; i++)
+    {
+      struct gc_large *large;
+
+      if (map->blocks[i].kind != BLOCK_LARGE)
+	continue;
+
+      large = (struct gc_large *) ((char *) map->blocks[i].copy -
+				   offsetof(struct gc_large, object));
+      for (j = nlarge; j > 0 && large_objs[j - 1] > large; j--)
+	large_objs[j] = large_objs[j - 1];
+      large_objs[j] = large;
+      nlarge++;
+
+      stats.heap_size += large->size;
+      stats.bytes_in_use += large->size;
+      stats.nallocs++;
+    }
+}
+
+int gc_load_image(void *image, size_t size, struct astnode **root)
+{
+  struct gc_image_trailer trailer;
+  struct gc_image_map map;
+  const char *blocks;
+  const char *end;
+  uintptr_t new_root;
+  size_t i;
+  int err;
+
+  NULL_CHECK2(image, root);
+
+  if ((uintptr_t) image % PAGE_SIZE != 0 || size < sizeof(trailer))
+    return EINVAL;
+
+  end = (const char *) image + size - sizeof(trailer);
+  memcpy(&trailer, end, sizeof(trailer));
+  if (trailer.magic != IMAGE_MAGIC ||
+      trailer.exec_size != (uintptr_t) _end - (uintptr_t) __executable_start ||
+      trailer.empty_list - trailer.exec_start !=
+      (uintptr_t) EMPTY_LIST - (uintptr_t) __executable_start ||
+      trailer.npages > (size - sizeof(trailer)) /
+      (PAGE_SIZE + sizeof(uint64_t)))
+    return EINVAL;
+
+  map.pages = image;
+  map.npages = trailer.npages;
+  map.page_addrs = (const uint64_t *) (map.pages + map.npages * PAGE_SIZE);
+  map.exec_start = trailer.exec_start;
+  map.exec_end = trailer.exec_start + trailer.exec_size;
+  for (i = 0; i < map.npages; i++)
+    {
+      if (map.page_addrs[i] % PAGE_SIZE != 0 ||
+	  (i > 0 && map.page_addrs[i - 1] >= map.page_addrs[i]))
+	return EINVAL;
+    }
+
+  blocks = (const char *) (map.page_addrs + map.npages);
+  if (trailer.nblocks >
+      (size_t) (end - blocks) / sizeof(struct gc_image_block))
+    return EINVAL;
+  map.nblocks = trailer.nblocks;
+  map.blocks = calloc(map.nblocks + 1, sizeof(*map.blocks));
+  if (map.blocks == NULL)
     return ENOMEM;
 
-  new_node->type = type;
-  *ret = new_node;
+  err = copy_blocks(blocks, end, &map);
+  if (err == 0)
+    {
+      qsort(map.blocks, map.nblocks, sizeof(*map.blocks), compare_blocks);
+      err = reserve_image(&map);
+    }
+  if (err == 0)
+    err = relocate_image(&map);
+  new_root = trailer.root;
+  if (err == 0)
+    err = new_root == 0 || is_fixnum((struct astnode *) new_root) ?
+      EINVAL : relocate(&new_root, &map);
+  if (err != 0)
+    {
+      free_blocks(&map);
+      free(map.blocks);
+      return err;
+    }
+
+  add_image(&map);
+  free(map.blocks);
+
+  *root = (struct astnode *) new_root;
   return 0;
 }
@@ -0,0 +1,182 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "inc/ast.h"
+#include "inc/gc.h"
+#include "inc/image.h"
+#include "inc/stdmacros.h"
+#include "inc/symbols.h"
+
+// An image file is made of:
+// 1. A struct image_header.
+// 2. The names of the symbols, as written by write_symbols.
+// 3. Zeroes up to the next multiple of GC_PAGE_SIZE, and the heap, as written
+// by gc_write_image, up to the end of the file. The file is mapped at an
+// address aligned on GC_PAGE_SIZE, so the pages of the heap are aligned too.
+
+#define IMAGE_MAGIC "scjsimg"
+#define IMAGE_VERSION 1
+
+struct image_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t nsyms;
+  uint64_t syms_size;		// The names follow the header
+  uint64_t heap_offset;
+};
+
+static uint64_t round_up(uint64_t n, uint64_t align)
+{
+  return (n + align - 1) / align * align;
+}
+
+static int write_image(FILE *file, struct astnode_env *env)
+{
+  struct image_header header;
+  size_t syms_size;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+  header.version = IMAGE_VERSION;
+
+  // Written again below, once the sizes are known
+  if (fwrite(&header, sizeof(header), 1, file) != 1)
+    return EIO;
+
+  RETONERR(write_symbols(file, &header.nsyms, &syms_size));
+  header.syms_size = syms_size;
+  header.heap_offset = round_up(sizeof(header) + syms_size, GC_PAGE_SIZE);
+
+  // Seeking past the end leaves a hole, which reads as zeroes.
+  if (fseek(file, header.heap_offset, SEEK_SET) != 0)
+    return EIO;
+  RETONERR(gc_write_image(file, (struct astnode *) env));
+
+  if (fseek(file, 0, SEEK_SET) != 0 ||
+      fwrite(&header, sizeof(header), 1, file) != 1)
+    return EIO;
+
+  return 0;
+}
+
+int image_save(const char *path, struct astnode_env *env)
+{
+  FILE *file;
+  int err;
+
+  NULL_CHECK2(path, env);
+  if (env->type != TYPE_ENV || env->globals == NULL)
+    return EINVAL;
+
+  file = fopen(path, "wb");
+  if (file == NULL)
+    return errno;
+
+  err = write_image(file, env);
+  if (fclose(file) != 0 && err == 0)
+    err = EIO;
+
+  return err;
+}
+
+// Maps the `size` first bytes of the file `fd`, copy-on-write, at an address
+// aligned on GC_PAGE_SIZE, which is placed in `ret`.
+static int map_aligned(int fd, size_t size, char **ret)
+{
+  size_t len = size + GC_PAGE_SIZE;
+  char *reserved;
+  char *aligned;
+  char *end;
+
+  // Reserve enough address space to find an aligned address in it, then map
+  // the file there and give back the rest.
+  reserved = mmap(NULL, len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reserved == MAP_FAILED)
+    return errno;
+
+  aligned = (char *) round_up((uintptr_t) reserved, GC_PAGE_SIZE);
+  if (mmap(aligned, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+	   0) == MAP_FAILED)
+    {
+      int err = errno;
+
+      munmap(reserved, len);
+      return err;
+    }
+
+  end = aligned + round_up(size, sysconf(_SC_PAGESIZE));
+  if (aligned > reserved)
+    munmap(reserved, aligned - reserved);
+  if (end < reserved + len)
+    munmap(end, reserved + len - end);
+
+  *ret = aligned;
+  return 0;
+}
+
+// Loads the image mapped at `image`. Sets `*keep_mapped` if the mapping must
+// be kept even though loading failed.
+static int load_image(char *image, size_t size, bool *keep_mapped,
+		      struct astnode_env **ret)
+{
+  struct image_header header;
+  struct astnode_env *env;
+
+  memcpy(&header, image, sizeof(header));
+  if (memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != IMAGE_VERSION ||
+      header.heap_offset % GC_PAGE_SIZE != 0 || header.heap_offset > size ||
+      header.syms_size > header.heap_offset - sizeof(header))
+    return EINVAL;
+
+  RETONERR(load_symbols(image + sizeof(header), header.syms_size,
+			header.nsyms));
+  *keep_mapped = true;
+
+  RETONERR(gc_load_image(image + header.heap_offset, size - header.heap_offset,
+			 (struct astnode **) &env));
+  if (env->type != TYPE_ENV || env->globals == NULL)
+    return EINVAL;
+  RETONERR(gc_add_root((struct astnode *) env));
+
+  *ret = env;
+  return 0;
+}
+
+int image_load(const char *path, struct astnode_env **ret)
+{
+  bool keep_mapped = false;
+  struct stat st;
+  char *image = NULL;
+  int fd;
+  int err;
+
+  NULL_CHECK2(path, ret);
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return errno;
+
+  if (fstat(fd, &st) != 0)
+    err = errno;
+  else if ((size_t) st.st_size < sizeof(struct image_header))
+    err = EINVAL;
+  else
+    err = map_aligned(fd, st.st_size, &image);
+  close(fd);
+  if (err != 0)
+    return err;
+
+  err = load_image(image, st.st_size, &keep_mapped, ret);
+  if (err != 0 && !keep_mapped)
+    munmap(image, st.st_size);
+
+  return err;
+}
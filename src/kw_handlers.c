@@ -1,10 +1,13 @@
 #include <errno.h>
 #include <string.h>
 
+#include "inc/analyze.h"
 #include "inc/ast.h"
+#include "inc/compile.h"
 #include "inc/eval.h"
 #include "inc/kw_handlers.h"
 #include "inc/gc.h"
+#include "inc/lexaddr.h"
 #include "inc/stdmacros.h"
 
 int kw_define(struct astnode_pair *args, struct astnode_env *env,
@@ -16,7 +19,7 @@ int kw_define(struct astnode_pair *args, struct astnode_env *env,
   NULL_CHECK3(args, env, ret);
 
   ret_temp = NULL;
-  if (args->car->type == TYPE_PAIR)
+  if (astnode_type_of(args->car) == TYPE_PAIR)
     {
       // We're defining a compound procedure: ((fn arg) (+ arg 3))
       struct astnode_compproc *proc;
@@ -41,8 +44,12 @@ int kw_define(struct astnode_pair *args, struct astnode_env *env,
       if (is_empty_list(args->cdr))
 	return EBADMSG;
       proc->body = (struct astnode_pair *) args->cdr;
+
+      RETONERR(resolve_lexaddrs(proc));
+      RETONERR(compile_proc(proc));
+      RETONERR(analyze_proc(proc));
     }
-  else if (args->car->type == TYPE_SYM)
+  else if (astnode_type_of(args->car) == TYPE_SYM)
     {
       // We're defining a normal binding: (a 3)
       sym = (struct astnode_sym *) args->car;
@@ -62,15 +69,15 @@ int kw_define(struct astnode_pair *args, struct astnode_env *env,
   return 0;
 }
 
-int kw_if(struct astnode_pair *args, struct astnode_env *env,
-	  struct astnode **ret)
+int kw_if_branch(struct astnode_pair *args, struct astnode_env *env,
+		 struct astnode **branch)
 {
   struct astnode *cond;
   struct astnode *truepath;
   struct astnode *falsepath;
   struct astnode *evaled_cond;
 
-  NULL_CHECK3(args, env, ret);
+  NULL_CHECK3(args, env, branch);
 
   if (is_empty_list((struct astnode *)args))
     return EBADMSG;
@@ -92,19 +99,31 @@ int kw_if(struct astnode_pair *args, struct astnode_env *env,
   RETONERR(eval(cond, env, &evaled_cond));
 
   // Only boolean false will have the false path evaled
-  if (evaled_cond->type == TYPE_BOOLEAN &&
-      ((struct astnode_boolean *)evaled_cond)->boolval == false)
+  if (is_false(evaled_cond))
     {
-      RETONERR(eval(falsepath, env, ret));
+      *branch = falsepath;
     }
   else
     {
-      RETONERR(eval(truepath, env, ret));
+      *branch = truepath;
     }
 
   return 0;
 }
 
+int kw_if(struct astnode_pair *args, struct astnode_env *env,
+	  struct astnode **ret)
+{
+  struct astnode *branch;
+
+  NULL_CHECK3(args, env, ret);
+
+  RETONERR(kw_if_branch(args, env, &branch));
+  RETONERR(eval(branch, env, ret));
+
+  return 0;
+}
+
 int kw_quote(struct astnode_pair *args, struct astnode_env *env,
 	     struct astnode **ret)
 {
@@ -139,5 +158,9 @@ int kw_lambda(struct astnode_pair *args, struct astnode_env *env,
   ((struct astnode_compproc *) *ret)->env = env;
   ((struct astnode_compproc *) *ret)->params = params;
 
+  RETONERR(resolve_lexaddrs((struct astnode_compproc *) *ret));
+  RETONERR(compile_proc((struct astnode_compproc *) *ret));
+  RETONERR(analyze_proc((struct astnode_compproc *) *ret));
+
   return 0;
 }
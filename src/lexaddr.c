@@ -0,0 +1,310 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "inc/ast.h"
+#include "inc/env.h"
+#include "inc/gc.h"
+#include "inc/kw_handlers.h"
+#include "inc/lexaddr.h"
+#include "inc/stdmacros.h"
+
+enum lexbinding lexscope_find(struct lexscope *scope, struct astnode_sym *sym,
+			      uint32_t *depth, uint32_t *index)
+{
+  uint32_t d;
+
+  for (d = 0; scope != NULL; d++, scope = scope->parent)
+    {
+      struct astnode_pair *param_scanner;
+      uint32_t i;
+
+      for (i = 0, param_scanner = scope->params;
+	   !is_empty_list((struct astnode *) param_scanner);
+	   i++, param_scanner = (struct astnode_pair *) param_scanner->cdr)
+	{
+	  if (((struct astnode_sym *) param_scanner->car)->symi == sym->symi)
+	    {
+	      *depth = d;
+	      *index = i;
+	      return LEXBINDING_PARAM;
+	    }
+	}
+
+      for (i = 0; i < scope->ndefines; i++)
+	{
+	  if (scope->defines[i] == sym->symi)
+	    return LEXBINDING_DEFINE;
+	}
+    }
+
+  return LEXBINDING_GLOBAL;
+}
+
+kw_handler lexscope_keyword(struct lexscope *scope, struct astnode *node,
+			    struct astnode_env *global_env)
+{
+  struct astnode *val;
+  uint32_t depth;
+  uint32_t index;
+
+  if (astnode_type_of(node) != TYPE_SYM ||
+      lexscope_find(scope, (struct astnode_sym *) node, &depth, &index)
+      != LEXBINDING_GLOBAL)
+    return NULL;
+
+  if (lookup_env(global_env, (struct astnode_sym *) node, &val) != 0 ||
+      astnode_type_of(val) != TYPE_KEYWORD)
+    return NULL;
+
+  return ((struct astnode_keyword *) val)->handler;
+}
+
+// Returns true if `params` is a proper list of distinct symbols.
+static bool is_valid_params(struct astnode *params)
+{
+  struct astnode_pair *param_scanner;
+
+  for (param_scanner = (struct astnode_pair *) params;
+       !is_empty_list((struct astnode *) param_scanner);
+       param_scanner = (struct astnode_pair *) param_scanner->cdr)
+    {
+      struct astnode_pair *other;
+
+      if (astnode_type_of((struct astnode *) param_scanner) != TYPE_PAIR ||
+	  astnode_type_of(param_scanner->car) != TYPE_SYM)
+	return false;
+
+      for (other = (struct astnode_pair *) params;
+	   other != param_scanner;
+	   other = (struct astnode_pair *) other->cdr)
+	{
+	  if (((struct astnode_sym *) other->car)->symi ==
+	      ((struct astnode_sym *) param_scanner->car)->symi)
+	    return false;
+	}
+    }
+
+  return true;
+}
+
+static int add_define(struct lexscope *scope, struct astnode_sym *sym)
+{
+  if (scope->ndefines == scope->defines_cap)
+    {
+      uint32_t *new_defines;
+      uint32_t new_cap;
+
+      new_cap = scope->defines_cap == 0 ? 8 : scope->defines_cap * 2;
+      new_defines = realloc(scope->defines, new_cap * sizeof(*new_defines));
+      if (new_defines == NULL)
+	return ENOMEM;
+
+      scope->defines = new_defines;
+      scope->defines_cap = new_cap;
+    }
+
+  scope->defines[scope->ndefines++] = sym->symi;
+
+  return 0;
+}
+
+// Adds to `scope` the names defined in `node`, not counting the ones in
+// nested procedures.
+static int collect_defines(struct astnode *node, struct lexscope *scope,
+			   struct astnode_env *global_env)
+{
+  struct astnode_pair *scanner;
+  kw_handler kw;
+
+  if (astnode_type_of(node) != TYPE_PAIR || is_empty_list(node))
+    return 0;
+
+  scanner = (struct astnode_pair *) node;
+  kw = lexscope_keyword(scope, scanner->car, global_env);
+  if (kw == kw_quote || kw == kw_lambda)
+    return 0;
+
+  if (kw == kw_define)
+    {
+      struct astnode_pair *args;
+
+      args = (struct astnode_pair *) scanner->cdr;
+      if (astnode_type_of((struct astnode *) args) != TYPE_PAIR ||
+	  is_empty_list((struct astnode *) args))
+	return 0;
+
+      // (define (fn a) ...): the body belongs to fn
+      if (astnode_type_of(args->car) == TYPE_PAIR)
+	{
+	  struct astnode *name = ((struct astnode_pair *) args->car)->car;
+
+	  if (astnode_type_of(name) == TYPE_SYM)
+	    RETONERR(add_define(scope, (struct astnode_sym *) name));
+	  return 0;
+	}
+
+      if (astnode_type_of(args->car) == TYPE_SYM)
+	RETONERR(add_define(scope, (struct astnode_sym *) args->car));
+      scanner = args;
+    }
+
+  for ( ;
+	astnode_type_of((struct astnode *) scanner) == TYPE_PAIR &&
+	  !is_empty_list((struct astnode *) scanner);
+	scanner = (struct astnode_pair *) scanner->cdr)
+    {
+      RETONERR(collect_defines(scanner->car, scope, global_env));
+    }
+
+  return 0;
+}
+
+static int resolve_body(struct astnode *params, struct astnode *body,
+			struct lexscope *parent, struct astnode_env *global_env);
+
+static int resolve_list(struct astnode *list, struct lexscope *scope,
+			struct astnode_env *global_env);
+
+static int resolve(struct astnode **node, struct lexscope *scope,
+		   struct astnode_env *global_env)
+{
+  struct astnode_pair *pair;
+  struct astnode_pair *args;
+  kw_handler kw;
+
+  if (astnode_type_of(*node) == TYPE_SYM)
+    {
+      struct astnode_lexaddr *lexaddr;
+      uint32_t depth;
+      uint32_t index;
+
+      if (lexscope_find(scope, (struct astnode_sym *) *node, &depth, &index)
+	  != LEXBINDING_PARAM)
+	return 0;
+
+      RETONERR(alloc_astnode(TYPE_LEXADDR, (struct astnode **) &lexaddr));
+      lexaddr->depth = depth;
+      lexaddr->index = index;
+      lexaddr->sym = (struct astnode_sym *) *node;
+      *node = (struct astnode *) lexaddr;
+
+      return 0;
+    }
+
+  if (astnode_type_of(*node) != TYPE_PAIR || is_empty_list(*node))
+    return 0;
+
+  pair = (struct astnode_pair *) *node;
+  kw = lexscope_keyword(scope, pair->car, global_env);
+  if (kw == kw_quote)
+    return 0;
+
+  if (kw == kw_lambda || kw == kw_define)
+    {
+      args = (struct astnode_pair *) pair->cdr;
+      if (astnode_type_of((struct astnode *) args) != TYPE_PAIR ||
+	  is_empty_list((struct astnode *) args))
+	return 0;
+
+      // (lambda (a) ...)
+      if (kw == kw_lambda)
+	return resolve_body(args->car, args->cdr, scope, global_env);
+
+      // (define (fn a) ...)
+      if (astnode_type_of(args->car) == TYPE_PAIR)
+	return resolve_body(((struct astnode_pair *) args->car)->cdr, args->cdr,
+			    scope, global_env);
+
+      // (define a ...): the target is not a reference
+      return resolve_list(args->cdr, scope, global_env);
+    }
+
+  return resolve_list(*node, scope, global_env);
+}
+
+static int resolve_list(struct astnode *list, struct lexscope *scope,
+			struct astnode_env *global_env)
+{
+  struct astnode_pair *scanner;
+
+  for (scanner = (struct astnode_pair *) list;
+       astnode_type_of((struct astnode *) scanner) == TYPE_PAIR &&
+	 !is_empty_list((struct astnode *) scanner);
+       scanner = (struct astnode_pair *) scanner->cdr)
+    {
+      RETONERR(resolve(&scanner->car, scope, global_env));
+    }
+
+  return 0;
+}
+
+int lexscope_open(struct lexscope *scope, struct lexscope *parent,
+		  struct astnode *params, struct astnode *body,
+		  struct astnode_env *global_env)
+{
+  struct astnode_pair *scanner;
+  int err;
+
+  NULL_CHECK4(scope, params, body, global_env);
+
+  if (!is_valid_params(params))
+    return EBADMSG;
+
+  scope->parent = parent;
+  scope->params = (struct astnode_pair *) params;
+  scope->defines = NULL;
+  scope->ndefines = 0;
+  scope->defines_cap = 0;
+
+  for (scanner = (struct astnode_pair *) body, err = 0;
+       err == 0 && astnode_type_of((struct astnode *) scanner) == TYPE_PAIR &&
+	 !is_empty_list((struct astnode *) scanner);
+       scanner = (struct astnode_pair *) scanner->cdr)
+    {
+      err = collect_defines(scanner->car, scope, global_env);
+    }
+
+  if (err != 0)
+    lexscope_close(scope);
+
+  return err;
+}
+
+void lexscope_close(struct lexscope *scope)
+{
+  free(scope->defines);
+  scope->defines = NULL;
+}
+
+// Resolves `body` in a new scope binding `params`, nested in `parent`.
+static int resolve_body(struct astnode *params, struct astnode *body,
+			struct lexscope *parent, struct astnode_env *global_env)
+{
+  struct lexscope scope;
+  int err;
+
+  err = lexscope_open(&scope, parent, params, body, global_env);
+  // Malformed lambdas are left alone
+  if (err == EBADMSG)
+    return 0;
+  if (err != 0)
+    return err;
+
+  err = resolve_list(body, &scope, global_env);
+  lexscope_close(&scope);
+
+  return err;
+}
+
+int resolve_lexaddrs(struct astnode_compproc *proc)
+{
+  NULL_CHECK1(proc);
+
+  if (proc->env->parent != NULL)
+    return 0;
+
+  return resolve_body((struct astnode *) proc->params,
+		      (struct astnode *) proc->body, NULL, proc->env);
+}
@@ -1,16 +1,24 @@
 #include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include "inc/ast.h"
 #include "inc/env.h"
 #include "inc/eval.h"
+#include "inc/image.h"
+#include "inc/reader.h"
+#include "inc/stackeval.h"
 #include "inc/stdmacros.h"
 #include "inc/symbols.h"
 #include "parser.tab.h"
 
 #define DEFAULT_INIT_PATH "/usr/local/etc/scminit.scm"
 
+// In batch mode, the output is written in blocks of this size.
+#define BATCH_OUTPUT_SIZE ((size_t) 1 << 20)
+
 void yyrestart(FILE *);
 
 static void print_exp(struct astnode *root);
@@ -36,42 +44,86 @@ static void print_boolean(struct astnode_boolean *boolean)
     printf("#f");
 }
 
+// Walks down the cdrs rather than recursing on them, so that long lists print
+// in constant stack.
 static void print_pair_elements(struct astnode_pair *pair)
 {
-  if (pair->car != NULL)
+  for (;;)
     {
-      print_exp(pair->car);
-    }
+      if (pair->car != NULL)
+	print_exp(pair->car);
 
-  if (pair->cdr != NULL)
-    {
-      if (is_empty_list((struct astnode *)pair->cdr))
+      if (pair->cdr == NULL || is_empty_list(pair->cdr))
 	return;
 
       printf(" ");
 
-      if (pair->cdr->type == TYPE_PAIR)
-	{
-	  print_pair_elements((struct astnode_pair *) pair->cdr);
-	}
-      else
+      if (astnode_type_of(pair->cdr) != TYPE_PAIR)
 	{
 	  printf(". ");
 	  print_exp(pair->cdr);
+	  return;
 	}
+
+      pair = (struct astnode_pair *) pair->cdr;
     }
 }
 
+static void print_vector(struct astnode_vector *vector)
+{
+  uint32_t i;
+
+  printf("#(");
+  for (i = 0; i < vector->len; i++)
+    {
+      if (i > 0)
+	printf(" ");
+      print_exp(vector->elts[i]);
+    }
+  printf(")");
+}
+
+// Prints the elements as they are stored, even those that don't fit in a
+// fixnum.
+static void print_numvector(struct astnode_numvector *vec)
+{
+  static const char *const prefixes[NUMVEC_NKINDS] = {
+    [NUMVEC_S32] = "s32", [NUMVEC_S64] = "s64", [NUMVEC_F64] = "f64",
+  };
+  uint32_t i;
+
+  printf("#%s(", prefixes[vec->kind]);
+  for (i = 0; i < vec->len; i++)
+    {
+      if (i > 0)
+	printf(" ");
+      switch (vec->kind)
+	{
+	case NUMVEC_S32:
+	  printf("%" PRId32, ((int32_t *) vec->data)[i]);
+	  break;
+	case NUMVEC_S64:
+	  printf("%" PRId64, ((int64_t *) vec->data)[i]);
+	  break;
+	case NUMVEC_F64:
+	  printf("%g", ((double *) vec->data)[i]);
+	  break;
+	case NUMVEC_NKINDS:
+	  break;
+	}
+    }
+  printf(")");
+}
 
 static void print_exp(struct astnode *root)
 {
-  switch(root->type)
+  switch(astnode_type_of(root))
     {
     case TYPE_SYM:
       print_sym((struct astnode_sym *) root);
       break;
     case TYPE_INT:
-      printf("%d", ((struct astnode_int *)root)->intval);
+      printf("%d", fixnum_val(root));
       break;
     case TYPE_BOOLEAN:
       print_boolean((struct astnode_boolean *) root);
@@ -93,78 +145,347 @@ static void print_exp(struct astnode *root)
     case TYPE_COMPPROC:
       printf("<compound proc>");
       break;
+    case TYPE_CODE:
+      printf("<compiled code>");
+      break;
+    case TYPE_EXEC:
+      printf("<analyzed code>");
+      break;
+    case TYPE_CONT:
+      printf("<continuation>");
+      break;
+    case TYPE_VECTOR:
+      print_vector((struct astnode_vector *) root);
+      break;
+    case TYPE_NUMVECTOR:
+      print_numvector((struct astnode_numvector *) root);
+      break;
+    case TYPE_LEXADDR:
+      print_sym(((struct astnode_lexaddr *) root)->sym);
+      break;
     default:
       printf("<Unknown type %d>", root->type);
     }
 }
 
+// Reads the next top-level expression from `reader`, or from the current
+// input of the parser (see yyrestart) if `reader` is NULL, into `exp`, or sets
+// it to NULL at the end of the input. Expressions are read one at a time so
+// that the parse tree of each one can be reclaimed once it has run, and so
+// that the first ones run before the end of the input is read. Files and -e
+// expressions go through the reader, which reads them in place; the parser
+// is left the standard input, which can't be mapped.
+// Possible errors:
+// + EBADMSG: The input doesn't parse.
+// + ENOMEM: The parser ran out of memory.
+// + Any error of reader_next.
+static int read_next(struct reader *reader, struct astnode **exp)
+{
+  if (reader != NULL)
+    return reader_next(reader, exp);
+
+  switch (yyparse_one(false, exp))
+    {
+    case 0:
+      return 0;
+    case 2:
+      return ENOMEM;
+    default:
+      return EBADMSG;
+    }
+}
+
+// Prints the error `err` of reading the input named `name`, on its line if
+// it came from `reader`.
+static void print_read_error(struct reader *reader, const char *name, int err)
+{
+  fflush(stdout);
+  if (reader == NULL)
+    fprintf(stderr, "%s: Error parsing input.\n", name);
+  else
+    fprintf(stderr, "%s:%" PRIu32 ": Error parsing input: %s\n", name,
+	    reader->line, strerror(err));
+}
+
 static void load_init_file(struct astnode_env *env, char *path)
 {
   int err;
-  FILE *init_file;
-  struct astnode *parsed_result;
+  struct reader reader;
+  struct astnode *exp;
   struct astnode *dummy;
 
-  init_file = fopen(path, "r");
-  if (init_file == NULL)
+  if ((err = reader_open(&reader, path)) != 0)
     {
-      perror("Error opening init file");
+      fprintf(stderr, "Error opening init file: %s\n", strerror(err));
       return;
     }
 
-  yyrestart(init_file);
-  if (yyparse(false, &parsed_result) != 0)
+  for (;;)
     {
-      fprintf(stderr, "Error parsing init file.\n");
-      return;
+      if ((err = read_next(&reader, &exp)) != 0)
+	{
+	  print_read_error(&reader, path, err);
+	  break;
+	}
+      if (exp == NULL)
+	break;
+
+      if ((err = eval(exp, env, &dummy)) != 0)
+	{
+	  fprintf(stderr, "Error evaluating init file: %d\n", err);
+	  break;
+	}
     }
 
-  err = eval_many((struct astnode_pair *)parsed_result, env, &dummy);
-  if (err != 0)
+  reader_close(&reader);
+}
+
+// Evaluates the expressions read from `reader` (or from the parser's input if
+// NULL; see read_next), named `name` in error messages, as they are read, and
+// prints the value of each one on its own line. Stops at the first parse or
+// evaluation error, which is returned.
+static int run_batch(struct astnode_env *env, struct reader *reader,
+		     const char *name)
+{
+  struct astnode *exp;
+  struct astnode *val;
+  int err;
+
+  for (;;)
     {
-      fprintf(stderr, "Error evaluating init file: %d\n", err);
+      if ((err = read_next(reader, &exp)) != 0)
+	{
+	  print_read_error(reader, name, err);
+	  return err;
+	}
+      if (exp == NULL)
+	return 0;
+
+      if ((err = eval(exp, env, &val)) != 0)
+	{
+	  fflush(stdout);
+	  fprintf(stderr, "%s: Error in evaluating expression: %s\n", name,
+		  strerror(err));
+	  return err;
+	}
+      print_exp(val);
+      putchar('\n');
     }
 }
 
+// Runs the expressions given with -e, in order, then the script at
+// `script_path` ("-" for the standard input) if there is one.
+static int run_batches(struct astnode_env *env, char **exprs, int nexprs,
+		       const char *script_path)
+{
+  struct reader reader;
+  int err;
+  int i;
+
+  for (i = 0; i < nexprs; i++)
+    {
+      reader_init(&reader, exprs[i], strlen(exprs[i]));
+      if ((err = run_batch(env, &reader, "-e")) != 0)
+	return err;
+    }
+
+  if (script_path == NULL)
+    return 0;
+
+  if (strcmp(script_path, "-") == 0)
+    {
+      yyrestart(stdin);
+      return run_batch(env, NULL, "stdin");
+    }
+
+  if ((err = reader_open(&reader, script_path)) != 0)
+    {
+      fprintf(stderr, "%s: %s\n", script_path, strerror(err));
+      return err;
+    }
+  err = run_batch(env, &reader, script_path);
+  reader_close(&reader);
+
+  return err;
+}
+
+// Converts `arg`, a positive number of MiB, to bytes in `bytes`.
+// Possible errors:
+// + EINVAL: `arg` isn't a positive integer.
+// + ERANGE: The number of bytes doesn't fit in a size_t.
+static int parse_mib(const char *arg, size_t *bytes)
+{
+  unsigned long long mib;
+  char *end;
+
+  if (*arg < '0' || *arg > '9')
+    return EINVAL;
+
+  errno = 0;
+  mib = strtoull(arg, &end, 10);
+  if (errno != 0)
+    return errno;
+  if (*end != '\0' || mib == 0)
+    return EINVAL;
+  if (mib > SIZE_MAX >> 20)
+    return ERANGE;
+
+  *bytes = (size_t) mib << 20;
+  return 0;
+}
+
+static int usage(const char *prog)
+{
+  fprintf(stderr,
+	  "Usage: %s [-i init_file_path | -I image_path] "
+	  "[-S save_image_path] [-m ast|bytecode|analyze|stack] "
+	  "[-s stack_limit_mib] [-e expression]... [script_path | -]\n",
+	  prog);
+  return EINVAL;
+}
 
 int main(int argc, char **argv)
 {
   int err;
+  int opt;
   struct astnode_env *env;
-  struct astnode_pair *parsed_exp;
+  struct astnode *parsed_exp;
   struct astnode *evaled_exp;
   char *init_path = DEFAULT_INIT_PATH;
+  char *image_path = NULL;
+  char *save_path = NULL;
+  char *script_path = NULL;
+  char **exprs;
+  int nexprs = 0;
 
-  if (argc >= 3 && strcmp("-i", argv[1]) == 0)
-    init_path = argv[2];
+  // At most one per argument
+  exprs = malloc(argc * sizeof(*exprs));
+  if (exprs == NULL)
+    return ENOMEM;
 
-  RETONERR(make_top_level_env(&env));
+  while ((opt = getopt(argc, argv, "e:i:I:m:s:S:")) != -1)
+    {
+      switch (opt)
+	{
+	case 'e':
+	  // Evaluate an expression instead of running the REPL
+	  exprs[nexprs++] = optarg;
+	  break;
+	case 'i':
+	  init_path = optarg;
+	  break;
+	case 'I':
+	  // Start from a heap image rather than from the init file
+	  image_path = optarg;
+	  break;
+	case 'S':
+	  // Save a heap image once initialized, and exit
+	  save_path = optarg;
+	  break;
+	case 'm':
+	  if (strcmp("ast", optarg) == 0)
+	    eval_mode = EVAL_MODE_AST;
+	  else if (strcmp("bytecode", optarg) == 0)
+	    eval_mode = EVAL_MODE_BYTECODE;
+	  else if (strcmp("analyze", optarg) == 0)
+	    eval_mode = EVAL_MODE_ANALYZE;
+	  else if (strcmp("stack", optarg) == 0)
+	    eval_mode = EVAL_MODE_STACK;
+	  else
+	    {
+	      fprintf(stderr, "Unknown evaluation mode: %s\n", optarg);
+	      return EINVAL;
+	    }
+	  break;
+	case 's':
+	  // Control stack limit of the stack mode, in MiB
+	  if (parse_mib(optarg, &stackeval_max_bytes) != 0)
+	    {
+	      fprintf(stderr, "Invalid stack limit: %s\n", optarg);
+	      return usage(argv[0]);
+	    }
+	  break;
+	default:
+	  return usage(argv[0]);
+	}
+    }
 
-  load_init_file(env, init_path);
+  if (optind < argc)
+    script_path = argv[optind++];
+  if (optind < argc)
+    return usage(argv[0]);
+
+  // Without a REPL, nobody waits for the output of each expression: write
+  // it in big blocks rather than line by line.
+  if (nexprs > 0 || script_path != NULL)
+    setvbuf(stdout, malloc(BATCH_OUTPUT_SIZE), _IOFBF, BATCH_OUTPUT_SIZE);
+
+  if (image_path != NULL)
+    {
+      if ((err = image_load(image_path, &env)) != 0)
+	{
+	  fprintf(stderr, "Error loading image %s: %s\n", image_path,
+		  strerror(err));
+	  return err;
+	}
+    }
+  else
+    {
+      RETONERR(make_top_level_env(&env));
+      load_init_file(env, init_path);
+    }
+
+  if (save_path != NULL)
+    {
+      if ((err = image_save(save_path, env)) != 0)
+	fprintf(stderr, "Error saving image %s: %s\n", save_path,
+		strerror(err));
+      return err;
+    }
+
+  if (nexprs > 0 || script_path != NULL)
+    {
+      err = run_batches(env, exprs, nexprs, script_path);
+      if (fflush(stdout) != 0 && err == 0)
+	{
+	  err = errno;
+	  perror("Error writing output");
+	}
+      return err;
+    }
 
   printf("Welcome back!\n");
   printf("Keep hacking, keep rocking \\m/\n\n");
 
+  // The expressions of a line are parsed and evaluated one at a time, like
+  // those of a script: once evaluated, nothing refers to the parse tree of
+  // an expression (unless it was quoted or made into a procedure body), and
+  // the next collection reclaims it.
   while(1)
     {
       printf(">> ");
       yyrestart(stdin);
-      err = yyparse(true, (struct astnode **)&parsed_exp);
-      if (err != 0)
-	{
-	  fprintf(stderr, "There was an error when parsing.\n");
-	  continue;
-	}
-      if ((err = eval_many(parsed_exp, env, &evaled_exp)) != 0)
+      for (;;)
 	{
-	  if (err == EBADMSG)
-	    printf("Invalid input.");
-	  else
-	    printf("Error in evaluating expression: %d", err);
+	  if (yyparse_one(true, &parsed_exp) != 0)
+	    {
+	      fprintf(stderr, "There was an error when parsing.\n");
+	      break;
+	    }
+	  if (parsed_exp == NULL)
+	    break;
+
+	  if ((err = eval(parsed_exp, env, &evaled_exp)) != 0)
+	    {
+	      if (err == EBADMSG)
+		printf("Invalid input.\n");
+	      else
+		printf("Error in evaluating expression: %d\n", err);
+	      break;
+	    }
+	  print_exp(evaled_exp);
+	  printf("\n");
 	}
-      else
-	print_exp(evaled_exp);
-      printf("\n");
     }
 
   return 0;
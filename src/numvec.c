@@ -0,0 +1,473 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "inc/ast.h"
+#include "inc/gc.h"
+#include "inc/numvec.h"
+#include "inc/stdmacros.h"
+
+// Each kernel loads and stores whole vectors of lanes through `V` types, which
+// only need the alignment of their elements (objects in the heap are only
+// 8-byte aligned), and does the elements left over one by one. Integers are
+// added and multiplied as unsigned, so that they wrap around instead of
+// overflowing; min and max compare them as signed.
+//
+// DEFINE_KERNELS(isa, ATTR, tag, T, U, VT, VU, M) defines the kernels for
+// elements of type T (compared as T, computed on as U), with VT and VU vectors
+// of T and U, and M the mask vector comparisons of VT give.
+#define DEFINE_KERNELS(isa, ATTR, tag, T, U, VT, VU, M)			\
+  ATTR static void isa##_add_##tag(T *dst, const T *a, const T *b,	\
+				   uint32_t n)				\
+  {									\
+    const uint32_t lanes = sizeof(VU) / sizeof(U);			\
+    uint32_t i;								\
+									\
+    for (i = 0; i + lanes <= n; i += lanes)				\
+      *(VU *) &dst[i] = *(const VU *) &a[i] + *(const VU *) &b[i];	\
+    for ( ; i < n; i++)							\
+      dst[i] = (T) ((U) a[i] + (U) b[i]);				\
+  }									\
+									\
+  ATTR static void isa##_mul_##tag(T *dst, const T *a, const T *b,	\
+				   uint32_t n)				\
+  {									\
+    const uint32_t lanes = sizeof(VU) / sizeof(U);			\
+    uint32_t i;								\
+									\
+    for (i = 0; i + lanes <= n; i += lanes)				\
+      *(VU *) &dst[i] = *(const VU *) &a[i] * *(const VU *) &b[i];	\
+    for ( ; i < n; i++)							\
+      dst[i] = (T) ((U) a[i] * (U) b[i]);				\
+  }									\
+									\
+  ATTR static void isa##_scale_##tag(T *dst, const T *a, T k, uint32_t n) \
+  {									\
+    const uint32_t lanes = sizeof(VU) / sizeof(U);			\
+    uint32_t i;								\
+									\
+    for (i = 0; i + lanes <= n; i += lanes)				\
+      *(VU *) &dst[i] = *(const VU *) &a[i] * (U) k;			\
+    for ( ; i < n; i++)							\
+      dst[i] = (T) ((U) a[i] * (U) k);					\
+  }									\
+									\
+  ATTR static T isa##_dot_##tag(const T *a, const T *b, uint32_t n)	\
+  {									\
+    const uint32_t lanes = sizeof(VU) / sizeof(U);			\
+    VU acc = { 0 };							\
+    U ret;								\
+    uint32_t i;								\
+									\
+    for (i = 0; i + lanes <= n; i += lanes)				\
+      acc += *(const VU *) &a[i] * *(const VU *) &b[i];		\
+    for (ret = 0; i < n; i++)						\
+      ret += (U) a[i] * (U) b[i];					\
+    for (i = 0; i < lanes; i++)						\
+      ret += acc[i];							\
+									\
+    return (T) ret;							\
+  }									\
+									\
+  ATTR static T isa##_sum_##tag(const T *a, uint32_t n)		\
+  {									\
+    const uint32_t lanes = sizeof(VU) / sizeof(U);			\
+    VU acc = { 0 };							\
+    U ret;								\
+    uint32_t i;								\
+									\
+    for (i = 0; i + lanes <= n; i += lanes)				\
+      acc += *(const VU *) &a[i];					\
+    for (ret = 0; i < n; i++)						\
+      ret += (U) a[i];							\
+    for (i = 0; i < lanes; i++)						\
+      ret += acc[i];							\
+									\
+    return (T) ret;							\
+  }									\
+									\
+  ATTR static T isa##_min_##tag(const T *a, uint32_t n)		\
+  {									\
+    const uint32_t lanes = sizeof(VT) / sizeof(T);			\
+    T ret;								\
+    uint32_t i;								\
+									\
+    ret = a[0];								\
+    i = 0;								\
+    if (n >= lanes)							\
+      {									\
+	VT acc = *(const VT *) &a[0];					\
+	uint32_t l;							\
+									\
+	for (i = lanes; i + lanes <= n; i += lanes)			\
+	  {								\
+	    VT v = *(const VT *) &a[i];					\
+	    M m = v < acc;						\
+									\
+	    acc = (VT) (((M) v & m) | ((M) acc & ~m));			\
+	  }								\
+	for (ret = acc[0], l = 1; l < lanes; l++)			\
+	  if (acc[l] < ret)						\
+	    ret = acc[l];						\
+      }									\
+    for ( ; i < n; i++)							\
+      if (a[i] < ret)							\
+	ret = a[i];							\
+									\
+    return ret;								\
+  }									\
+									\
+  ATTR static T isa##_max_##tag(const T *a, uint32_t n)		\
+  {									\
+    const uint32_t lanes = sizeof(VT) / sizeof(T);			\
+    T ret;								\
+    uint32_t i;								\
+									\
+    ret = a[0];								\
+    i = 0;								\
+    if (n >= lanes)							\
+      {									\
+	VT acc = *(const VT *) &a[0];					\
+	uint32_t l;							\
+									\
+	for (i = lanes; i + lanes <= n; i += lanes)			\
+	  {								\
+	    VT v = *(const VT *) &a[i];					\
+	    M m = v > acc;						\
+									\
+	    acc = (VT) (((M) v & m) | ((M) acc & ~m));			\
+	  }								\
+	for (ret = acc[0], l = 1; l < lanes; l++)			\
+	  if (acc[l] > ret)						\
+	    ret = acc[l];						\
+      }									\
+    for ( ; i < n; i++)							\
+      if (a[i] > ret)							\
+	ret = a[i];							\
+									\
+    return ret;								\
+  }
+
+#define KERNELS_OF(isa, tag)						\
+  {									\
+    .add = isa##_add_##tag, .mul = isa##_mul_##tag,			\
+    .scale = isa##_scale_##tag, .dot = isa##_dot_##tag,			\
+    .sum = isa##_sum_##tag, .min = isa##_min_##tag,			\
+    .max = isa##_max_##tag						\
+  }
+
+#define VECTOR_TYPE(T, bytes)						\
+  T __attribute__((vector_size(bytes), aligned(sizeof(T)), may_alias))
+
+// 128-bit vectors
+typedef VECTOR_TYPE(int32_t, 16) v128_s32;
+typedef VECTOR_TYPE(uint32_t, 16) v128_u32;
+typedef VECTOR_TYPE(int64_t, 16) v128_s64;
+typedef VECTOR_TYPE(uint64_t, 16) v128_u64;
+typedef VECTOR_TYPE(double, 16) v128_f64;
+
+DEFINE_KERNELS(vec128, , s32, int32_t, uint32_t, v128_s32, v128_u32,
+	       v128_s32)
+DEFINE_KERNELS(vec128, , s64, int64_t, uint64_t, v128_s64, v128_u64,
+	       v128_s64)
+DEFINE_KERNELS(vec128, , f64, double, double, v128_f64, v128_f64, v128_s64)
+
+static const struct numvec_kernels vec128_kernels = {
+  .name = "vec128",
+  .s32 = KERNELS_OF(vec128, s32),
+  .s64 = KERNELS_OF(vec128, s64),
+  .f64 = KERNELS_OF(vec128, f64),
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_AVX2_KERNELS
+
+#define AVX2 __attribute__((target("avx2")))
+
+// 256-bit vectors
+typedef VECTOR_TYPE(int32_t, 32) v256_s32;
+typedef VECTOR_TYPE(uint32_t, 32) v256_u32;
+typedef VECTOR_TYPE(int64_t, 32) v256_s64;
+typedef VECTOR_TYPE(uint64_t, 32) v256_u64;
+typedef VECTOR_TYPE(double, 32) v256_f64;
+
+DEFINE_KERNELS(avx2, AVX2, s32, int32_t, uint32_t, v256_s32, v256_u32,
+	       v256_s32)
+DEFINE_KERNELS(avx2, AVX2, s64, int64_t, uint64_t, v256_s64, v256_u64,
+	       v256_s64)
+DEFINE_KERNELS(avx2, AVX2, f64, double, double, v256_f64, v256_f64, v256_s64)
+
+static const struct numvec_kernels avx2_kernels = {
+  .name = "avx2",
+  .s32 = KERNELS_OF(avx2, s32),
+  .s64 = KERNELS_OF(avx2, s64),
+  .f64 = KERNELS_OF(avx2, f64),
+};
+#endif
+
+const struct numvec_kernels *numvec_kernels_for(enum numvec_isa isa)
+{
+  switch (isa)
+    {
+    case NUMVEC_ISA_VEC128:
+      return &vec128_kernels;
+    case NUMVEC_ISA_AVX2:
+#ifdef HAVE_AVX2_KERNELS
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2"))
+	return &avx2_kernels;
+#endif
+      return NULL;
+    case NUMVEC_NISAS:
+      break;
+    }
+
+  return NULL;
+}
+
+const struct numvec_kernels *numvec_kernels(void)
+{
+  static const struct numvec_kernels *selected;
+
+  if (selected == NULL)
+    {
+      selected = numvec_kernels_for(NUMVEC_ISA_AVX2);
+      if (selected == NULL)
+	selected = numvec_kernels_for(NUMVEC_ISA_VEC128);
+    }
+
+  return selected;
+}
+
+size_t numvec_elt_size(enum numvec_kind kind)
+{
+  switch (kind)
+    {
+    case NUMVEC_S32:
+      return sizeof(int32_t);
+    case NUMVEC_S64:
+      return sizeof(int64_t);
+    case NUMVEC_F64:
+      return sizeof(double);
+    case NUMVEC_NKINDS:
+      break;
+    }
+
+  return 0;
+}
+
+int numvec_alloc(enum numvec_kind kind, uint32_t len,
+		 struct astnode_numvector **ret)
+{
+  size_t elt_size;
+
+  NULL_CHECK1(ret);
+
+  elt_size = numvec_elt_size(kind);
+  if (elt_size == 0)
+    return EINVAL;
+
+  // All-zero bits are 0 and 0.0 for every kind
+  RETONERR(alloc_astnode_sized(TYPE_NUMVECTOR,
+			       sizeof(struct astnode_numvector) +
+			       (size_t) len * elt_size,
+			       (struct astnode **) ret));
+  (*ret)->kind = kind;
+  (*ret)->len = len;
+
+  return 0;
+}
+
+#define S32(vec) ((int32_t *) (vec)->data)
+#define S64(vec) ((int64_t *) (vec)->data)
+#define F64(vec) ((double *) (vec)->data)
+
+static int s64_to_fixnum(int64_t val, struct astnode **ret)
+{
+  if (val < INT32_MIN || val > INT32_MAX)
+    return EOVERFLOW;
+
+  *ret = make_fixnum((int32_t) val);
+  return 0;
+}
+
+static int f64_to_fixnum(double val, struct astnode **ret)
+{
+  // Both comparisons are false for NaN
+  if (!(val > (double) INT32_MIN - 1 && val < (double) INT32_MAX + 1))
+    return EOVERFLOW;
+
+  *ret = make_fixnum((int32_t) val);
+  return 0;
+}
+
+int numvec_ref(const struct astnode_numvector *vec, uint32_t k,
+	       struct astnode **ret)
+{
+  NULL_CHECK2(vec, ret);
+  if (k >= vec->len)
+    return EINVAL;
+
+  switch (vec->kind)
+    {
+    case NUMVEC_S32:
+      *ret = make_fixnum(S32(vec)[k]);
+      return 0;
+    case NUMVEC_S64:
+      return s64_to_fixnum(S64(vec)[k], ret);
+    case NUMVEC_F64:
+      return f64_to_fixnum(F64(vec)[k], ret);
+    case NUMVEC_NKINDS:
+      break;
+    }
+
+  return EINVAL;
+}
+
+void numvec_set(struct astnode_numvector *vec, uint32_t k, int32_t val)
+{
+  switch (vec->kind)
+    {
+    case NUMVEC_S32:
+      S32(vec)[k] = val;
+      break;
+    case NUMVEC_S64:
+      S64(vec)[k] = val;
+      break;
+    case NUMVEC_F64:
+      F64(vec)[k] = val;
+      break;
+    case NUMVEC_NKINDS:
+      break;
+    }
+}
+
+void numvec_fill(struct astnode_numvector *vec, int32_t val)
+{
+  uint32_t i;
+
+  for (i = 0; i < vec->len; i++)
+    numvec_set(vec, i, val);
+}
+
+static bool same_shape(const struct astnode_numvector *a,
+		       const struct astnode_numvector *b)
+{
+  return a->kind == b->kind && a->len == b->len;
+}
+
+int numvec_map(struct astnode_numvector *dst,
+	       const struct astnode_numvector *a,
+	       const struct astnode_numvector *b, enum numvec_op op)
+{
+  const struct numvec_kernels *kernels = numvec_kernels();
+
+  NULL_CHECK3(dst, a, b);
+  if (!same_shape(dst, a) || !same_shape(dst, b))
+    return EINVAL;
+
+  switch (dst->kind)
+    {
+    case NUMVEC_S32:
+      (op == NUMVEC_MUL ? kernels->s32.mul : kernels->s32.add)
+	(S32(dst), S32(a), S32(b), dst->len);
+      return 0;
+    case NUMVEC_S64:
+      (op == NUMVEC_MUL ? kernels->s64.mul : kernels->s64.add)
+	(S64(dst), S64(a), S64(b), dst->len);
+      return 0;
+    case NUMVEC_F64:
+      (op == NUMVEC_MUL ? kernels->f64.mul : kernels->f64.add)
+	(F64(dst), F64(a), F64(b), dst->len);
+      return 0;
+    case NUMVEC_NKINDS:
+      break;
+    }
+
+  return EINVAL;
+}
+
+int numvec_scale(struct astnode_numvector *dst,
+		 const struct astnode_numvector *a, int32_t k)
+{
+  const struct numvec_kernels *kernels = numvec_kernels();
+
+  NULL_CHECK2(dst, a);
+  if (!same_shape(dst, a))
+    return EINVAL;
+
+  switch (dst->kind)
+    {
+    case NUMVEC_S32:
+      kernels->s32.scale(S32(dst), S32(a), k, dst->len);
+      return 0;
+    case NUMVEC_S64:
+      kernels->s64.scale(S64(dst), S64(a), k, dst->len);
+      return 0;
+    case NUMVEC_F64:
+      kernels->f64.scale(F64(dst), F64(a), k, dst->len);
+      return 0;
+    case NUMVEC_NKINDS:
+      break;
+    }
+
+  return EINVAL;
+}
+
+int numvec_dot(const struct astnode_numvector *a,
+	       const struct astnode_numvector *b, struct astnode **ret)
+{
+  const struct numvec_kernels *kernels = numvec_kernels();
+
+  NULL_CHECK3(a, b, ret);
+  if (!same_shape(a, b))
+    return EINVAL;
+
+  switch (a->kind)
+    {
+    case NUMVEC_S32:
+      *ret = make_fixnum(kernels->s32.dot(S32(a), S32(b), a->len));
+      return 0;
+    case NUMVEC_S64:
+      return s64_to_fixnum(kernels->s64.dot(S64(a), S64(b), a->len), ret);
+    case NUMVEC_F64:
+      return f64_to_fixnum(kernels->f64.dot(F64(a), F64(b), a->len), ret);
+    case NUMVEC_NKINDS:
+      break;
+    }
+
+  return EINVAL;
+}
+
+// Picks the kernel of `kern` that computes `op`.
+#define REDUCTION(kern, op)						\
+  ((op) == NUMVEC_MIN ? (kern).min					\
+   : (op) == NUMVEC_MAX ? (kern).max : (kern).sum)
+
+int numvec_reduce(const struct astnode_numvector *vec,
+		  enum numvec_reduction op, struct astnode **ret)
+{
+  const struct numvec_kernels *kernels = numvec_kernels();
+
+  NULL_CHECK2(vec, ret);
+  if (vec->len == 0 && op != NUMVEC_SUM)
+    return EINVAL;
+
+  switch (vec->kind)
+    {
+    case NUMVEC_S32:
+      *ret = make_fixnum(REDUCTION(kernels->s32, op)(S32(vec), vec->len));
+      return 0;
+    case NUMVEC_S64:
+      return s64_to_fixnum(REDUCTION(kernels->s64, op)(S64(vec), vec->len),
+			   ret);
+    case NUMVEC_F64:
+      return f64_to_fixnum(REDUCTION(kernels->f64, op)(F64(vec), vec->len),
+			   ret);
+    case NUMVEC_NKINDS:
+      break;
+    }
+
+  return EINVAL;
+}
@@ -4,6 +4,12 @@
 #include <stdlib.h>
 #include "inc/ast.h"
 #include "inc/gc.h"
+#include "inc/symbols.h"
+
+// The elements of an open list wait on the value stack until its ')' is read.
+// Past its initial size, bison would move the stack to malloc'd memory, which
+// the GC doesn't scan: keep it on the C stack instead.
+#define YYSTACK_USE_ALLOCA 1
 
 int yylex(bool interactive);
 void yyerror(bool interactive, struct astnode **ret, char const *);
@@ -12,22 +18,35 @@ static struct astnode *
 new_astnode_pair(struct astnode *car, struct astnode *cdr);
 
 static struct astnode *
-new_astnode_emptylist(void);
+new_quote(struct astnode *datum);
+
+static int
+add_to_list(struct astnode *ele);
 
-static struct astnode_pair *
-add_to_list(struct astnode *ele, struct astnode_pair *tail);
+// Where add_to_list links the next top-level expression
+static struct astnode **list_end;
 
-static struct astnode_pair *list_tail;
+// Set by yyparse_one: stop after the first top-level expression, and return
+// it as is rather than in a list.
+static bool one_at_a_time;
 %}
 
+%code provides {
+// Parses the next top-level expression of the input and places it in `ret`, or
+// places NULL there at the end of the input (at the end of the line if
+// `interactive`). Successive calls read successive expressions, so that each
+// one can be evaluated (and its parse tree dropped) before the next one is
+// read. Nothing is allocated besides the parse tree itself.
+int yyparse_one(bool interactive, struct astnode **ret);
+}
+
 %param {bool interactive}
 %parse-param {struct astnode **ret}
 
 %initial-action
 {
-    // This node will be converted into an actual node in add_to_list
-    *ret = new_astnode_emptylist();
-    list_tail = (struct astnode_pair *) *ret;
+    *ret = one_at_a_time ? NULL : (struct astnode *) EMPTY_LIST;
+    list_end = ret;
 }
 
 %define api.value.type {struct astnode *}
@@ -37,25 +56,38 @@ static struct astnode_pair *list_tail;
 
 %%
 input:		%empty
-	|	list-ele               { if ((list_tail = add_to_list($1, list_tail)) == NULL)
-			                   return 2; }
-	|	input list-ele        { if ((list_tail = add_to_list($2, list_tail)) == NULL)
-			                   return 2; }
+	|	list-ele               { if (one_at_a_time)
+			                   {
+			                     *ret = $1;
+			                     YYACCEPT;
+			                   }
+			                 if (add_to_list($1) != 0)
+			                   YYNOMEM; }
+	|	input list-ele        { if (add_to_list($2) != 0)
+			                   YYNOMEM; }
 	;
 
-list:		'(' list-ele list-tail { $$ = new_astnode_pair($2, $3); }
-	|	'(' ')'                { $$ = new_astnode_emptylist(); }
+list:		'(' list-ele list-tail { $$ = new_astnode_pair($2, $3);
+			                 if ($$ == NULL)
+			                   YYNOMEM; }
+	|	'(' ')'                { $$ = (struct astnode *) EMPTY_LIST; }
 	;
 
-list-tail:      list-ele list-tail     { $$ = new_astnode_pair($1, $2); }
-	|       ')'                    { $$ = new_astnode_emptylist(); }
+list-tail:      list-ele list-tail     { $$ = new_astnode_pair($1, $2);
+			                 if ($$ == NULL)
+			                   YYNOMEM; }
+	|       ')'                    { $$ = (struct astnode *) EMPTY_LIST; }
+	|       '.' list-ele ')'       { $$ = $2; }
 	;
 
-pair:           '(' list-ele '.' list-ele ')' { $$ = new_astnode_pair($2, $4); }
+quote:          '\'' list-ele           { $$ = new_quote($2);
+			                 if ($$ == NULL)
+			                   YYNOMEM; }
+	;
 
 list-ele:       EXP
 	|	list
-	|	pair
+	|	quote
         ;
 
 %%
@@ -66,35 +98,69 @@ void yyerror(bool interactive, struct astnode **ret, char const *arg)
     (void) interactive;
     printf("Parse error: %s\n", arg);
 }
+// Returns NULL if out of memory: the actions then stop the parse with
+// YYNOMEM, which makes yyparse return 2.
 static struct astnode *
 new_astnode_pair(struct astnode *car, struct astnode *cdr)
 {
     struct astnode_pair *ret;
 
-    ret = malloc(sizeof(*ret));
-    // TODO: What to do on ENOMEM?
+    // Pairs must come from the managed heap; otherwise the GC would not see the
+    // symbols and numbers they point to.
+    if (alloc_astnode(TYPE_PAIR, (struct astnode **) &ret) != 0)
+	return NULL;
 
-    ret->type = TYPE_PAIR;
     ret->car = car;
     ret->cdr = cdr;
 
     return (struct astnode *) ret;
 }
 
+// Returns (quote `datum`), or NULL if out of memory.
 static struct astnode *
-new_astnode_emptylist(void)
+new_quote(struct astnode *datum)
+{
+    struct astnode_sym *sym;
+    struct astnode *arg;
+
+    if (alloc_astnode(TYPE_SYM, (struct astnode **) &sym) != 0 ||
+	putsym("quote", "quote" + 4, &sym->symi) != 0)
+	return NULL;
+
+    arg = new_astnode_pair(datum, (struct astnode *) EMPTY_LIST);
+    if (arg == NULL)
+	return NULL;
+
+    return new_astnode_pair((struct astnode *) sym, arg);
+}
+
+// Appends `ele` to the list of top-level expressions. Returns non-zero on
+// failure.
+static int
+add_to_list(struct astnode *ele)
 {
-    return new_astnode_pair(NULL, NULL);
+    struct astnode *pair;
+
+    pair = new_astnode_pair(ele, (struct astnode *) EMPTY_LIST);
+    if (pair == NULL)
+	return 1;
+
+    *list_end = pair;
+    list_end = &((struct astnode_pair *) pair)->cdr;
+
+    return 0;
 }
 
-static struct astnode_pair *
-add_to_list(struct astnode *ele, struct astnode_pair *tail)
+// Accepting right after a top-level expression doesn't make the parser read
+// the token that follows it (the reduction to `input` needs no lookahead), so
+// the next call starts at the next expression.
+int yyparse_one(bool interactive, struct astnode **ret)
 {
-    tail->cdr = new_astnode_emptylist();
-    if (tail->cdr == NULL)
-	return NULL;
+    int err;
 
-    tail->car = ele;
+    one_at_a_time = true;
+    err = yyparse(interactive, ret);
+    one_at_a_time = false;
 
-    return (struct astnode_pair *) tail->cdr;
+    return err;
 }
@@ -1,29 +1,20 @@
+#include <setjmp.h>
+
 #include "inc/ast.h"
+#include "inc/cont.h"
+#include "inc/eval.h"
 #include "inc/gc.h"
+#include "inc/numvec.h"
 #include "inc/prmt_handlers.h"
+#include "inc/stackeval.h"
 #include "inc/stdmacros.h"
 
-// e.g. (cons 1 2)
-// args: (1 2)
-int prmt_cons(struct astnode_pair *args, struct astnode **ret)
-{
-  struct astnode *the_car;
-  struct astnode *the_cdr;
-
-  NULL_CHECK2(args, ret);
-  TYPE_CHECK(args, TYPE_PAIR);
-  if (is_empty_list((struct astnode *) args))
-    return EBADMSG;
-
-  the_car = args->car;
-
-  TYPE_CHECK(args->cdr, TYPE_PAIR);
-  the_cdr = ((struct astnode_pair *) args->cdr)->car;
-
-  // If we got more than 2 arguments, fail.
-  if (!is_empty_list(((struct astnode_pair *) args->cdr)->cdr))
-    return EBADMSG;
+// Fixed-arity entry points. The descriptor already checked the types that it
+// can express.
 
+static int cons2(struct astnode *the_car, struct astnode *the_cdr,
+		 struct astnode **ret)
+{
   RETONERR(alloc_astnode(TYPE_PAIR, ret));
   ((struct astnode_pair *)*ret)->car = the_car;
   ((struct astnode_pair *)*ret)->cdr = the_cdr;
@@ -31,298 +22,954 @@ int prmt_cons(struct astnode_pair *args, struct astnode **ret)
   return 0;
 }
 
-// e.g. (car obj)
-// args: (obj)
-int prmt_car(struct astnode_pair *args, struct astnode **ret)
+static int car1(struct astnode *obj, struct astnode **ret)
 {
-  struct astnode_pair *obj;
-
-  NULL_CHECK2(args, ret);
-
-  TYPE_CHECK(args, TYPE_PAIR);
-  if (is_empty_list((struct astnode *) args))
+  // The empty list has the pair type, but no car
+  if (is_empty_list(obj))
     return EBADMSG;
 
-  TYPE_CHECK(args->car, TYPE_PAIR);
-  obj = (struct astnode_pair *) args->car;
+  *ret = ((struct astnode_pair *) obj)->car;
+  return 0;
+}
 
-  // If we got more than 1 argument, fail
-  if (!is_empty_list(args->cdr))
+static int cdr1(struct astnode *obj, struct astnode **ret)
+{
+  if (is_empty_list(obj))
     return EBADMSG;
 
-  *ret = obj->car;
+  *ret = ((struct astnode_pair *) obj)->cdr;
   return 0;
 }
 
-// e.g. (cdr obj)
-// args: (obj)
-int prmt_cdr(struct astnode_pair *args, struct astnode **ret)
+static int is_pair1(struct astnode *obj, struct astnode **ret)
 {
-  struct astnode_pair *obj;
+  // We is_empty_list first, without assuming that its type is also pair
+  // (implementation might change later).
+  *ret = make_boolean(!is_empty_list(obj) &&
+		      astnode_type_of(obj) == TYPE_PAIR);
 
-  NULL_CHECK2(args, ret);
+  return 0;
+}
 
-  TYPE_CHECK(args, TYPE_PAIR);
-  if (is_empty_list((struct astnode *) args))
-    return EBADMSG;
+static int is_eq2(struct astnode *first, struct astnode *second,
+		  struct astnode **ret);
 
-  TYPE_CHECK(args->car, TYPE_PAIR);
-  obj = (struct astnode_pair *) args->car;
+// e.g. (cons 1 2)
+// args: 1 2
+int prmt_cons(struct astnode **args, uint32_t nargs, struct astnode **ret)
+{
+  NULL_CHECK1(ret);
 
-  // If we got more than 1 argument, fail
-  if (!is_empty_list(args->cdr))
+  if (nargs != 2)
     return EBADMSG;
 
-  *ret = obj->cdr;
-  return 0;
+  return cons2(args[0], args[1], ret);
 }
 
-int prmt_is_pair(struct astnode_pair *args, struct astnode **ret)
+// e.g. (car obj)
+// args: obj
+int prmt_car(struct astnode **args, uint32_t nargs, struct astnode **ret)
 {
-  struct astnode *obj;
+  NULL_CHECK1(ret);
 
-  NULL_CHECK2(args, ret);
-
-  TYPE_CHECK(args, TYPE_PAIR);
-  if (is_empty_list((struct astnode *) args))
+  if (nargs != 1)
     return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_PAIR);
 
-  // If we got more than 1 argument, fail
-  if (!is_empty_list(args->cdr))
-    return EBADMSG;
+  return car1(args[0], ret);
+}
 
-  obj = args->car;
+// e.g. (cdr obj)
+// args: obj
+int prmt_cdr(struct astnode **args, uint32_t nargs, struct astnode **ret)
+{
+  NULL_CHECK1(ret);
 
-  // We is_empty_list first, without assuming that its type is also pair
-  // (implementation might change later).
-  if (is_empty_list(obj))
-    *ret = (struct astnode *) BOOLEAN_FALSE;
-  else if (obj->type == TYPE_PAIR)
-    *ret = (struct astnode *) BOOLEAN_TRUE;
-  else
-    *ret = (struct astnode *) BOOLEAN_FALSE;
+  if (nargs != 1)
+    return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_PAIR);
 
-  return 0;
+  return cdr1(args[0], ret);
 }
 
-int prmt_plus(struct astnode_pair *args, struct astnode **ret)
+int prmt_is_pair(struct astnode **args, uint32_t nargs, struct astnode **ret)
 {
-  struct astnode_int *sum;
+  NULL_CHECK1(ret);
+
+  if (nargs != 1)
+    return EBADMSG;
 
-  NULL_CHECK2(args, ret);
+  return is_pair1(args[0], ret);
+}
+
+int prmt_plus(struct astnode **args, uint32_t nargs, struct astnode **ret)
+{
+  int32_t sum;
+  uint32_t i;
 
-  RETONERR(alloc_astnode(TYPE_INT, (struct astnode **)&sum));
+  NULL_CHECK1(ret);
 
-  for (sum->intval = 0;
-       !is_empty_list((struct astnode *) args);
-       args = (struct astnode_pair *) args->cdr)
+  for (sum = 0, i = 0; i < nargs; i++)
     {
-      TYPE_CHECK(args, TYPE_PAIR);
-      TYPE_CHECK(args->car, TYPE_INT);
+      TYPE_CHECK(args[i], TYPE_INT);
 
-      sum->intval += ((struct astnode_int *)args->car)->intval;
+      sum += fixnum_val(args[i]);
     }
 
-  *ret = (struct astnode *) sum;
+  *ret = make_fixnum(sum);
 
   return 0;
 }
 
-int prmt_minus(struct astnode_pair *args, struct astnode **ret)
+int prmt_minus(struct astnode **args, uint32_t nargs, struct astnode **ret)
 {
-  int32_t initval;
-  struct astnode_int *sum;
-
-  NULL_CHECK2(args, ret);
+  int32_t sum;
+  uint32_t i;
 
-  TYPE_CHECK(args->car, TYPE_INT);
-  initval = ((struct astnode_int *)args->car)->intval;
-  args = (struct astnode_pair *)args->cdr;
+  NULL_CHECK1(ret);
 
-  RETONERR(alloc_astnode(TYPE_INT, (struct astnode **)&sum));
+  if (nargs == 0)
+    return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_INT);
+  sum = fixnum_val(args[0]);
 
-  if (is_empty_list((struct astnode *)args))
+  if (nargs == 1)
     {
       // If we only have one argument, the result is the negative of the
       // argument
-      sum->intval = -initval;
-      *ret = (struct astnode *) sum;
+      *ret = make_fixnum(-sum);
       return 0;
     }
 
-  for (sum->intval = initval;
-       !is_empty_list((struct astnode *) args);
-       args = (struct astnode_pair *) args->cdr)
+  for (i = 1; i < nargs; i++)
     {
-      TYPE_CHECK(args, TYPE_PAIR);
-      TYPE_CHECK(args->car, TYPE_INT);
+      TYPE_CHECK(args[i], TYPE_INT);
 
-      sum->intval -= ((struct astnode_int *)args->car)->intval;
+      sum -= fixnum_val(args[i]);
     }
 
-  *ret = (struct astnode *) sum;
+  *ret = make_fixnum(sum);
 
   return 0;
 }
 
-int prmt_mult(struct astnode_pair *args, struct astnode **ret)
+int prmt_mult(struct astnode **args, uint32_t nargs, struct astnode **ret)
 {
-  struct astnode_int *product;
-
-  NULL_CHECK2(args, ret);
+  int32_t product;
+  uint32_t i;
 
-  RETONERR(alloc_astnode(TYPE_INT, (struct astnode **)&product));
+  NULL_CHECK1(ret);
 
-  for (product->intval = 1;
-       !is_empty_list((struct astnode *) args);
-       args = (struct astnode_pair *) args->cdr)
+  for (product = 1, i = 0; i < nargs; i++)
     {
-      TYPE_CHECK(args, TYPE_PAIR);
-      TYPE_CHECK(args->car, TYPE_INT);
+      TYPE_CHECK(args[i], TYPE_INT);
 
-      product->intval *= ((struct astnode_int *)args->car)->intval;
+      product *= fixnum_val(args[i]);
     }
 
-  *ret = (struct astnode *) product;
+  *ret = make_fixnum(product);
 
   return 0;
 }
 
-int prmt_div(struct astnode_pair *args, struct astnode **ret)
+// Places `dividend` / `divisor` in `quotient`, unless the division would trap:
+// by zero, or INT32_MIN by -1 (whose quotient doesn't fit).
+static int checked_div(int32_t dividend, int32_t divisor, int32_t *quotient)
 {
-  int32_t initval;
-  struct astnode_int *sum;
+  if (divisor == 0 || (dividend == INT32_MIN && divisor == -1))
+    return EBADMSG;
+
+  *quotient = dividend / divisor;
+  return 0;
+}
 
-  NULL_CHECK2(args, ret);
+int prmt_div(struct astnode **args, uint32_t nargs, struct astnode **ret)
+{
+  int32_t quotient;
+  uint32_t i;
 
-  TYPE_CHECK(args->car, TYPE_INT);
-  initval = ((struct astnode_int *)args->car)->intval;
-  args = (struct astnode_pair *)args->cdr;
+  NULL_CHECK1(ret);
 
-  RETONERR(alloc_astnode(TYPE_INT, (struct astnode **)&sum));
+  if (nargs == 0)
+    return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_INT);
+  quotient = fixnum_val(args[0]);
 
-  if (is_empty_list((struct astnode *)args))
+  if (nargs == 1)
     {
       // If we only have one argument, the result is the quotient of 1 and the
       // argument.
-      sum->intval = 1 / initval;
-      *ret = (struct astnode *) sum;
+      RETONERR(checked_div(1, quotient, &quotient));
+      *ret = make_fixnum(quotient);
       return 0;
     }
 
-  for (sum->intval = initval;
-       !is_empty_list((struct astnode *) args);
-       args = (struct astnode_pair *) args->cdr)
+  for (i = 1; i < nargs; i++)
     {
-      TYPE_CHECK(args, TYPE_PAIR);
-      TYPE_CHECK(args->car, TYPE_INT);
-
-      sum->intval /= ((struct astnode_int *)args->car)->intval;
+      TYPE_CHECK(args[i], TYPE_INT);
+      RETONERR(checked_div(quotient, fixnum_val(args[i]), &quotient));
     }
 
-  *ret = (struct astnode *) sum;
+  *ret = make_fixnum(quotient);
 
   return 0;
 }
 
-int prmt_equal(struct astnode_pair *args, struct astnode **ret)
+int prmt_equal(struct astnode **args, uint32_t nargs, struct astnode **ret)
 {
-  int firstval;
-  struct astnode_boolean *result;
-  bool isfirst = true;
+  bool equal;
+  uint32_t i;
+
+  NULL_CHECK1(ret);
+
+  for (equal = true, i = 0; i < nargs; i++)
+    {
+      TYPE_CHECK(args[i], TYPE_INT);
 
-  NULL_CHECK2(args, ret);
+      if (fixnum_val(args[i]) != fixnum_val(args[0]))
+	{
+	  equal = false;
+	  break;
+	}
+    }
 
-  RETONERR(alloc_astnode(TYPE_BOOLEAN, (struct astnode **)&result));
+  *ret = make_boolean(equal);
 
+  return 0;
+}
+
+// Whether each argument is less than (or, if `greater`, greater than) the
+// next one.
+static int compare(struct astnode **args, uint32_t nargs, bool greater,
+		   struct astnode **ret)
+{
+  bool ordered;
+  uint32_t i;
 
+  NULL_CHECK1(ret);
 
-  for (result->boolval = true;
-       !is_empty_list((struct astnode *) args);
-       args = (struct astnode_pair *) args->cdr)
+  for (ordered = true, i = 0; i < nargs; i++)
     {
-      TYPE_CHECK(args, TYPE_PAIR);
-      TYPE_CHECK(args->car, TYPE_INT);
+      TYPE_CHECK(args[i], TYPE_INT);
 
-      if (isfirst)
-	{
-	  firstval = ((struct astnode_int *)args->car)->intval;
-	  isfirst = false;
-	}
-      else
-	{
-	  if (((struct astnode_int *)args->car)->intval != firstval)
-	    {
-	      result->boolval = false;
-	      break;
-	    }
-	}
+      if (i > 0 && ordered)
+	ordered = greater ? fixnum_val(args[i - 1]) > fixnum_val(args[i])
+	  : fixnum_val(args[i - 1]) < fixnum_val(args[i]);
     }
 
-  *ret = (struct astnode *) result;
+  *ret = make_boolean(ordered);
 
   return 0;
 }
 
-int prmt_is_eq(struct astnode_pair *args, struct astnode **ret)
+int prmt_less(struct astnode **args, uint32_t nargs, struct astnode **ret)
+{
+  return compare(args, nargs, false, ret);
+}
+
+int prmt_greater(struct astnode **args, uint32_t nargs, struct astnode **ret)
+{
+  return compare(args, nargs, true, ret);
+}
+
+int prmt_is_eq(struct astnode **args, uint32_t nargs, struct astnode **ret)
+{
+  NULL_CHECK1(ret);
+
+  if (nargs != 2)
+    return EBADMSG;
+
+  return is_eq2(args[0], args[1], ret);
+}
+
+static int is_eq2(struct astnode *first, struct astnode *second,
+		  struct astnode **ret)
 {
-  struct astnode *first;
-  struct astnode *second;
   bool eq;
 
-  NULL_CHECK2(args, ret);
+  if (astnode_type_of(first) != astnode_type_of(second))
+    {
+      *ret = make_boolean(false);
+      return 0;
+    }
+
+  eq = false;
+  switch(astnode_type_of(first))
+    {
+    case TYPE_SYM:
+      eq = ((struct astnode_sym *)first)->symi ==
+	((struct astnode_sym *)second)->symi;
+      break;
+      // Fixnums with the same value are the same word, and there is only one
+      // object for each boolean and for the empty list
+    case TYPE_INT:
+    case TYPE_BOOLEAN:
+    case TYPE_PAIR:
+    case TYPE_ENV:
+    case TYPE_KEYWORD:
+    case TYPE_PRMTPROC:
+    case TYPE_COMPPROC:
+    case TYPE_LEXADDR:
+    case TYPE_CODE:
+    case TYPE_EXEC:
+    case TYPE_CONT:
+    case TYPE_VECTOR:
+    case TYPE_NUMVECTOR:
+      eq = (first == second);
+      break;
+    case TYPE_MAX:
+      return EBADMSG;
+    }
+
+  *ret = make_boolean(eq);
+
+  return 0;
+}
+
+static int vector_ref2(struct astnode *vector, struct astnode *k,
+		       struct astnode **ret)
+{
+  struct astnode_vector *vec = (struct astnode_vector *) vector;
 
-  if (is_empty_list((struct astnode *)args))
+  if (fixnum_val(k) < 0 || (uint32_t) fixnum_val(k) >= vec->len)
     return EBADMSG;
-  first = args->car;
 
-  args = (struct astnode_pair *)args->cdr;
-  TYPE_CHECK(args, TYPE_PAIR);
-  second = args->car;
+  *ret = vec->elts[fixnum_val(k)];
+  return 0;
+}
 
-  if (!is_empty_list(args->cdr))
+static int vector_length1(struct astnode *vector, struct astnode **ret)
+{
+  *ret = make_fixnum(((struct astnode_vector *) vector)->len);
+  return 0;
+}
+
+static int vector_fill2(struct astnode *vector, struct astnode *fill,
+			struct astnode **ret)
+{
+  struct astnode_vector *vec = (struct astnode_vector *) vector;
+  uint32_t i;
+
+  for (i = 0; i < vec->len; i++)
+    vec->elts[i] = fill;
+
+  *ret = fill;
+  return 0;
+}
+
+// e.g. (make-vector 3 0)
+// args: k [fill]
+// Without `fill`, the elements are #f.
+int prmt_make_vector(struct astnode **args, uint32_t nargs,
+		     struct astnode **ret)
+{
+  struct astnode_vector *vector;
+  struct astnode *fill;
+  int32_t len;
+
+  NULL_CHECK1(ret);
+
+  if (nargs < 1 || nargs > 2)
+    return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_INT);
+  len = fixnum_val(args[0]);
+  if (len < 0)
     return EBADMSG;
+  fill = nargs == 2 ? args[1] : make_boolean(false);
 
-  // If we get here, arguments are valid
-  RETONERR(alloc_astnode(TYPE_BOOLEAN, ret));
+  RETONERR(alloc_astnode_sized(TYPE_VECTOR, sizeof(struct astnode_vector) +
+			       (size_t) len * sizeof(struct astnode *),
+			       (struct astnode **) &vector));
+  vector->len = len;
+  RETONERR(vector_fill2((struct astnode *) vector, fill, &fill));
+
+  *ret = (struct astnode *) vector;
+
+  return 0;
+}
 
-  if (first->type != second->type)
+// e.g. (vector-ref v 0)
+// args: v k
+int prmt_vector_ref(struct astnode **args, uint32_t nargs,
+		    struct astnode **ret)
+{
+  NULL_CHECK1(ret);
+
+  if (nargs != 2)
+    return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_VECTOR);
+  TYPE_CHECK(args[1], TYPE_INT);
+
+  return vector_ref2(args[0], args[1], ret);
+}
+
+// e.g. (vector-set! v 0 obj)
+// args: v k obj
+// Like define, returns the value that was stored.
+int prmt_vector_set(struct astnode **args, uint32_t nargs,
+		    struct astnode **ret)
+{
+  struct astnode_vector *vector;
+  int32_t k;
+
+  NULL_CHECK1(ret);
+
+  if (nargs != 3)
+    return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_VECTOR);
+  TYPE_CHECK(args[1], TYPE_INT);
+
+  vector = (struct astnode_vector *) args[0];
+  k = fixnum_val(args[1]);
+  if (k < 0 || (uint32_t) k >= vector->len)
+    return EBADMSG;
+
+  vector->elts[k] = args[2];
+  *ret = args[2];
+
+  return 0;
+}
+
+// e.g. (vector-length v)
+// args: v
+int prmt_vector_length(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret)
+{
+  NULL_CHECK1(ret);
+
+  if (nargs != 1)
+    return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_VECTOR);
+
+  return vector_length1(args[0], ret);
+}
+
+// e.g. (vector-fill! v obj)
+// args: v obj
+// Returns `obj`.
+int prmt_vector_fill(struct astnode **args, uint32_t nargs,
+		     struct astnode **ret)
+{
+  NULL_CHECK1(ret);
+
+  if (nargs != 2)
+    return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_VECTOR);
+
+  return vector_fill2(args[0], args[1], ret);
+}
+
+// Numeric vectors: the handlers shared by the three kinds, which the
+// prmt_<kind>vector_* functions below call with their kind.
+
+// e.g. (make-s32vector 3 0)
+// args: k [fill]
+// Without `fill`, the elements are 0.
+static int make_numvector(enum numvec_kind kind, struct astnode **args,
+			  uint32_t nargs, struct astnode **ret)
+{
+  struct astnode_numvector *vec;
+  int32_t len;
+
+  NULL_CHECK1(ret);
+
+  if (nargs < 1 || nargs > 2)
+    return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_INT);
+  if (nargs == 2)
+    TYPE_CHECK(args[1], TYPE_INT);
+  len = fixnum_val(args[0]);
+  if (len < 0)
+    return EBADMSG;
+
+  RETONERR(numvec_alloc(kind, len, &vec));
+  if (nargs == 2)
+    numvec_fill(vec, fixnum_val(args[1]));
+
+  *ret = (struct astnode *) vec;
+
+  return 0;
+}
+
+// Checks that `node` is a numeric vector of kind `kind`.
+static bool is_numvector_of(struct astnode *node, enum numvec_kind kind)
+{
+  return node != NULL && astnode_type_of(node) == TYPE_NUMVECTOR &&
+    ((struct astnode_numvector *) node)->kind == kind;
+}
+
+// Checks that `k` is an index of the numeric vector `vec`.
+static bool is_numvector_index(struct astnode *vec, struct astnode *k)
+{
+  return astnode_type_of(k) == TYPE_INT && fixnum_val(k) >= 0 &&
+    (uint32_t) fixnum_val(k) < ((struct astnode_numvector *) vec)->len;
+}
+
+// e.g. (s32vector-ref v 0)
+// args: v k
+static int numvector_ref(enum numvec_kind kind, struct astnode **args,
+			 uint32_t nargs, struct astnode **ret)
+{
+  NULL_CHECK1(ret);
+
+  if (nargs != 2 || !is_numvector_of(args[0], kind) ||
+      !is_numvector_index(args[0], args[1]))
+    return EBADMSG;
+
+  return numvec_ref((struct astnode_numvector *) args[0],
+		    fixnum_val(args[1]), ret);
+}
+
+// e.g. (s32vector-set! v 0 1)
+// args: v k n
+// Returns `n`.
+static int numvector_set(enum numvec_kind kind, struct astnode **args,
+			 uint32_t nargs, struct astnode **ret)
+{
+  NULL_CHECK1(ret);
+
+  if (nargs != 3 || !is_numvector_of(args[0], kind) ||
+      !is_numvector_index(args[0], args[1]))
+    return EBADMSG;
+  TYPE_CHECK(args[2], TYPE_INT);
+
+  numvec_set((struct astnode_numvector *) args[0], fixnum_val(args[1]),
+	     fixnum_val(args[2]));
+  *ret = args[2];
+
+  return 0;
+}
+
+// e.g. (s32vector-length v)
+// args: v
+static int numvector_length(enum numvec_kind kind, struct astnode **args,
+			    uint32_t nargs, struct astnode **ret)
+{
+  NULL_CHECK1(ret);
+
+  if (nargs != 1 || !is_numvector_of(args[0], kind))
+    return EBADMSG;
+
+  *ret = make_fixnum(((struct astnode_numvector *) args[0])->len);
+
+  return 0;
+}
+
+#define NUMVECTOR_HANDLERS(tag, kind)					\
+  int prmt_make_##tag##vector(struct astnode **args, uint32_t nargs,	\
+			      struct astnode **ret)			\
+  {									\
+    return make_numvector(kind, args, nargs, ret);			\
+  }									\
+									\
+  int prmt_##tag##vector_ref(struct astnode **args, uint32_t nargs,	\
+			     struct astnode **ret)			\
+  {									\
+    return numvector_ref(kind, args, nargs, ret);			\
+  }									\
+									\
+  int prmt_##tag##vector_set(struct astnode **args, uint32_t nargs,	\
+			     struct astnode **ret)			\
+  {									\
+    return numvector_set(kind, args, nargs, ret);			\
+  }									\
+									\
+  int prmt_##tag##vector_length(struct astnode **args, uint32_t nargs,	\
+				struct astnode **ret)			\
+  {									\
+    return numvector_length(kind, args, nargs, ret);			\
+  }
+
+NUMVECTOR_HANDLERS(s32, NUMVEC_S32)
+NUMVECTOR_HANDLERS(s64, NUMVEC_S64)
+NUMVECTOR_HANDLERS(f64, NUMVEC_F64)
+
+// Checks that `a` and `b` are numeric vectors of the same kind and length.
+static bool same_numvector_shape(struct astnode *a, struct astnode *b)
+{
+  struct astnode_numvector *va = (struct astnode_numvector *) a;
+  struct astnode_numvector *vb = (struct astnode_numvector *) b;
+
+  return a != NULL && b != NULL && astnode_type_of(a) == TYPE_NUMVECTOR &&
+    astnode_type_of(b) == TYPE_NUMVECTOR && va->kind == vb->kind &&
+    va->len == vb->len;
+}
+
+// e.g. (numvector-add a b)
+// args: a b
+// Returns a new vector.
+static int numvector_map(struct astnode **args, uint32_t nargs,
+			 enum numvec_op op, struct astnode **ret)
+{
+  struct astnode_numvector *a;
+  struct astnode_numvector *dst;
+
+  NULL_CHECK1(ret);
+
+  if (nargs != 2 || !same_numvector_shape(args[0], args[1]))
+    return EBADMSG;
+  a = (struct astnode_numvector *) args[0];
+
+  RETONERR(numvec_alloc(a->kind, a->len, &dst));
+  RETONERR(numvec_map(dst, a, (struct astnode_numvector *) args[1], op));
+  *ret = (struct astnode *) dst;
+
+  return 0;
+}
+
+int prmt_numvector_add(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret)
+{
+  return numvector_map(args, nargs, NUMVEC_ADD, ret);
+}
+
+int prmt_numvector_mul(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret)
+{
+  return numvector_map(args, nargs, NUMVEC_MUL, ret);
+}
+
+// e.g. (numvector-scale v 3)
+// args: v k
+// Returns a new vector.
+int prmt_numvector_scale(struct astnode **args, uint32_t nargs,
+			 struct astnode **ret)
+{
+  struct astnode_numvector *a;
+  struct astnode_numvector *dst;
+
+  NULL_CHECK1(ret);
+
+  if (nargs != 2)
+    return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_NUMVECTOR);
+  TYPE_CHECK(args[1], TYPE_INT);
+  a = (struct astnode_numvector *) args[0];
+
+  RETONERR(numvec_alloc(a->kind, a->len, &dst));
+  RETONERR(numvec_scale(dst, a, fixnum_val(args[1])));
+  *ret = (struct astnode *) dst;
+
+  return 0;
+}
+
+// e.g. (numvector-dot a b)
+// args: a b
+int prmt_numvector_dot(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret)
+{
+  NULL_CHECK1(ret);
+
+  if (nargs != 2 || !same_numvector_shape(args[0], args[1]))
+    return EBADMSG;
+
+  return numvec_dot((struct astnode_numvector *) args[0],
+		    (struct astnode_numvector *) args[1], ret);
+}
+
+// e.g. (numvector-sum v)
+// args: v
+static int numvector_reduce(struct astnode **args, uint32_t nargs,
+			    enum numvec_reduction op, struct astnode **ret)
+{
+  struct astnode_numvector *vec;
+
+  NULL_CHECK1(ret);
+
+  if (nargs != 1)
+    return EBADMSG;
+  TYPE_CHECK(args[0], TYPE_NUMVECTOR);
+  vec = (struct astnode_numvector *) args[0];
+  // There is no smallest element of an empty vector
+  if (vec->len == 0 && op != NUMVEC_SUM)
+    return EBADMSG;
+
+  return numvec_reduce(vec, op, ret);
+}
+
+int prmt_numvector_sum(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret)
+{
+  return numvector_reduce(args, nargs, NUMVEC_SUM, ret);
+}
+
+int prmt_numvector_min(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret)
+{
+  return numvector_reduce(args, nargs, NUMVEC_MIN, ret);
+}
+
+int prmt_numvector_max(struct astnode **args, uint32_t nargs,
+		       struct astnode **ret)
+{
+  return numvector_reduce(args, nargs, NUMVEC_MAX, ret);
+}
+
+// args: receiver
+// The receiver runs on the C stack, under an escape its continuation longjmps
+// back to. The stack evaluator doesn't come here: it runs call/cc itself.
+int prmt_call_cc(struct astnode **args, uint32_t nargs, struct astnode **ret)
+{
+  struct cont_escape escape;
+  struct astnode_cont *cont;
+  struct astnode *receiver;
+  int err;
+
+  NULL_CHECK1(ret);
+
+  if (nargs != 1)
+    return EBADMSG;
+  receiver = args[0];
+
+  cont_enter(&escape, false);
+  if (setjmp(escape.buf) != 0)
     {
-      ((struct astnode_boolean *)*ret)->boolval = false;
+      // The continuation was called
+      cont_leave(&escape);
+      *ret = escape.val;
       return 0;
     }
 
-  if (is_empty_list(first) && is_empty_list(second))
-    eq = true;
-  else
+  err = cont_make(&escape, stackeval_height(), &cont);
+  if (err == 0)
+    err = apply_args(receiver, (struct astnode **) &cont, 1, ret);
+
+  cont_deactivate(&escape);
+  cont_leave(&escape);
+
+  return err;
+}
+
+#define PROCS								\
+  (PRMT_TYPE(TYPE_PRMTPROC) | PRMT_TYPE(TYPE_COMPPROC) | PRMT_TYPE(TYPE_CONT))
+
+#define NUMVECTOR PRMT_TYPE(TYPE_NUMVECTOR)
+
+#define ALL_INTS							\
+  { PRMT_TYPE(TYPE_INT), PRMT_TYPE(TYPE_INT), PRMT_TYPE(TYPE_INT) }
+
+const struct prmt_desc prmt_descs[] = {
+  {
+    .name = "cons", .min_args = 2, .max_args = 2,
+    .arg_types = { PRMT_ANY },
+    .handler = prmt_cons, .handler2 = cons2
+  },
+  {
+    .name = "car", .min_args = 1, .max_args = 1,
+    .arg_types = { PRMT_TYPE(TYPE_PAIR) },
+    .handler = prmt_car, .handler1 = car1
+  },
+  {
+    .name = "cdr", .min_args = 1, .max_args = 1,
+    .arg_types = { PRMT_TYPE(TYPE_PAIR) },
+    .handler = prmt_cdr, .handler1 = cdr1
+  },
+  {
+    .name = "pair?", .min_args = 1, .max_args = 1,
+    .arg_types = { PRMT_ANY },
+    .handler = prmt_is_pair, .handler1 = is_pair1
+  },
+  {
+    .name = "+", .min_args = 0, .max_args = PRMT_VARIADIC,
+    .arg_types = ALL_INTS,
+    .handler = prmt_plus
+  },
+  {
+    .name = "-", .min_args = 1, .max_args = PRMT_VARIADIC,
+    .arg_types = ALL_INTS,
+    .handler = prmt_minus
+  },
+  {
+    .name = "*", .min_args = 0, .max_args = PRMT_VARIADIC,
+    .arg_types = ALL_INTS,
+    .handler = prmt_mult
+  },
+  {
+    .name = "/", .min_args = 1, .max_args = PRMT_VARIADIC,
+    .arg_types = ALL_INTS,
+    .handler = prmt_div
+  },
+  {
+    .name = "=", .min_args = 0, .max_args = PRMT_VARIADIC,
+    .arg_types = ALL_INTS,
+    .handler = prmt_equal
+  },
+  {
+    .name = "<", .min_args = 0, .max_args = PRMT_VARIADIC,
+    .arg_types = ALL_INTS,
+    .handler = prmt_less
+  },
+  {
+    .name = ">", .min_args = 0, .max_args = PRMT_VARIADIC,
+    .arg_types = ALL_INTS,
+    .handler = prmt_greater
+  },
+  {
+    .name = "eq?", .min_args = 2, .max_args = 2,
+    .arg_types = { PRMT_ANY },
+    .handler = prmt_is_eq, .handler2 = is_eq2
+  },
+  {
+    .name = "make-vector", .min_args = 1, .max_args = 2,
+    .arg_types = { PRMT_TYPE(TYPE_INT), PRMT_ANY },
+    .handler = prmt_make_vector
+  },
+  {
+    .name = "vector-ref", .min_args = 2, .max_args = 2,
+    .arg_types = { PRMT_TYPE(TYPE_VECTOR), PRMT_TYPE(TYPE_INT) },
+    .handler = prmt_vector_ref, .handler2 = vector_ref2
+  },
+  {
+    .name = "vector-set!", .min_args = 3, .max_args = 3,
+    .arg_types = { PRMT_TYPE(TYPE_VECTOR), PRMT_TYPE(TYPE_INT), PRMT_ANY },
+    .handler = prmt_vector_set
+  },
+  {
+    .name = "vector-length", .min_args = 1, .max_args = 1,
+    .arg_types = { PRMT_TYPE(TYPE_VECTOR) },
+    .handler = prmt_vector_length, .handler1 = vector_length1
+  },
+  {
+    .name = "vector-fill!", .min_args = 2, .max_args = 2,
+    .arg_types = { PRMT_TYPE(TYPE_VECTOR), PRMT_ANY },
+    .handler = prmt_vector_fill, .handler2 = vector_fill2
+  },
+  {
+    .name = "make-s32vector", .min_args = 1, .max_args = 2,
+    .arg_types = ALL_INTS,
+    .handler = prmt_make_s32vector
+  },
+  {
+    .name = "s32vector-ref", .min_args = 2, .max_args = 2,
+    .arg_types = { NUMVECTOR, PRMT_TYPE(TYPE_INT) },
+    .handler = prmt_s32vector_ref
+  },
+  {
+    .name = "s32vector-set!", .min_args = 3, .max_args = 3,
+    .arg_types = { NUMVECTOR, PRMT_TYPE(TYPE_INT), PRMT_TYPE(TYPE_INT) },
+    .handler = prmt_s32vector_set
+  },
+  {
+    .name = "s32vector-length", .min_args = 1, .max_args = 1,
+    .arg_types = { NUMVECTOR },
+    .handler = prmt_s32vector_length
+  },
+  {
+    .name = "make-s64vector", .min_args = 1, .max_args = 2,
+    .arg_types = ALL_INTS,
+    .handler = prmt_make_s64vector
+  },
+  {
+    .name = "s64vector-ref", .min_args = 2, .max_args = 2,
+    .arg_types = { NUMVECTOR, PRMT_TYPE(TYPE_INT) },
+    .handler = prmt_s64vector_ref
+  },
+  {
+    .name = "s64vector-set!", .min_args = 3, .max_args = 3,
+    .arg_types = { NUMVECTOR, PRMT_TYPE(TYPE_INT), PRMT_TYPE(TYPE_INT) },
+    .handler = prmt_s64vector_set
+  },
+  {
+    .name = "s64vector-length", .min_args = 1, .max_args = 1,
+    .arg_types = { NUMVECTOR },
+    .handler = prmt_s64vector_length
+  },
+  {
+    .name = "make-f64vector", .min_args = 1, .max_args = 2,
+    .arg_types = ALL_INTS,
+    .handler = prmt_make_f64vector
+  },
+  {
+    .name = "f64vector-ref", .min_args = 2, .max_args = 2,
+    .arg_types = { NUMVECTOR, PRMT_TYPE(TYPE_INT) },
+    .handler = prmt_f64vector_ref
+  },
+  {
+    .name = "f64vector-set!", .min_args = 3, .max_args = 3,
+    .arg_types = { NUMVECTOR, PRMT_TYPE(TYPE_INT), PRMT_TYPE(TYPE_INT) },
+    .handler = prmt_f64vector_set
+  },
+  {
+    .name = "f64vector-length", .min_args = 1, .max_args = 1,
+    .arg_types = { NUMVECTOR },
+    .handler = prmt_f64vector_length
+  },
+  {
+    .name = "numvector-add", .min_args = 2, .max_args = 2,
+    .arg_types = { NUMVECTOR, NUMVECTOR },
+    .handler = prmt_numvector_add
+  },
+  {
+    .name = "numvector-mul", .min_args = 2, .max_args = 2,
+    .arg_types = { NUMVECTOR, NUMVECTOR },
+    .handler = prmt_numvector_mul
+  },
+  {
+    .name = "numvector-scale", .min_args = 2, .max_args = 2,
+    .arg_types = { NUMVECTOR, PRMT_TYPE(TYPE_INT) },
+    .handler = prmt_numvector_scale
+  },
+  {
+    .name = "numvector-dot", .min_args = 2, .max_args = 2,
+    .arg_types = { NUMVECTOR, NUMVECTOR },
+    .handler = prmt_numvector_dot
+  },
+  {
+    .name = "numvector-sum", .min_args = 1, .max_args = 1,
+    .arg_types = { NUMVECTOR },
+    .handler = prmt_numvector_sum
+  },
+  {
+    .name = "numvector-min", .min_args = 1, .max_args = 1,
+    .arg_types = { NUMVECTOR },
+    .handler = prmt_numvector_min
+  },
+  {
+    .name = "numvector-max", .min_args = 1, .max_args = 1,
+    .arg_types = { NUMVECTOR },
+    .handler = prmt_numvector_max
+  },
+  {
+    .name = "call-with-current-continuation", .min_args = 1, .max_args = 1,
+    .arg_types = { PROCS },
+    .handler = prmt_call_cc
+  },
+  {
+    .name = "call/cc", .min_args = 1, .max_args = 1,
+    .arg_types = { PROCS },
+    .handler = prmt_call_cc
+  },
+};
+
+const uint32_t prmt_ndescs = sizeof(prmt_descs) / sizeof(prmt_descs[0]);
+
+int prmt_apply(const struct prmt_desc *desc, struct astnode **args,
+	       uint32_t nargs, struct astnode **ret)
+{
+  uint32_t types;
+  uint32_t i;
+
+  NULL_CHECK2(desc, ret);
+  if (args == NULL && nargs > 0)
+    return EINVAL;
+
+  if (nargs < desc->min_args || nargs > desc->max_args)
+    return EBADMSG;
+
+  for (i = 0; i < nargs; i++)
     {
-      switch(first->type)
-	{
-	case TYPE_SYM:
-	  eq = ((struct astnode_sym *)first)->symi ==
-	    ((struct astnode_sym *)second)->symi;
-	  break;
-	case TYPE_INT:
-	  eq = ((struct astnode_int *)first)->intval ==
-	    ((struct astnode_int *)second)->intval;
-	  break;
-	case TYPE_BOOLEAN:
-	  eq = ((struct astnode_boolean *)first)->boolval ==
-	    ((struct astnode_boolean *)second)->boolval;
-	  break;
-	case TYPE_PAIR:
-	case TYPE_ENV:
-	case TYPE_KEYWORD:
-	case TYPE_PRMTPROC:
-	case TYPE_COMPPROC:
-	  eq = (first == second);
-	  break;
-	case TYPE_MAX:
-	  return EBADMSG;
-	}
+      types = desc->arg_types[i < PRMT_MAX_TYPED_ARGS ?
+			      i : PRMT_MAX_TYPED_ARGS - 1];
+      if (types != PRMT_ANY &&
+	  (args[i] == NULL ||
+	   (types & PRMT_TYPE(astnode_type_of(args[i]))) == 0))
+	return EBADMSG;
     }
 
-  ((struct astnode_boolean *)*ret)->boolval = eq;
+  if (nargs == 1 && desc->handler1 != NULL)
+    return desc->handler1(args[0], ret);
+  if (nargs == 2 && desc->handler2 != NULL)
+    return desc->handler2(args[0], args[1], ret);
 
-  return 0;
+  return desc->handler(args, nargs, ret);
 }
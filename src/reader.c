@@ -0,0 +1,317 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "inc/ast.h"
+#include "inc/gc.h"
+#include "inc/reader.h"
+#include "inc/stdmacros.h"
+#include "inc/symbols.h"
+
+// Classes of the bytes of the input, as bits: a token is a run of bytes
+// that aren't delimiters, and the class of its bytes tells what it is.
+enum {
+  CHAR_BLANK = 1,		// Skipped between tokens
+  CHAR_DELIM = 2,		// Ends a token (so do blanks)
+  CHAR_DIGIT = 4,
+  CHAR_SYMBOL = 8,		// Can start a symbol; digits can follow
+};
+
+// Same symbols as src/lexer.l
+static const uint8_t char_classes[256] = {
+  [' '] = CHAR_BLANK | CHAR_DELIM,
+  ['\t'] = CHAR_BLANK | CHAR_DELIM,
+  ['\r'] = CHAR_BLANK | CHAR_DELIM,
+  ['\n'] = CHAR_BLANK | CHAR_DELIM,
+  ['('] = CHAR_DELIM,
+  [')'] = CHAR_DELIM,
+  [';'] = CHAR_DELIM,
+  ['\''] = CHAR_DELIM,
+  ['0' ... '9'] = CHAR_DIGIT,
+  ['a' ... 'z'] = CHAR_SYMBOL,
+  ['A' ... 'Z'] = CHAR_SYMBOL,
+  ['_'] = CHAR_SYMBOL,
+  ['-'] = CHAR_SYMBOL,
+  ['?'] = CHAR_SYMBOL,
+  ['!'] = CHAR_SYMBOL,
+  ['+'] = CHAR_SYMBOL,
+  ['*'] = CHAR_SYMBOL,
+  ['/'] = CHAR_SYMBOL,
+  ['='] = CHAR_SYMBOL,
+  ['<'] = CHAR_SYMBOL,
+  ['>'] = CHAR_SYMBOL,
+};
+
+static bool has_class(char c, uint8_t classes)
+{
+  return (char_classes[(unsigned char) c] & classes) != 0;
+}
+
+// Skips blanks and comments.
+static void skip_blanks(struct reader *reader)
+{
+  while (reader->pos < reader->end)
+    {
+      if (*reader->pos == ';')
+	{
+	  while (reader->pos < reader->end && *reader->pos != '\n')
+	    reader->pos++;
+	  continue;
+	}
+      if (!has_class(*reader->pos, CHAR_BLANK))
+	return;
+      if (*reader->pos == '\n')
+	reader->line++;
+      reader->pos++;
+    }
+}
+
+// Whether the next token is the '.' of a dotted pair.
+static bool at_dot(struct reader *reader)
+{
+  return reader->pos[0] == '.' &&
+    (reader->pos + 1 == reader->end || has_class(reader->pos[1], CHAR_DELIM));
+}
+
+static int make_symbol(const char *name, size_t len, struct astnode **ret)
+{
+  struct astnode_sym *sym;
+
+  // putsym only reads the name, and only copies it if it's new.
+  RETONERR(alloc_astnode(TYPE_SYM, (struct astnode **) &sym));
+  RETONERR(putsym((char *) name, (char *) name + len - 1, &sym->symi));
+  *ret = (struct astnode *) sym;
+
+  return 0;
+}
+
+// Parses the integer made of the digits between `start` and `end`, after an
+// optional '-'.
+static int make_integer(const char *start, const char *end,
+			struct astnode **ret)
+{
+  bool negative = *start == '-';
+  int64_t val = 0;
+  const char *p;
+
+  for (p = start + negative; p < end; p++)
+    {
+      if (!has_class(*p, CHAR_DIGIT))
+	return EBADMSG;
+      val = val * 10 + (*p - '0');
+      if (val > (int64_t) INT32_MAX + negative)
+	return EOVERFLOW;
+    }
+
+  *ret = make_fixnum(negative ? -val : val);
+  return 0;
+}
+
+// Reads an integer, boolean or symbol.
+static int read_atom(struct reader *reader, struct astnode **ret)
+{
+  const char *start = reader->pos;
+  const char *p;
+  size_t len;
+
+  while (reader->pos < reader->end && !has_class(*reader->pos, CHAR_DELIM))
+    reader->pos++;
+  len = reader->pos - start;
+
+  if (has_class(start[0], CHAR_DIGIT) ||
+      (start[0] == '-' && len > 1 && has_class(start[1], CHAR_DIGIT)))
+    return make_integer(start, reader->pos, ret);
+
+  if (start[0] == '#')
+    {
+      if (len != 2 || (start[1] != 't' && start[1] != 'f'))
+	return EBADMSG;
+      *ret = make_boolean(start[1] == 't');
+      return 0;
+    }
+
+  if (!has_class(start[0], CHAR_SYMBOL))
+    return EBADMSG;
+  for (p = start + 1; p < reader->pos; p++)
+    {
+      if (!has_class(*p, CHAR_SYMBOL | CHAR_DIGIT))
+	return EBADMSG;
+    }
+
+  return make_symbol(start, len, ret);
+}
+
+static int read_datum(struct reader *reader, struct astnode **ret);
+
+// Reads the datum that follows blanks, which must be there.
+static int read_next_datum(struct reader *reader, struct astnode **ret)
+{
+  skip_blanks(reader);
+  if (reader->pos == reader->end)
+    return EBADMSG;
+
+  return read_datum(reader, ret);
+}
+
+// Reads the elements and the ')' of a list whose '(' was read. Pairs are
+// linked into `*ret` as they are made, so the list is reachable (and thus
+// safe from the GC) for as long as `*ret` is.
+static int read_list(struct reader *reader, struct astnode **ret)
+{
+  struct astnode **tail = ret;
+
+  *ret = (struct astnode *) EMPTY_LIST;
+  for (;;)
+    {
+      struct astnode_pair *pair;
+
+      skip_blanks(reader);
+      if (reader->pos == reader->end)
+	return EBADMSG;
+
+      if (*reader->pos == ')')
+	{
+	  reader->pos++;
+	  return 0;
+	}
+
+      if (at_dot(reader) && tail != ret)
+	{
+	  reader->pos++;
+	  RETONERR(read_next_datum(reader, tail));
+	  skip_blanks(reader);
+	  if (reader->pos == reader->end || *reader->pos != ')')
+	    return EBADMSG;
+	  reader->pos++;
+	  return 0;
+	}
+
+      RETONERR(alloc_astnode(TYPE_PAIR, (struct astnode **) &pair));
+      pair->cdr = (struct astnode *) EMPTY_LIST;
+      *tail = (struct astnode *) pair;
+      tail = &pair->cdr;
+      RETONERR(read_datum(reader, &pair->car));
+    }
+}
+
+// Reads the datum after a "'", as (quote <datum>).
+static int read_quote(struct reader *reader, struct astnode **ret)
+{
+  struct astnode_pair *quote;
+  struct astnode_pair *arg;
+
+  RETONERR(alloc_astnode(TYPE_PAIR, (struct astnode **) &quote));
+  *ret = (struct astnode *) quote;
+  RETONERR(alloc_astnode(TYPE_PAIR, (struct astnode **) &arg));
+  arg->cdr = (struct astnode *) EMPTY_LIST;
+  quote->cdr = (struct astnode *) arg;
+  RETONERR(make_symbol("quote", 5, &quote->car));
+
+  return read_next_datum(reader, &arg->car);
+}
+
+// Reads the datum at reader->pos, which isn't at the end nor at a blank.
+static int read_datum(struct reader *reader, struct astnode **ret)
+{
+  int err;
+
+  switch (*reader->pos)
+    {
+    case '(':
+    case '\'':
+      if (reader->depth == READER_MAX_DEPTH)
+	return ENOMEM;
+      reader->depth++;
+      err = *reader->pos++ == '(' ? read_list(reader, ret) :
+	read_quote(reader, ret);
+      reader->depth--;
+      return err;
+    case ')':
+      return EBADMSG;
+    default:
+      return read_atom(reader, ret);
+    }
+}
+
+int reader_open(struct reader *reader, const char *path)
+{
+  struct stat st;
+  void *map;
+  int fd;
+  int err;
+
+  NULL_CHECK2(reader, path);
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return errno;
+  if (fstat(fd, &st) != 0)
+    {
+      err = errno;
+      close(fd);
+      return err;
+    }
+
+  // Empty files can't be mapped
+  map = NULL;
+  if (st.st_size > 0)
+    {
+      map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED)
+	{
+	  err = errno;
+	  close(fd);
+	  return err;
+	}
+      madvise(map, st.st_size, MADV_SEQUENTIAL);
+    }
+  close(fd);
+
+  reader_init(reader, map, st.st_size);
+  reader->map = map;
+  reader->map_size = st.st_size;
+
+  return 0;
+}
+
+void reader_init(struct reader *reader, const char *buf, size_t len)
+{
+  reader->pos = buf;
+  reader->end = buf + len;
+  reader->line = 1;
+  reader->depth = 0;
+  reader->map = NULL;
+  reader->map_size = 0;
+}
+
+int reader_next(struct reader *reader, struct astnode **ret)
+{
+  // Where the datum is built: on the stack, the GC sees it.
+  struct astnode *datum;
+
+  NULL_CHECK2(reader, ret);
+
+  skip_blanks(reader);
+  if (reader->pos == reader->end)
+    {
+      *ret = NULL;
+      return 0;
+    }
+
+  reader->depth = 0;
+  RETONERR(read_datum(reader, &datum));
+  *ret = datum;
+
+  return 0;
+}
+
+void reader_close(struct reader *reader)
+{
+  if (reader->map != NULL)
+    munmap(reader->map, reader->map_size);
+  reader->map = NULL;
+}
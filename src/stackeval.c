@@ -0,0 +1,478 @@
+#include <errno.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "inc/ast.h"
+#include "inc/cont.h"
+#include "inc/env.h"
+#include "inc/eval.h"
+#include "inc/gc.h"
+#include "inc/kw_handlers.h"
+#include "inc/prmt_handlers.h"
+#include "inc/stackeval.h"
+#include "inc/stdmacros.h"
+
+#define CSTACK_INITIAL_CAP 1024
+
+// The largest frame, including the values a call frame keeps below it.
+#define MAX_FRAME_SIZE 5
+
+// Frames are made of the words listed below, pushed in that order, topped by
+// their kind as a fixnum. The control stack is a GC root array, so everything
+// a frame refers to survives collections.
+enum frame_kind {
+  FRAME_OPERATOR,		// expr env: the operator of `expr` is being
+				// evaluated
+  FRAME_ARG,			// rest env nargs: an argument of a call is being
+				// evaluated; the procedure and the `nargs`
+				// arguments before it are right below the frame
+  FRAME_IF,			// args env: the condition of an if is being
+				// evaluated
+  FRAME_DEFINE,			// sym env: the value of a define is being
+				// evaluated
+  FRAME_BODY,			// rest env: an expression of a body, followed by
+				// those of `rest`, is being evaluated
+  FRAME_CALLCC,			// cont env: the procedure given to call/cc is
+				// running; calling `cont` comes back here
+};
+
+size_t stackeval_max_bytes = STACKEVAL_DEFAULT_MAX_BYTES;
+
+static struct astnode **cstack;
+static size_t csp;		// Number of words on the stack
+static size_t cstack_cap;
+
+// Makes sure there is room for `n` more words on the stack.
+static int reserve(size_t n)
+{
+  struct astnode **new_cstack;
+  size_t max_cap;
+  size_t new_cap;
+
+  // The limit may have been lowered since the stack last grew
+  max_cap = stackeval_max_bytes / sizeof(*cstack);
+  if (csp + n > max_cap)
+    return ENOMEM;
+
+  if (csp + n <= cstack_cap)
+    return 0;
+
+  if (cstack == NULL)
+    RETONERR(gc_add_root_array(&cstack, &csp));
+
+  new_cap = cstack_cap == 0 ? CSTACK_INITIAL_CAP : cstack_cap;
+  while (new_cap < csp + n)
+    new_cap *= 2;
+  if (new_cap > max_cap)
+    new_cap = max_cap;
+
+  new_cstack = realloc(cstack, new_cap * sizeof(*cstack));
+  if (new_cstack == NULL)
+    return ENOMEM;
+  cstack = new_cstack;
+  cstack_cap = new_cap;
+
+  return 0;
+}
+
+static int push_frame2(enum frame_kind kind, struct astnode *word1,
+		       struct astnode_env *env)
+{
+  RETONERR(reserve(MAX_FRAME_SIZE));
+  cstack[csp++] = word1;
+  cstack[csp++] = (struct astnode *) env;
+  cstack[csp++] = make_fixnum(kind);
+
+  return 0;
+}
+
+// Evaluates the expression `*node` if it is not a combination, placing its
+// value in `val` and setting `*node` to NULL. A combination has its operator
+// evaluated next.
+static int step_eval(struct astnode **node, struct astnode_env *env,
+		     struct astnode **val)
+{
+  switch (astnode_type_of(*node))
+    {
+    case TYPE_SYM:
+      RETONERR(lookup_env(env, (struct astnode_sym *) *node, val));
+      break;
+    case TYPE_LEXADDR:
+      RETONERR(lookup_lexaddr(env, ((struct astnode_lexaddr *) *node)->depth,
+			      ((struct astnode_lexaddr *) *node)->index, val));
+      break;
+    case TYPE_PAIR:
+      if (!is_empty_list(*node))
+	{
+	  RETONERR(push_frame2(FRAME_OPERATOR, *node, env));
+	  *node = ((struct astnode_pair *) *node)->car;
+	  return 0;
+	}
+      *val = *node;
+      break;
+      // Keywords are not expressions
+    case TYPE_KEYWORD:
+      return EBADMSG;
+    case TYPE_MAX:
+      return EINVAL;
+      // Everything else evaluates to itself
+    case TYPE_INT:
+    case TYPE_BOOLEAN:
+    case TYPE_ENV:
+    case TYPE_PRMTPROC:
+    case TYPE_COMPPROC:
+    case TYPE_CODE:
+    case TYPE_EXEC:
+    case TYPE_CONT:
+    case TYPE_VECTOR:
+    case TYPE_NUMVECTOR:
+      *val = *node;
+      break;
+    }
+
+  *node = NULL;
+  return 0;
+}
+
+// Starts evaluating the expressions of `body` in `env`.
+static int start_body(struct astnode_pair *body, struct astnode_env *env,
+		      struct astnode **node)
+{
+  TYPE_CHECK(body, TYPE_PAIR);
+  if (is_empty_list((struct astnode *) body))
+    return EBADMSG;
+
+  if (!is_empty_list(body->cdr))
+    RETONERR(push_frame2(FRAME_BODY, body->cdr, env));
+  *node = body->car;
+
+  return 0;
+}
+
+// Control came back to `escape`, the evaluation running, through a
+// continuation: either its call/cc returns, or its saved frames replace those of
+// the evaluation.
+static int land(struct cont_escape *escape, struct astnode **node,
+		struct astnode **val)
+{
+  struct astnode_pair *frames;
+  int64_t nframes;
+
+  if (escape->reenter)
+    {
+      frames = (struct astnode_pair *) escape->thrown->frames;
+      nframes = list_length((struct astnode *) frames);
+      if (nframes < 0)
+	return EINVAL;
+
+      csp = escape->cstack_height;
+      RETONERR(reserve(nframes));
+      for ( ;
+	    !is_empty_list((struct astnode *) frames);
+	    frames = (struct astnode_pair *) frames->cdr)
+	cstack[csp++] = frames->car;
+    }
+  else
+    csp = escape->thrown->height;
+
+  *node = NULL;
+  *val = escape->val;
+
+  return 0;
+}
+
+static int call(uint32_t nargs, struct astnode **node,
+		struct astnode_env **env, struct astnode **val);
+
+// (call/cc receiver), with `receiver` on top of the stack. The receiver is
+// called with a continuation that returns to the frame pushed below it.
+static int call_cc(uint32_t nargs, struct astnode **node,
+		   struct astnode_env **env, struct astnode **val)
+{
+  struct astnode *receiver;
+  struct astnode_cont *cont;
+
+  if (nargs != 1)
+    return EBADMSG;
+  receiver = cstack[--csp];
+  csp--;
+
+  RETONERR(cont_make(cont_innermost(), csp, &cont));
+  RETONERR(push_frame2(FRAME_CALLCC, (struct astnode *) cont, *env));
+
+  // push_frame2 left room for the two words of the call
+  cstack[csp++] = receiver;
+  cstack[csp++] = (struct astnode *) cont;
+
+  return call(1, node, env, val);
+}
+
+// Calls the continuation under the argument on top of the stack. When it
+// returns to the evaluation running, the stack is cut back right here;
+// otherwise control leaves it with longjmp.
+static int throw(uint32_t nargs, struct astnode **node, struct astnode **val)
+{
+  struct astnode_cont *cont;
+  struct cont_escape *target;
+
+  if (nargs != 1)
+    return EBADMSG;
+  cont = (struct astnode_cont *) cstack[csp - 2];
+
+  RETONERR(cont_prepare_throw(cont, cstack[csp - 1], &target));
+  if (target != cont_innermost())
+    cont_jump(target);
+
+  return land(target, node, val);
+}
+
+// Calls the procedure with the `nargs` arguments on top of the stack, right
+// above the procedure itself, and pops them all. The body of a procedure left
+// to eval is started in `env` rather than run to completion, so that calls in
+// tail position don't grow the stack.
+static int call(uint32_t nargs, struct astnode **node,
+		struct astnode_env **env, struct astnode **val)
+{
+  struct astnode *proc;
+  struct astnode_compproc *compproc;
+  struct astnode_env *extended;
+  int err;
+
+  proc = cstack[csp - nargs - 1];
+  compproc = (struct astnode_compproc *) proc;
+
+  if (astnode_type_of(proc) == TYPE_PRMTPROC &&
+      ((struct astnode_prmtproc *) proc)->desc->handler == prmt_call_cc)
+    return call_cc(nargs, node, env, val);
+  if (astnode_type_of(proc) == TYPE_CONT)
+    return throw(nargs, node, val);
+
+  if (astnode_type_of(proc) == TYPE_COMPPROC && compproc->code == NULL &&
+      compproc->exec == NULL)
+    {
+      RETONERR(extend_env_array(compproc->env, compproc->params,
+				&cstack[csp - nargs], nargs, &extended));
+      csp -= nargs + 1;
+      *env = extended;
+      return start_body(compproc->body, extended, node);
+    }
+
+  err = apply_args(proc, &cstack[csp - nargs], nargs, val);
+  csp -= nargs + 1;
+
+  return err;
+}
+
+// The operator of `expr` evaluated to `op`.
+static int operator_done(struct astnode_pair *expr, struct astnode *op,
+			 struct astnode **node, struct astnode_env **env,
+			 struct astnode **val)
+{
+  struct astnode_pair *args;
+
+  TYPE_CHECK(expr->cdr, TYPE_PAIR);
+  args = (struct astnode_pair *) expr->cdr;
+
+  if (astnode_type_of(op) == TYPE_KEYWORD)
+    {
+      kw_handler handler = ((struct astnode_keyword *) op)->handler;
+
+      if (handler == kw_if)
+	{
+	  if (list_length((struct astnode *) args) != 3)
+	    return EBADMSG;
+	  RETONERR(push_frame2(FRAME_IF, (struct astnode *) args, *env));
+	  *node = args->car;
+	  return 0;
+	}
+      if (handler == kw_define && !is_empty_list((struct astnode *) args) &&
+	  astnode_type_of(args->car) == TYPE_SYM)
+	{
+	  // (define a 3). The procedure form evaluates nothing; kw_define
+	  // handles it below.
+	  TYPE_CHECK(args->cdr, TYPE_PAIR);
+	  if (is_empty_list(args->cdr))
+	    return EBADMSG;
+	  RETONERR(push_frame2(FRAME_DEFINE, args->car, *env));
+	  *node = ((struct astnode_pair *) args->cdr)->car;
+	  return 0;
+	}
+
+      return handler(args, *env, val);
+    }
+
+  RETONERR(reserve(MAX_FRAME_SIZE));
+  cstack[csp++] = op;
+
+  if (is_empty_list((struct astnode *) args))
+    return call(0, node, env, val);
+
+  cstack[csp++] = (struct astnode *) args;
+  cstack[csp++] = (struct astnode *) *env;
+  cstack[csp++] = make_fixnum(0);
+  cstack[csp++] = make_fixnum(FRAME_ARG);
+  *node = args->car;
+
+  return 0;
+}
+
+// Pops the frame on top of the stack, and hands it `val`, the value of the
+// expression it was waiting for. Either the evaluation of another expression
+// starts, in which case it is placed in `node`, or `val` is replaced with the
+// value of the frame's expression.
+static int step_return(struct astnode **node, struct astnode_env **env,
+		       struct astnode **val)
+{
+  enum frame_kind kind;
+  struct astnode *word1;
+  struct astnode_pair *args;
+  struct astnode_pair *rest;
+  uint32_t nargs;
+
+  kind = fixnum_val(cstack[--csp]);
+
+  if (kind == FRAME_ARG)
+    {
+      nargs = fixnum_val(cstack[--csp]);
+      *env = (struct astnode_env *) cstack[--csp];
+      rest = (struct astnode_pair *) ((struct astnode_pair *) cstack[--csp])->cdr;
+
+      // The frame is at least as big as the argument that replaces it
+      cstack[csp++] = *val;
+      nargs++;
+
+      if (is_empty_list((struct astnode *) rest))
+	return call(nargs, node, env, val);
+
+      TYPE_CHECK(rest, TYPE_PAIR);
+      RETONERR(reserve(MAX_FRAME_SIZE));
+      cstack[csp++] = (struct astnode *) rest;
+      cstack[csp++] = (struct astnode *) *env;
+      cstack[csp++] = make_fixnum(nargs);
+      cstack[csp++] = make_fixnum(FRAME_ARG);
+      *node = rest->car;
+      return 0;
+    }
+
+  *env = (struct astnode_env *) cstack[--csp];
+  word1 = cstack[--csp];
+
+  switch (kind)
+    {
+    case FRAME_OPERATOR:
+      return operator_done((struct astnode_pair *) word1, *val, node, env,
+			   val);
+
+    case FRAME_IF:
+      // Only #f selects the false branch
+      args = (struct astnode_pair *) ((struct astnode_pair *) word1)->cdr;
+      if (is_false(*val))
+	args = (struct astnode_pair *) args->cdr;
+      *node = args->car;
+      return 0;
+
+    case FRAME_DEFINE:
+      // Like kw_define, the value of the form is the defined value
+      return define_binding(*env, (struct astnode_sym *) word1, *val);
+
+    case FRAME_BODY:
+      return start_body((struct astnode_pair *) word1, *env, node);
+
+    case FRAME_CALLCC:
+      // The receiver returned: the call/cc returns the same value
+      cont_pop((struct astnode_cont *) word1);
+      return 0;
+
+    case FRAME_ARG:
+      break;
+    }
+
+  return EINVAL;
+}
+
+// Runs the evaluation of `escape` until its stack is back to the height it
+// started at. `node` is NULL when control came back through a continuation.
+static int run(struct cont_escape *escape, struct astnode *node,
+	       struct astnode_env *env, struct astnode **ret)
+{
+  struct astnode *val;
+  int err;
+
+  val = NULL;
+  err = node == NULL ? land(escape, &node, &val) : 0;
+
+  // Frames below the starting height belong to evaluations this one is nested
+  // in
+  while (err == 0)
+    {
+      if (node != NULL)
+	err = step_eval(&node, env, &val);
+      else if (csp == escape->cstack_height)
+	{
+	  *ret = val;
+	  return 0;
+	}
+      else
+	err = step_return(&node, &env, &val);
+    }
+
+  return err;
+}
+
+int stackeval(struct astnode *node, struct astnode_env *env,
+	      struct astnode **ret)
+{
+  struct cont_escape escape;
+  int err;
+
+  NULL_CHECK3(node, env, ret);
+
+  cont_enter(&escape, true);
+  if (setjmp(escape.buf) == 0)
+    err = run(&escape, node, env, ret);
+  else
+    err = run(&escape, NULL, NULL, ret);
+
+  // Continuations made by this evaluation end with it. On error, their frames
+  // are saved before the stack is cut back.
+  cont_deactivate(&escape);
+  if (err != 0)
+    csp = escape.cstack_height;
+  cont_leave(&escape);
+
+  return err;
+}
+
+size_t stackeval_height(void)
+{
+  return csp;
+}
+
+void stackeval_truncate(size_t height)
+{
+  csp = height;
+}
+
+int stackeval_copy_frames(size_t from, size_t to, struct astnode **ret)
+{
+  struct astnode_pair *pair;
+  struct astnode *frames;
+
+  NULL_CHECK1(ret);
+  if (from > to || to > csp)
+    return EINVAL;
+
+  for (frames = (struct astnode *) EMPTY_LIST; to > from; )
+    {
+      RETONERR(alloc_astnode(TYPE_PAIR, (struct astnode **) &pair));
+      pair->car = cstack[--to];
+      pair->cdr = frames;
+      frames = (struct astnode *) pair;
+    }
+
+  *ret = frames;
+
+  return 0;
+}
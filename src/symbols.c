@@ -4,130 +4,310 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include "inc/stdmacros.h"
 #include "inc/symbols.h"
 
 struct sym {
   char *buffer;
 };
 
-#define NTABLES_MAX 10
-#define NENTRIES ((uint32_t) (4096 / sizeof(struct sym)))
-#define TABLESZ ((uint32_t) (NENTRIES * sizeof(struct sym)))
+// Symbols are numbered densely in the order they are interned; a symbol's
+// index is its position in `syms`. The array grows as needed, so the only
+// limit on the number of symbols is memory.
+#define SYMS_INITIAL_CAP 512
 
-static struct sym *tables[NTABLES_MAX];
-static uint32_t ntables;
-static uint32_t nentries_lasttable;
+static struct sym *syms;
+static uint32_t nsyms;
+static uint32_t syms_cap;
 
-static bool is_valid_index(void *index)
+// Interned symbols are also indexed by an open addressing hash table (linear
+// probing) so that putsym doesn't have to scan every symbol. The hash of each
+// symbol is stored alongside its index in its slot, so probing only touches
+// the symbol's buffer on a full hash match.
+struct sym_slot {
+  uint32_t hash;
+  uint32_t index;		// EMPTY_SLOT if the slot is empty
+};
+
+#define EMPTY_SLOT UINT32_MAX
+#define HASHTAB_INITIAL_CAP 1024
+
+static struct sym_slot *hashtab;
+static uint32_t hashtab_cap;	// Always a power of two
+static uint32_t hashtab_count;
+
+static bool is_valid_index(uint32_t index)
+{
+  return index < nsyms;
+}
+
+// FNV-1a
+static uint32_t hash_symval(const char *symval, size_t len)
+{
+  uint32_t hash = 2166136261u;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      hash ^= (unsigned char) symval[i];
+      hash *= 16777619u;
+    }
+
+  return hash;
+}
+
+// Returns the slot holding symval, or the empty slot where it should be
+// inserted.
+static struct sym_slot *find_slot(const char *symval, size_t len, uint32_t hash)
 {
   uint32_t i;
 
-  for (i = 0; i < ntables; i++)
+  for (i = hash & (hashtab_cap - 1); ; i = (i + 1) & (hashtab_cap - 1))
     {
-      if (index >= (void *)tables[i] && index < (void *)(tables[i] + NENTRIES))
-	{
-	  // Make sure it's aligned
-	  if (((uintptr_t)index - (uintptr_t) tables[i]) % sizeof(struct sym) == 0)
-	    return true;
+      struct sym_slot *slot = &hashtab[i];
 
-	  return false;
-	}
-    }
+      if (slot->index == EMPTY_SLOT)
+	return slot;
 
-  return false;
+      if (slot->hash == hash &&
+	  strncmp(syms[slot->index].buffer, symval, len) == 0 &&
+	  syms[slot->index].buffer[len] == '\0')
+	return slot;
+    }
 }
 
-// Searches through all the symbol tables to find symval.
-// Returns NULL if none were found.
-static struct sym *find_sym(char *symval, size_t len)
+// Makes sure there is room for `n` more symbols in the hash table, keeping
+// the load factor under 1/2.
+static int reserve_slots(uint32_t n)
 {
+  struct sym_slot *old;
+  uint32_t old_cap;
   uint32_t i;
 
-  for (i = 0; i < ntables; i++)
+  if ((uint64_t) hashtab_count + n <= hashtab_cap / 2)
+    return 0;
+
+  old = hashtab;
+  old_cap = hashtab_cap;
+
+  hashtab_cap = old_cap == 0 ? HASHTAB_INITIAL_CAP : old_cap * 2;
+  while ((uint64_t) hashtab_count + n > hashtab_cap / 2)
+    hashtab_cap *= 2;
+  hashtab = malloc((size_t) hashtab_cap * sizeof(*hashtab));
+  if (hashtab == NULL)
+    {
+      hashtab = old;
+      hashtab_cap = old_cap;
+      return ENOMEM;
+    }
+
+  for (i = 0; i < hashtab_cap; i++)
+    hashtab[i].index = EMPTY_SLOT;
+
+  for (i = 0; i < old_cap; i++)
     {
       uint32_t j;
-      uint32_t nentries;
 
-      nentries = (i == ntables - 1) ? nentries_lasttable : NENTRIES;
-      for (j = 0; j < nentries; j++)
-	{
-	  // With induction variable elimination optimization, accessing
-	  // `tables` like this is just as efficient as with a pointer.
-	  if (strncmp(tables[i][j].buffer, symval, len) == 0 &&
-	      strlen(tables[i][j].buffer) == len)
-	    return &tables[i][j];
-	}
+      if (old[i].index == EMPTY_SLOT)
+	continue;
+
+      for (j = old[i].hash & (hashtab_cap - 1);
+	   hashtab[j].index != EMPTY_SLOT;
+	   j = (j + 1) & (hashtab_cap - 1))
+	;
+      hashtab[j] = old[i];
     }
 
-  return NULL;
+  free(old);
+  return 0;
 }
 
-static struct sym *next_avail_index(void)
+// Makes sure there is room for `n` more symbols in `syms`.
+static int reserve_syms(uint32_t n)
 {
-  struct sym *curtable;
+  struct sym *new_syms;
+  uint32_t new_cap;
 
-  if (ntables == 0 || nentries_lasttable == NENTRIES)
-    {
-      ntables += 1;
-      if (ntables > NTABLES_MAX)
-	return NULL;
+  if ((uint64_t) nsyms + n <= syms_cap)
+    return 0;
 
-      tables[ntables - 1] = malloc(TABLESZ);
-      if (tables[ntables - 1] == NULL)
-	return NULL;
+  // EMPTY_SLOT is not a valid index.
+  if ((uint64_t) nsyms + n > EMPTY_SLOT)
+    return ENOMEM;
 
-      nentries_lasttable = 0;
-    }
+  new_cap = syms_cap == 0 ? SYMS_INITIAL_CAP : syms_cap;
+  while (new_cap < nsyms + n)
+    new_cap = new_cap > EMPTY_SLOT / 2 ? EMPTY_SLOT : new_cap * 2;
+
+  new_syms = realloc(syms, (size_t) new_cap * sizeof(*syms));
+  if (new_syms == NULL)
+    return ENOMEM;
 
-  curtable = tables[ntables - 1];
+  syms = new_syms;
+  syms_cap = new_cap;
 
-  return curtable + nentries_lasttable++;
+  return 0;
 }
 
-int putsym(char *symval_start, char *symval_end, void **index)
+int putsym(char *symval_start, char *symval_end, uint32_t *index)
 {
-  struct sym *symindex;
+  struct sym_slot *slot;
   char *symbuffer;
   uint32_t bufsz;
+  uint32_t hash;
 
   if (symval_start == NULL || symval_end == NULL || symval_start > symval_end)
     return EINVAL;
 
-  symindex = find_sym(symval_start, symval_end - symval_start + 1);
-  if (symindex != NULL)
+  bufsz = symval_end - symval_start + 2;
+  hash = hash_symval(symval_start, bufsz - 1);
+
+  if (hashtab_count > 0)
     {
-      if (index != NULL)
-	*index = symindex;
-      return 0;
+      slot = find_slot(symval_start, bufsz - 1, hash);
+      if (slot->index != EMPTY_SLOT)
+	{
+	  if (index != NULL)
+	    *index = slot->index;
+	  return 0;
+	}
     }
 
-  bufsz = symval_end - symval_start + 2;
+  if (reserve_slots(1) != 0 || reserve_syms(1) != 0)
+    return ENOMEM;
+
   symbuffer = malloc(bufsz);
   if (symbuffer == NULL)
     return ENOMEM;
   memcpy(symbuffer, symval_start, bufsz - 1);
   symbuffer[bufsz - 1] = '\0';
 
-  symindex = next_avail_index();
-  if (symindex == NULL)
-    {
-      free(symbuffer);
-      return ENOMEM;
-    }
+  syms[nsyms].buffer = symbuffer;
+
+  // The table may have been resized by reserve_slots.
+  slot = find_slot(symval_start, bufsz - 1, hash);
+  slot->hash = hash;
+  slot->index = nsyms;
+  hashtab_count++;
 
-  symindex->buffer = symbuffer;
   if (index != NULL)
-    *index = symindex;
+    *index = nsyms;
+  nsyms++;
 
   return 0;
 }
 
-int getsym(void *index, const char **symval)
+int getsym(uint32_t index, const char **symval)
 {
   if (symval == NULL || !is_valid_index(index))
     return EINVAL;
 
-  *symval = ((struct sym *) index)->buffer;
+  *symval = syms[index].buffer;
+
+  return 0;
+}
+
+// Forgets the symbols of index `n` and above.
+static void truncate_table(uint32_t n)
+{
+  uint32_t i;
+
+  for (i = 0; i < hashtab_cap; i++)
+    {
+      if (hashtab[i].index != EMPTY_SLOT && hashtab[i].index >= n)
+	hashtab[i].index = EMPTY_SLOT;
+    }
+  hashtab_count = n;
+  nsyms = n;
+
+  // Slots after an emptied one may not be found by probing anymore: put the
+  // remaining ones back where find_slot looks for them.
+  for (i = 0; i < hashtab_cap; i++)
+    {
+      struct sym_slot moved = hashtab[i];
+      struct sym_slot *slot;
+
+      if (moved.index == EMPTY_SLOT)
+	continue;
+      hashtab[i].index = EMPTY_SLOT;
+      slot = find_slot(syms[moved.index].buffer,
+		       strlen(syms[moved.index].buffer), moved.hash);
+      *slot = moved;
+    }
+}
+
+int write_symbols(FILE *file, uint32_t *n, size_t *size)
+{
+  uint32_t i;
+
+  NULL_CHECK3(file, n, size);
+
+  *size = 0;
+  for (i = 0; i < nsyms; i++)
+    {
+      size_t len = strlen(syms[i].buffer) + 1;
+
+      if (fwrite(syms[i].buffer, 1, len, file) != len)
+	return EIO;
+      *size += len;
+    }
+
+  *n = nsyms;
+  return 0;
+}
+
+int load_symbols(char *names, size_t size, uint32_t n)
+{
+  uint32_t old_nsyms;
+  char *name;
+  char *end;
+  uint32_t i;
+
+  NULL_CHECK1(names);
+
+  // Check the names before touching the table, so that it's left as it was
+  // on errors.
+  for (i = 0, name = names; i < n; i++, name = end + 1)
+    {
+      end = memchr(name, '\0', names + size - name);
+      if (end == NULL)
+	return EINVAL;
+      if (i < nsyms && strcmp(name, syms[i].buffer) != 0)
+	return EBUSY;
+    }
+  if (name != names + size)
+    return EINVAL;
+
+  if (n <= nsyms)
+    return 0;
+  if (reserve_slots(n - nsyms) != 0 || reserve_syms(n - nsyms) != 0)
+    return ENOMEM;
+
+  for (i = 0, name = names, old_nsyms = nsyms; i < n;
+       i++, name += strlen(name) + 1)
+    {
+      struct sym_slot *slot;
+      size_t len;
+      uint32_t hash;
+
+      if (i < old_nsyms)
+	continue;
+
+      len = strlen(name);
+      hash = hash_symval(name, len);
+      slot = find_slot(name, len, hash);
+      if (slot->index != EMPTY_SLOT)
+	{
+	  truncate_table(old_nsyms);
+	  return EINVAL;
+	}
+
+      syms[nsyms].buffer = name;
+      slot->hash = hash;
+      slot->index = nsyms;
+      hashtab_count++;
+      nsyms++;
+    }
 
   return 0;
 }
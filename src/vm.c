@@ -0,0 +1,221 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "inc/ast.h"
+#include "inc/env.h"
+#include "inc/eval.h"
+#include "inc/gc.h"
+#include "inc/stdmacros.h"
+#include "inc/vm.h"
+
+// The value stack. A call pushes the caller's code, frame and program counter
+// (as a fixnum) under the callee's values, so the GC sees all of them through
+// the stack, which is registered as a root array.
+#define STACK_INITIAL_CAP 1024
+
+// Values pushed by OP_CALL to be able to return to the caller.
+#define CALL_INFO_SIZE 3
+
+static struct astnode **stack;
+static size_t sp;		// Number of values on the stack
+static size_t stack_cap;
+
+// Makes sure there is room for `n` more values on the stack. Pointers in the
+// stack are invalidated.
+static int reserve_stack(size_t n)
+{
+  struct astnode **new_stack;
+  size_t new_cap;
+
+  if (sp + n <= stack_cap)
+    return 0;
+
+  if (stack == NULL)
+    RETONERR(gc_add_root_array(&stack, &sp));
+
+  new_cap = stack_cap == 0 ? STACK_INITIAL_CAP : stack_cap;
+  while (new_cap < sp + n)
+    new_cap *= 2;
+
+  new_stack = realloc(stack, new_cap * sizeof(*stack));
+  if (new_stack == NULL)
+    return ENOMEM;
+  stack = new_stack;
+  stack_cap = new_cap;
+
+  return 0;
+}
+
+// Runs `code` in `env` until it returns from its outermost call.
+static int run(struct astnode_code *code, struct astnode_env *env,
+	       struct astnode **ret)
+{
+  struct astnode_compproc *proc;
+  struct astnode_env *frame;
+  struct astnode *callee;
+  struct astnode *val;
+  uint32_t *insns;
+  uint32_t pc;
+  uint32_t ncalls;		// Calls made by OP_CALL not returned from yet
+  uint32_t n;
+  uint32_t op;
+
+  RETONERR(reserve_stack(code->max_stack));
+  insns = code_insns(code);
+  pc = 0;
+  ncalls = 0;
+
+  for (;;)
+    {
+      assert(pc < code->ninsns);
+      op = insns[pc++];
+      switch (op)
+	{
+	case OP_CONST:
+	  stack[sp++] = code->consts[insns[pc++]];
+	  break;
+
+	case OP_LOCAL:
+	  frame = env;
+	  for (n = insns[pc++]; n > 0; n--)
+	    frame = frame->parent;
+	  assert(insns[pc] < frame->nslots);
+	  stack[sp++] = frame->slots[insns[pc++]];
+	  break;
+
+	case OP_GLOBAL:
+	  RETONERR(lookup_global(env,
+				 (struct astnode_sym *) code->consts[insns[pc++]],
+				 &stack[sp]));
+	  sp++;
+	  break;
+
+	case OP_LOOKUP:
+	  RETONERR(lookup_env(env,
+			      (struct astnode_sym *) code->consts[insns[pc++]],
+			      &stack[sp]));
+	  sp++;
+	  break;
+
+	case OP_DEFINE:
+	  RETONERR(define_binding(env,
+				  (struct astnode_sym *) code->consts[insns[pc++]],
+				  stack[sp - 1]));
+	  break;
+
+	case OP_POP:
+	  sp--;
+	  break;
+
+	case OP_JUMP:
+	  pc = insns[pc];
+	  break;
+
+	case OP_JUMP_IF_FALSE:
+	  if (is_false(stack[--sp]))
+	    pc = insns[pc];
+	  else
+	    pc++;
+	  break;
+
+	case OP_CLOSURE:
+	  RETONERR(alloc_astnode(TYPE_COMPPROC, (struct astnode **) &proc));
+	  *proc = *(struct astnode_compproc *) code->consts[insns[pc++]];
+	  proc->env = env;
+	  stack[sp++] = (struct astnode *) proc;
+	  break;
+
+	case OP_CALL:
+	case OP_TAIL_CALL:
+	  n = insns[pc++];
+	  callee = stack[sp - n - 1];
+
+	  if (astnode_type_of(callee) != TYPE_COMPPROC ||
+	      ((struct astnode_compproc *) callee)->code == NULL)
+	    {
+	      // Primitives and procedures left to eval get their arguments
+	      // straight from the stack. A tail call to one of those is
+	      // followed by OP_RETURN like any other expression.
+	      RETONERR(apply_args(callee, &stack[sp - n], n, &val));
+	      sp -= n + 1;
+	      stack[sp++] = val;
+	      break;
+	    }
+
+	  proc = (struct astnode_compproc *) callee;
+	  RETONERR(reserve_stack(proc->code->max_stack + CALL_INFO_SIZE));
+	  RETONERR(extend_env_array(proc->env, proc->params, &stack[sp - n], n,
+				    &frame));
+	  sp -= n + 1;
+
+	  if (op == OP_CALL)
+	    {
+	      stack[sp++] = (struct astnode *) code;
+	      stack[sp++] = (struct astnode *) env;
+	      stack[sp++] = make_fixnum(pc);
+	      ncalls++;
+	    }
+
+	  code = proc->code;
+	  insns = code_insns(code);
+	  env = frame;
+	  pc = 0;
+	  break;
+
+	case OP_RETURN:
+	  val = stack[--sp];
+	  if (ncalls == 0)
+	    {
+	      *ret = val;
+	      return 0;
+	    }
+
+	  pc = fixnum_val(stack[--sp]);
+	  env = (struct astnode_env *) stack[--sp];
+	  code = (struct astnode_code *) stack[--sp];
+	  insns = code_insns(code);
+	  ncalls--;
+	  stack[sp++] = val;
+	  break;
+
+	default:
+	  assert(false);
+	  return EINVAL;
+	}
+    }
+}
+
+int vm_apply(struct astnode_compproc *proc, struct astnode **args,
+	     uint32_t nargs, struct astnode **ret)
+{
+  struct astnode_env *env;
+  size_t base;
+  int err;
+
+  NULL_CHECK2(proc, ret);
+  if (proc->code == NULL || (args == NULL && nargs > 0))
+    return EINVAL;
+
+  RETONERR(extend_env_array(proc->env, proc->params, args, nargs, &env));
+
+  // On error, drop whatever the body left on the stack.
+  base = sp;
+  err = run(proc->code, env, ret);
+  if (err != 0)
+    sp = base;
+
+  return err;
+}
+
+size_t vm_stack_height(void)
+{
+  return sp;
+}
+
+void vm_stack_truncate(size_t height)
+{
+  sp = height;
+}
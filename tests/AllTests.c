@@ -7,6 +7,17 @@ CuSuite* EnvGetSuite();
 CuSuite* PrmtGetSuite();
 CuSuite* EvalGetSuite();
 CuSuite* KwGetSuite();
+CuSuite* GcGetSuite();
+CuSuite* LexaddrGetSuite();
+CuSuite* VmGetSuite();
+CuSuite* AnalyzeGetSuite();
+CuSuite* ArgstackGetSuite();
+CuSuite* StackevalGetSuite();
+CuSuite* ContGetSuite();
+CuSuite* NumvecGetSuite();
+CuSuite* ImageGetSuite();
+CuSuite* ReaderGetSuite();
+CuSuite* ParserGetSuite();
 
 
 // Note: CuSuite runs all the tests in the same process (i.e. changes made in
@@ -21,6 +32,17 @@ void RunAllTests(void)
 	CuSuiteAddSuite(suite, PrmtGetSuite());
 	CuSuiteAddSuite(suite, EvalGetSuite());
 	CuSuiteAddSuite(suite, KwGetSuite());
+	CuSuiteAddSuite(suite, GcGetSuite());
+	CuSuiteAddSuite(suite, LexaddrGetSuite());
+	CuSuiteAddSuite(suite, VmGetSuite());
+	CuSuiteAddSuite(suite, AnalyzeGetSuite());
+	CuSuiteAddSuite(suite, ArgstackGetSuite());
+	CuSuiteAddSuite(suite, StackevalGetSuite());
+	CuSuiteAddSuite(suite, ContGetSuite());
+	CuSuiteAddSuite(suite, NumvecGetSuite());
+	CuSuiteAddSuite(suite, ImageGetSuite());
+	CuSuiteAddSuite(suite, ReaderGetSuite());
+	CuSuiteAddSuite(suite, ParserGetSuite());
 
 	CuSuiteRun(suite);
 	CuSuiteSummary(suite, output);
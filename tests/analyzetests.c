@@ -0,0 +1,89 @@
+#include <errno.h>
+#include <stddef.h>
+
+#include "tests/CuTest.h"
+#include "inc/analyze.h"
+#include "inc/ast.h"
+#include "inc/eval.h"
+#include "tests/testhelpers.h"
+
+void TestAnalyze_NullArgs(CuTest *tc) {
+  int err;
+  struct astnode_compproc proc = {
+    .type = TYPE_COMPPROC,
+    .exec = NULL
+  };
+  struct astnode *ret;
+
+  err = analyze_proc(NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = exec_apply(NULL, NULL, 0, NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  // Procedures that were not analyzed can't be run as such
+  err = exec_apply(&proc, NULL, 0, &ret);
+  CuAssertIntEquals(tc, EINVAL, err);
+}
+
+void TestAnalyze_AnalyzesTopLevelProcs(CuTest *tc) {
+  int err;
+  struct astnode *ret;
+  struct astnode_compproc *proc;
+
+  err = eval_str_in_mode(tc, EVAL_MODE_ANALYZE,
+			 "(define (make-adder a) (lambda (b) (+ a b)))"
+			 "(make-adder 1)",
+			 &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_COMPPROC, astnode_type_of(ret));
+
+  // Nested lambdas are analyzed along with the procedure they are in
+  proc = (struct astnode_compproc *) ret;
+  CuAssertTrue(tc, proc->exec != NULL);
+  CuAssertPtrEquals(tc, NULL, proc->code);
+
+  // Malformed bodies are left to eval
+  err = eval_str_in_mode(tc, EVAL_MODE_ANALYZE, "(define (f x) (if x))", &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, NULL, ((struct astnode_compproc *) ret)->exec);
+}
+
+void TestAnalyze_TailCallsInConstantStack(CuTest *tc) {
+  int err;
+  struct astnode *ret;
+
+  err = eval_str_in_mode(tc, EVAL_MODE_ANALYZE,
+			 "(define (even? n) (if (= n 0) #t (odd? (- n 1))))"
+			 "(define (odd? n) (if (= n 0) #f (even? (- n 1))))"
+			 "(even? 100000)",
+			 &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_BOOLEAN, astnode_type_of(ret));
+  CuAssertTrue(tc, ((struct astnode_boolean *) ret)->boolval);
+}
+
+void TestAnalyze_Sequence(CuTest *tc) {
+  int err;
+  struct astnode *ret;
+
+  // Every expression of the body runs, and the last one gives the value
+  err = eval_str_in_mode(tc, EVAL_MODE_ANALYZE,
+			 "(define x 1)"
+			 "(define (f) (define x 2) (define y (+ x 1)) (* x y))"
+			 "(+ (f) x)",
+			 &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 7, fixnum_val(ret));
+}
+
+CuSuite* AnalyzeGetSuite() {
+  CuSuite* suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, TestAnalyze_NullArgs);
+  SUITE_ADD_TEST(suite, TestAnalyze_AnalyzesTopLevelProcs);
+  SUITE_ADD_TEST(suite, TestAnalyze_TailCallsInConstantStack);
+  SUITE_ADD_TEST(suite, TestAnalyze_Sequence);
+
+  return suite;
+}
@@ -0,0 +1,64 @@
+#include <stddef.h>
+
+#include "tests/CuTest.h"
+#include "inc/argstack.h"
+#include "inc/ast.h"
+#include "inc/gc.h"
+
+void TestArgstack_PushTruncate(CuTest *tc) {
+  const size_t NVALUES = 1000;	// Enough to grow the stack
+  int err;
+  size_t base;
+  size_t i;
+  struct astnode **values;
+
+  base = argstack_size();
+  for (i = 0; i < NVALUES; i++)
+    {
+      err = argstack_push(make_fixnum(i));
+      CuAssertIntEquals(tc, 0, err);
+    }
+  CuAssertIntEquals(tc, base + NVALUES, argstack_size());
+
+  values = argstack_from(base);
+  for (i = 0; i < NVALUES; i++)
+    CuAssertIntEquals(tc, i, fixnum_val(values[i]));
+
+  argstack_truncate(base);
+  CuAssertIntEquals(tc, base, argstack_size());
+}
+
+void TestArgstack_IsRoot(CuTest *tc) {
+  int err;
+  size_t base;
+  struct astnode_pair *pair;
+  struct astnode_pair **values;
+
+  err = alloc_astnode(TYPE_PAIR, (struct astnode **) &pair);
+  CuAssertIntEquals(tc, 0, err);
+  pair->car = make_fixnum(42);
+  pair->cdr = make_fixnum(43);
+
+  base = argstack_size();
+  err = argstack_push((struct astnode *) pair);
+  CuAssertIntEquals(tc, 0, err);
+  pair = NULL;
+
+  err = gc_collect();
+  CuAssertIntEquals(tc, 0, err);
+
+  values = (struct astnode_pair **) argstack_from(base);
+  CuAssertIntEquals(tc, 42, fixnum_val(values[0]->car));
+  CuAssertIntEquals(tc, 43, fixnum_val(values[0]->cdr));
+
+  argstack_truncate(base);
+}
+
+CuSuite* ArgstackGetSuite() {
+  CuSuite* suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, TestArgstack_PushTruncate);
+  SUITE_ADD_TEST(suite, TestArgstack_IsRoot);
+
+  return suite;
+}
@@ -0,0 +1,166 @@
+#include <errno.h>
+#include <stddef.h>
+
+#include "tests/CuTest.h"
+#include "inc/argstack.h"
+#include "inc/ast.h"
+#include "inc/cont.h"
+#include "inc/env.h"
+#include "inc/eval.h"
+#include "inc/vm.h"
+#include "tests/testhelpers.h"
+
+void TestCont_NullArgs(CuTest *tc) {
+  int err;
+  struct astnode_cont cont = {
+    .type = TYPE_CONT,
+    .state = CONT_DEAD
+  };
+  struct cont_escape *target;
+
+  err = cont_prepare_throw(NULL, make_fixnum(1), &target);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = cont_prepare_throw(&cont, NULL, &target);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = cont_prepare_throw(&cont, make_fixnum(1), NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = cont_throw(&cont, make_fixnum(1));
+  CuAssertIntEquals(tc, ENOTSUP, err);
+}
+
+void TestCont_Returns(CuTest *tc) {
+  int err;
+  size_t i;
+  struct astnode *ret;
+
+  for (i = 0; i < ntest_modes; i++)
+    {
+      // The receiver returns normally
+      err = eval_str_in_mode(tc, test_modes[i],
+			     "(+ 1 (call/cc (lambda (k) 2)))", &ret);
+      CuAssertIntEquals(tc, 0, err);
+      CuAssertIntEquals(tc, 3, fixnum_val(ret));
+
+      // The continuation is called: the rest of the receiver is skipped
+      err = eval_str_in_mode(tc, test_modes[i],
+			     "(define (f k) (k 10) 20)"
+			     "(+ 1 (call-with-current-continuation f))",
+			     &ret);
+      CuAssertIntEquals(tc, 0, err);
+      CuAssertIntEquals(tc, 11, fixnum_val(ret));
+    }
+}
+
+void TestCont_EscapesFromDeepRecursion(CuTest *tc) {
+  int err;
+  size_t i;
+  size_t argstack_height;
+  size_t vm_height;
+  struct astnode *ret;
+
+  argstack_height = argstack_size();
+  vm_height = vm_stack_height();
+
+  for (i = 0; i < ntest_modes; i++)
+    {
+      err = eval_str_in_mode(tc, test_modes[i],
+			     "(define (walk n k)"
+			     "  (if (= n 0) (k 42) (+ 1 (walk (- n 1) k))))"
+			     "(+ 1 (call/cc (lambda (k) (walk 1000 k))))",
+			     &ret);
+      CuAssertIntEquals(tc, 0, err);
+      CuAssertIntEquals(tc, 43, fixnum_val(ret));
+
+      // The stacks were cut back along with the frames
+      CuAssertIntEquals(tc, argstack_height, argstack_size());
+      CuAssertIntEquals(tc, vm_height, vm_stack_height());
+    }
+
+  // Deeper than the C stack allows
+  err = eval_str_in_mode(tc, EVAL_MODE_STACK,
+			 "(define (walk n k)"
+			 "  (if (= n 0) (k 42) (+ 1 (walk (- n 1) k))))"
+			 "(call/cc (lambda (k) (walk 200000 k)))",
+			 &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 42, fixnum_val(ret));
+}
+
+void TestCont_NestedEscapes(CuTest *tc) {
+  int err;
+  size_t i;
+  struct astnode *ret;
+
+  // Escaping to the outer continuation skips the inner call/cc's return
+  for (i = 0; i < ntest_modes; i++)
+    {
+      err = eval_str_in_mode(tc, test_modes[i],
+			     "(call/cc (lambda (outer)"
+			     "  (+ 100 (call/cc (lambda (inner) (outer 1))))))",
+			     &ret);
+      CuAssertIntEquals(tc, 0, err);
+      CuAssertIntEquals(tc, 1, fixnum_val(ret));
+
+      // The receiver fails: later continuations still work
+      err = eval_str_in_mode(tc, test_modes[i],
+			     "(call/cc (lambda (k) (car 1)))", &ret);
+      CuAssertIntEquals(tc, EBADMSG, err);
+      err = eval_str_in_mode(tc, test_modes[i],
+			     "(call/cc (lambda (k) (k 5)))", &ret);
+      CuAssertIntEquals(tc, 0, err);
+      CuAssertIntEquals(tc, 5, fixnum_val(ret));
+    }
+}
+
+void TestCont_Reentry(CuTest *tc) {
+  int err;
+  enum eval_mode saved_mode;
+  struct astnode_env *env;
+  struct astnode *ret;
+  const char *reenter =
+    "(define (f)"
+    "  (define k (call/cc (lambda (c) c)))"
+    "  (if (pair? k) (car k) (k (cons 7 8))))"
+    "(f)";
+
+  err = eval_str_in_mode(tc, EVAL_MODE_STACK, reenter, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 7, fixnum_val(ret));
+
+  // Elsewhere, the rest of the computation was on the C stack, and is gone
+  err = eval_str_in_mode(tc, EVAL_MODE_AST, reenter, &ret);
+  CuAssertIntEquals(tc, ENOTSUP, err);
+
+  // Continuations end with the form being evaluated
+  err = make_top_level_env(&env);
+  CuAssertIntEquals(tc, 0, err);
+  saved_mode = eval_mode;
+  eval_mode = EVAL_MODE_STACK;
+
+  err = eval_str(tc, "(define k (call/cc (lambda (c) c)))", env, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_CONT, astnode_type_of(ret));
+  err = eval_str(tc, "(+ 1 (k 5))", env, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 5, fixnum_val(ret));
+  err = eval_str(tc, "k", env, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 5, fixnum_val(ret));
+
+  eval_mode = saved_mode;
+}
+
+CuSuite* ContGetSuite() {
+  CuSuite* suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, TestCont_NullArgs);
+  SUITE_ADD_TEST(suite, TestCont_Returns);
+  SUITE_ADD_TEST(suite, TestCont_EscapesFromDeepRecursion);
+  SUITE_ADD_TEST(suite, TestCont_NestedEscapes);
+  SUITE_ADD_TEST(suite, TestCont_Reentry);
+
+  return suite;
+}
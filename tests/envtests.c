@@ -1,10 +1,12 @@
 #include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "tests/CuTest.h"
 #include "inc/ast.h"
 #include "inc/env.h"
+#include "inc/gc.h"
 #include "inc/symbols.h"
 
 struct astnode_env *top_level_env;
@@ -111,7 +113,7 @@ void TestExtendEnv_LookupParam(CuTest *tc) {
   struct astnode_env *extended_env;
   struct astnode_pair formal_params;
   struct astnode_pair args;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
   param_sym = "param-symbol";
   sym_node.type = TYPE_SYM;
@@ -127,9 +129,7 @@ void TestExtendEnv_LookupParam(CuTest *tc) {
 
   // Prepare argument list
   args.type = TYPE_PAIR;
-  args.car = malloc(sizeof(struct astnode_int));
-  args.car->type = TYPE_INT;
-  ((struct astnode_int *)args.car)->intval = BINDING_VAL;
+  args.car = make_fixnum(BINDING_VAL);
   args.cdr = (struct astnode *) EMPTY_LIST;
 
   // Extend env
@@ -138,8 +138,8 @@ void TestExtendEnv_LookupParam(CuTest *tc) {
 
   err = lookup_env(extended_env, &sym_node, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, BINDING_VAL, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, BINDING_VAL, fixnum_val(ret));
 }
 
 void TestExtendEnv_DefineLocalBinding(CuTest *tc) {
@@ -150,8 +150,8 @@ void TestExtendEnv_DefineLocalBinding(CuTest *tc) {
   struct astnode_env *extended_env;
   struct astnode_pair *formal_params;
   struct astnode_pair *args;
-  struct astnode_int local_binding_val;
-  struct astnode_int *ret;
+  struct astnode *local_binding_val = make_fixnum(BINDING_VAL);
+  struct astnode *ret;
 
   // Prepare formal parameters list
   formal_params = EMPTY_LIST;
@@ -169,23 +169,116 @@ void TestExtendEnv_DefineLocalBinding(CuTest *tc) {
   err = putsym(param_sym, param_sym + strlen(param_sym) - 1, &sym_node.symi);
   CuAssertIntEquals(tc, 0, err);
 
-  local_binding_val.type = TYPE_INT;
-  local_binding_val.intval = BINDING_VAL;
-  err = define_binding(extended_env, &sym_node,
-		       (struct astnode *) &local_binding_val);
+  err = define_binding(extended_env, &sym_node, local_binding_val);
   CuAssertIntEquals(tc, 0, err);
 
   // Ensure that the symbol was bound in extended env
   err = lookup_env(extended_env, &sym_node, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, BINDING_VAL, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, BINDING_VAL, fixnum_val(ret));
 
   // Ensure that the symbol was NOT bound in top level env
   err = lookup_env(top_level_env, &sym_node, (struct astnode **) &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
+void TestExtendEnv_SlotsInOneAlloc(CuTest *tc) {
+  // Binds (a b c) to (1 2 3)
+  const int NPARAMS = 3;
+  char *names[] = { "slot-a", "slot-b", "slot-c" };
+  int err;
+  int i;
+  struct astnode_sym syms[NPARAMS];
+  struct astnode_pair params[NPARAMS];
+  struct astnode_pair args[NPARAMS];
+  struct astnode_env *extended_env;
+  struct astnode *ret;
+  struct gc_stats before;
+  struct gc_stats after;
+
+  for (i = 0; i < NPARAMS; i++)
+    {
+      syms[i].type = TYPE_SYM;
+      err = putsym(names[i], names[i] + strlen(names[i]) - 1, &syms[i].symi);
+      CuAssertIntEquals(tc, 0, err);
+
+      params[i].type = TYPE_PAIR;
+      params[i].car = (struct astnode *) &syms[i];
+      params[i].cdr = i + 1 < NPARAMS ?
+	(struct astnode *) &params[i + 1] : (struct astnode *) EMPTY_LIST;
+
+      args[i].type = TYPE_PAIR;
+      args[i].car = make_fixnum(i + 1);
+      args[i].cdr = i + 1 < NPARAMS ?
+	(struct astnode *) &args[i + 1] : (struct astnode *) EMPTY_LIST;
+    }
+
+  gc_get_stats(&before);
+  err = extend_env(top_level_env, params, args, &extended_env);
+  CuAssertIntEquals(tc, 0, err);
+  gc_get_stats(&after);
+  CuAssertIntEquals(tc, 1, after.nallocs - before.nallocs);
+
+  CuAssertIntEquals(tc, NPARAMS, extended_env->nslots);
+  for (i = 0; i < NPARAMS; i++)
+    {
+      err = lookup_env(extended_env, &syms[i], &ret);
+      CuAssertIntEquals(tc, 0, err);
+      CuAssertIntEquals(tc, i + 1, fixnum_val(ret));
+
+      err = lookup_lexaddr(extended_env, 0, i, &ret);
+      CuAssertIntEquals(tc, 0, err);
+      CuAssertIntEquals(tc, i + 1, fixnum_val(ret));
+    }
+
+  // Defining a parameter updates its slot
+  err = define_binding(extended_env, &syms[1], make_fixnum(42));
+  CuAssertIntEquals(tc, 0, err);
+  err = lookup_lexaddr(extended_env, 0, 1, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 42, fixnum_val(ret));
+}
+
+void TestDefineBinding_ManyGlobals(CuTest *tc) {
+  const int NGLOBALS = 5000;
+  int err;
+  int i;
+  char name[32];
+  struct astnode_env *other_env;
+  struct astnode_sym sym_node;
+  struct astnode *ret;
+
+  err = make_top_level_env(&other_env);
+  CuAssertIntEquals(tc, 0, err);
+
+  sym_node.type = TYPE_SYM;
+  for (i = 0; i < NGLOBALS; i++)
+    {
+      snprintf(name, sizeof(name), "many-globals-%d", i);
+      err = putsym(name, name + strlen(name) - 1, &sym_node.symi);
+      CuAssertIntEquals(tc, 0, err);
+
+      err = define_binding(top_level_env, &sym_node, make_fixnum(i));
+      CuAssertIntEquals(tc, 0, err);
+    }
+
+  for (i = 0; i < NGLOBALS; i++)
+    {
+      snprintf(name, sizeof(name), "many-globals-%d", i);
+      err = putsym(name, name + strlen(name) - 1, &sym_node.symi);
+      CuAssertIntEquals(tc, 0, err);
+
+      err = lookup_env(top_level_env, &sym_node, &ret);
+      CuAssertIntEquals(tc, 0, err);
+      CuAssertIntEquals(tc, i, fixnum_val(ret));
+
+      // Each top-level environment has its own bindings
+      err = lookup_env(other_env, &sym_node, &ret);
+      CuAssertIntEquals(tc, EBADMSG, err);
+    }
+}
+
 CuSuite* EnvGetSuite() {
   CuSuite* suite = CuSuiteNew();
 
@@ -198,6 +291,8 @@ CuSuite* EnvGetSuite() {
   SUITE_ADD_TEST(suite, TestDefineBinding_Twice);
   SUITE_ADD_TEST(suite, TestExtendEnv_LookupParam);
   SUITE_ADD_TEST(suite, TestExtendEnv_DefineLocalBinding);
+  SUITE_ADD_TEST(suite, TestExtendEnv_SlotsInOneAlloc);
+  SUITE_ADD_TEST(suite, TestDefineBinding_ManyGlobals);
 
   return suite;
 }
@@ -5,8 +5,10 @@
 #include "tests/CuTest.h"
 #include "inc/ast.h"
 #include "inc/eval.h"
+#include "inc/gc.h"
 #include "inc/prmt_handlers.h"
 #include "inc/symbols.h"
+#include "tests/testhelpers.h"
 
 static struct astnode_env *env;
 
@@ -42,23 +44,20 @@ void TestEval_Sym(CuTest *tc) {
   err = eval((struct astnode *) &sym_node, env, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_PRMTPROC, ret->type);
-  CuAssertPtrEquals(tc, prmt_cons, ret->handler);
+  CuAssertPtrEquals(tc, prmt_cons, ret->desc->handler);
 }
 
 
 void TestEval_Int(CuTest *tc) {
   const int NUMVAL = 3;
   int err;
-  struct astnode_int num;
-  struct astnode_int *ret;
-
-  num.type = TYPE_INT;
-  num.intval = NUMVAL;
+  struct astnode *num = make_fixnum(NUMVAL);
+  struct astnode *ret;
 
-  err = eval((struct astnode *) &num, env, (struct astnode **) &ret);
+  err = eval(num, env, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, NUMVAL, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, NUMVAL, fixnum_val(ret));
 }
 
 void TestEval_Boolean(CuTest *tc) {
@@ -80,18 +79,18 @@ void TestEval_PairPrmt(CuTest *tc) {
   int err;
   char *sym;
   struct astnode_sym sym_cons;
-  struct astnode_int num1;
-  struct astnode_int num2;
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair *ret;
 
   struct astnode_pair third_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num2,
+    .car = num2,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &third_pair
   };
   struct astnode_pair first_pair = {
@@ -105,19 +104,13 @@ void TestEval_PairPrmt(CuTest *tc) {
   err = putsym(sym, sym + strlen(sym) - 1, &sym_cons.symi);
   CuAssertIntEquals(tc, 0, err);
 
-  num1.type = TYPE_INT;
-  num1.intval = VAL1;
-
-  num2.type = TYPE_INT;
-  num2.intval = VAL2;
-
   err = eval((struct astnode *) &first_pair, env, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_PAIR, ret->type);
-  CuAssertIntEquals(tc, TYPE_INT, ret->car->type);
-  CuAssertIntEquals(tc, VAL1, ((struct astnode_int *) ret->car)->intval);
-  CuAssertIntEquals(tc, TYPE_INT, ret->cdr->type);
-  CuAssertIntEquals(tc, VAL2, ((struct astnode_int *) ret->cdr)->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret->car));
+  CuAssertIntEquals(tc, VAL1, fixnum_val(ret->car));
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret->cdr));
+  CuAssertIntEquals(tc, VAL2, fixnum_val(ret->cdr));
 }
 
 void TestEval_PairCompproc(CuTest *tc) {
@@ -207,12 +200,12 @@ void TestEval_Prmtproc(CuTest *tc) {
   struct astnode_prmtproc *ret;
 
   proc.type = TYPE_PRMTPROC;
-  proc.handler = prmt_cons;
+  proc.desc = &prmt_descs[0];
 
   err = eval((struct astnode *) &proc, env, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_PRMTPROC, ret->type);
-  CuAssertPtrEquals(tc, prmt_cons, ret->handler);
+  CuAssertPtrEquals(tc, (void *) &prmt_descs[0], (void *) ret->desc);
 }
 
 void TestEval_Compproc(CuTest *tc) {
@@ -240,30 +233,95 @@ void TestEvalMany_ValidObj(CuTest *tc) {
   const int VAL1 = 55;
   const int VAL2 = 66;
   int err;
-  struct astnode_int num2 = {
-    .type = TYPE_INT,
-    .intval = VAL2
-  };
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num2 = make_fixnum(VAL2);
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num2,
+    .car = num2,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
-  struct astnode_int *ret;
+  struct astnode *ret;
 
   err = eval_many(&first_pair, env, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, VAL2, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, VAL2, fixnum_val(ret));
+}
+
+void TestEval_TailCallsInConstantStack(CuTest *tc) {
+  // (define (count-down n) (if (= n 0) (quote done) (count-down (- n 1))))
+  // (count-down 100000)
+  const int NITERS = 100000;
+  int err;
+  struct astnode *define;
+  struct astnode *call;
+  struct astnode *ret;
+  const char *symval;
+
+  define = make_list(tc, 3, make_sym(tc, "define"),
+		     make_list(tc, 2, make_sym(tc, "count-down"),
+			       make_sym(tc, "n")),
+		     make_list(tc, 4, make_sym(tc, "if"),
+			       make_list(tc, 3, make_sym(tc, "="),
+					 make_sym(tc, "n"), make_fixnum(0)),
+			       make_list(tc, 2, make_sym(tc, "quote"),
+					 make_sym(tc, "done")),
+			       make_list(tc, 2, make_sym(tc, "count-down"),
+					 make_list(tc, 3, make_sym(tc, "-"),
+						   make_sym(tc, "n"),
+						   make_fixnum(1)))));
+  call = make_list(tc, 2, make_sym(tc, "count-down"), make_fixnum(NITERS));
+
+  err = eval(define, env, &ret);
+  CuAssertIntEquals(tc, 0, err);
+
+  err = eval(call, env, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_SYM, astnode_type_of(ret));
+  err = getsym(((struct astnode_sym *) ret)->symi, &symval);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertStrEquals(tc, "done", symval);
+}
+
+void TestEval_CallsDontAllocateArgLists(CuTest *tc) {
+  int err;
+  struct astnode *define;
+  struct astnode *call;
+  struct astnode *ret;
+  struct gc_stats before;
+  struct gc_stats after;
+
+  // A call to a primitive that returns a fixnum doesn't allocate at all
+  call = make_list(tc, 4, make_sym(tc, "+"), make_fixnum(1), make_fixnum(2),
+		   make_fixnum(3));
+  gc_get_stats(&before);
+  err = eval(call, env, &ret);
+  gc_get_stats(&after);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 6, fixnum_val(ret));
+  CuAssertIntEquals(tc, before.nallocs, after.nallocs);
+
+  // A call to a compound procedure only allocates its frame
+  define = make_list(tc, 3, make_sym(tc, "define"),
+		     make_list(tc, 3, make_sym(tc, "first"), make_sym(tc, "a"),
+			       make_sym(tc, "b")),
+		     make_sym(tc, "a"));
+  err = eval(define, env, &ret);
+  CuAssertIntEquals(tc, 0, err);
+
+  call = make_list(tc, 3, make_sym(tc, "first"), make_fixnum(1),
+		   make_fixnum(2));
+  gc_get_stats(&before);
+  err = eval(call, env, &ret);
+  gc_get_stats(&after);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 1, fixnum_val(ret));
+  CuAssertIntEquals(tc, before.nallocs + 1, after.nallocs);
 }
 
 void TestApply_NullArg(CuTest *tc) {
@@ -271,6 +329,35 @@ void TestApply_NullArg(CuTest *tc) {
 
   err = apply(NULL, NULL, NULL);
   CuAssertIntEquals(tc, EINVAL, err);
+
+  err = apply_args(NULL, NULL, 0, NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+}
+
+void TestApply_ArgsArray(CuTest *tc) {
+  int err;
+  struct astnode *proc;
+  struct astnode *args[2] = { make_fixnum(1), make_fixnum(2) };
+  struct astnode_pair *ret;
+
+  err = lookup_env(env, (struct astnode_sym *) make_sym(tc, "cons"), &proc);
+  CuAssertIntEquals(tc, 0, err);
+
+  err = apply_args(proc, NULL, 1, (struct astnode **) &ret);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = apply_args(proc, args, 2, (struct astnode **) &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_PAIR, astnode_type_of((struct astnode *) ret));
+  CuAssertIntEquals(tc, 1, fixnum_val(ret->car));
+  CuAssertIntEquals(tc, 2, fixnum_val(ret->cdr));
+
+  // Same through the list entry point
+  err = apply(proc, (struct astnode_pair *) make_list(tc, 2, make_fixnum(1),
+						       make_fixnum(2)),
+	      (struct astnode **) &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 2, fixnum_val(ret->cdr));
 }
 
 CuSuite* EvalGetSuite() {
@@ -289,7 +376,10 @@ CuSuite* EvalGetSuite() {
   SUITE_ADD_TEST(suite, TestEval_Compproc);
   SUITE_ADD_TEST(suite, TestEvalMany_NullArg);
   SUITE_ADD_TEST(suite, TestEvalMany_ValidObj);
+  SUITE_ADD_TEST(suite, TestEval_TailCallsInConstantStack);
+  SUITE_ADD_TEST(suite, TestEval_CallsDontAllocateArgLists);
   SUITE_ADD_TEST(suite, TestApply_NullArg);
+  SUITE_ADD_TEST(suite, TestApply_ArgsArray);
 
   return suite;
 }
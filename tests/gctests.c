@@ -0,0 +1,245 @@
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "tests/CuTest.h"
+#include "inc/ast.h"
+#include "inc/gc.h"
+
+// Allocates `n` pairs that are immediately dropped.
+static void alloc_garbage(CuTest *tc, int n)
+{
+  int i;
+  int err;
+  struct astnode *node;
+
+  for (i = 0; i < n; i++)
+    {
+      err = alloc_astnode(TYPE_PAIR, &node);
+      CuAssertIntEquals(tc, 0, err);
+    }
+}
+
+void TestAllocAstnode_NullArg(CuTest *tc) {
+  int err;
+
+  err = alloc_astnode(TYPE_PAIR, NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+}
+
+void TestAllocAstnode_InitsNode(CuTest *tc) {
+  int err;
+  struct astnode_pair *pair;
+
+  err = alloc_astnode(TYPE_PAIR, (struct astnode **) &pair);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_PAIR, pair->type);
+  CuAssertPtrEquals(tc, NULL, pair->car);
+  CuAssertPtrEquals(tc, NULL, pair->cdr);
+}
+
+void TestAllocAstnode_Int(CuTest *tc) {
+  int err;
+  struct astnode *node;
+
+  // Integers are fixnums; they are never allocated.
+  err = alloc_astnode(TYPE_INT, &node);
+  CuAssertIntEquals(tc, EINVAL, err);
+}
+
+void TestAllocAstnode_Boolean(CuTest *tc) {
+  int err;
+  struct astnode *node;
+
+  // There are only two booleans, BOOLEAN_TRUE and BOOLEAN_FALSE.
+  err = alloc_astnode(TYPE_BOOLEAN, &node);
+  CuAssertIntEquals(tc, EINVAL, err);
+}
+
+void TestAllocAstnodeSized_Sizes(CuTest *tc) {
+  const size_t MAX_SIZE = 16384;
+  int err;
+  size_t size;
+  struct astnode_env *env;
+
+  for (size = sizeof(struct astnode_env); size <= MAX_SIZE; size *= 2)
+    {
+      err = alloc_astnode_sized(TYPE_ENV, size, (struct astnode **) &env);
+      CuAssertIntEquals(tc, 0, err);
+      CuAssertIntEquals(tc, TYPE_ENV, env->type);
+      // The whole object must be zeroed
+      CuAssertPtrEquals(tc, NULL, ((void **) env)[size / sizeof(void *) - 1]);
+    }
+
+}
+
+void TestAllocAstnodeSized_Large(CuTest *tc) {
+  const uint32_t LEN = 100000;
+  int err;
+  int i;
+  uint32_t j;
+  struct astnode_vector *vector;
+  struct astnode_vector *garbage;
+  struct astnode **middle;
+  struct gc_stats before;
+  struct gc_stats after;
+
+  err = alloc_astnode_sized(TYPE_VECTOR, sizeof(struct astnode_vector) +
+			    LEN * sizeof(struct astnode *),
+			    (struct astnode **) &vector);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_VECTOR, vector->type);
+  CuAssertPtrEquals(tc, NULL, vector->elts[LEN - 1]);
+  vector->len = LEN;
+
+  // Elements are only referenced from the vector, and the vector only through
+  // a pointer into its middle
+  for (j = 0; j < LEN; j += 1000)
+    {
+      err = alloc_astnode(TYPE_PAIR, &vector->elts[j]);
+      CuAssertIntEquals(tc, 0, err);
+      ((struct astnode_pair *) vector->elts[j])->car = make_fixnum(j);
+    }
+  middle = &vector->elts[LEN / 2];
+  vector = NULL;
+
+  // Dead large objects are given back
+  gc_get_stats(&before);
+  for (i = 0; i < 10; i++)
+    {
+      err = alloc_astnode_sized(TYPE_VECTOR, 2 * GC_MAX_OBJ_SIZE,
+				(struct astnode **) &garbage);
+      CuAssertIntEquals(tc, 0, err);
+    }
+  garbage = NULL;
+  err = gc_collect();
+  CuAssertIntEquals(tc, 0, err);
+  gc_get_stats(&after);
+  CuAssertTrue(tc, after.heap_size < before.heap_size + 2 * GC_MAX_OBJ_SIZE);
+
+  alloc_garbage(tc, LEN);
+
+  vector = (struct astnode_vector *) ((char *) (middle - LEN / 2) -
+				      offsetof(struct astnode_vector, elts));
+  for (j = 0; j < LEN; j += 1000)
+    {
+      CuAssertIntEquals(tc, TYPE_PAIR, astnode_type_of(vector->elts[j]));
+      CuAssertIntEquals(tc, j,
+			fixnum_val(((struct astnode_pair *) vector->elts[j])->car));
+    }
+}
+
+void TestGcAddRoot_NullArg(CuTest *tc) {
+  int err;
+
+  err = gc_add_root(NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+}
+
+void TestGcCollect_KeepsReachable(CuTest *tc) {
+  const int NELEMS = 10000;
+  int err;
+  int i;
+  struct astnode_pair *list;
+  struct astnode_pair *scanner;
+  struct gc_stats before;
+  struct gc_stats after;
+
+  // Build (0 1 2 ... NELEMS-1) backwards, only referenced from the stack.
+  list = EMPTY_LIST;
+  for (i = NELEMS - 1; i >= 0; i--)
+    {
+      struct astnode_pair *pair;
+
+      err = alloc_astnode(TYPE_PAIR, (struct astnode **) &pair);
+      CuAssertIntEquals(tc, 0, err);
+      pair->car = make_fixnum(i);
+      pair->cdr = (struct astnode *) list;
+      list = pair;
+    }
+
+  gc_get_stats(&before);
+  err = gc_collect();
+  CuAssertIntEquals(tc, 0, err);
+  gc_get_stats(&after);
+  CuAssertIntEquals(tc, before.ncollections + 1, after.ncollections);
+
+  // Reuse the memory that was just freed; it must not overlap the list.
+  alloc_garbage(tc, NELEMS);
+
+  for (i = 0, scanner = list;
+       !is_empty_list((struct astnode *) scanner);
+       i++, scanner = (struct astnode_pair *) scanner->cdr)
+    {
+      CuAssertIntEquals(tc, TYPE_PAIR, scanner->type);
+      CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(scanner->car));
+      CuAssertIntEquals(tc, i, fixnum_val(scanner->car));
+    }
+  CuAssertIntEquals(tc, NELEMS, i);
+}
+
+void TestGcCollect_HeapFlattens(CuTest *tc) {
+  const int NALLOCS = 1000000;
+  struct gc_stats first;
+  struct gc_stats second;
+
+  alloc_garbage(tc, NALLOCS);
+  gc_get_stats(&first);
+
+  alloc_garbage(tc, NALLOCS);
+  gc_get_stats(&second);
+
+  CuAssertTrue(tc, second.ncollections > first.ncollections);
+  CuAssertTrue(tc, second.heap_size == first.heap_size);
+  CuAssertTrue(tc, second.nallocs >= first.nallocs + NALLOCS);
+}
+
+// Churn after a large live set: with a threshold of twice the live set,
+// allocating four times the live set in garbage takes a few collections, not
+// one per page filled.
+void TestGcCollect_BoundedWithLargeLiveSet(CuTest *tc) {
+  const int NLIVE = 300000;
+  struct astnode_pair *list;
+  struct astnode_pair *pair;
+  struct gc_stats before;
+  struct gc_stats after;
+  int err;
+  int i;
+
+  list = EMPTY_LIST;
+  for (i = 0; i < NLIVE; i++)
+    {
+      err = alloc_astnode(TYPE_PAIR, (struct astnode **) &pair);
+      CuAssertIntEquals(tc, 0, err);
+      pair->car = make_fixnum(i);
+      pair->cdr = (struct astnode *) list;
+      list = pair;
+    }
+  err = gc_collect();
+  CuAssertIntEquals(tc, 0, err);
+
+  gc_get_stats(&before);
+  alloc_garbage(tc, 4 * NLIVE);
+  gc_get_stats(&after);
+
+  CuAssertTrue(tc, after.ncollections > before.ncollections);
+  CuAssertTrue(tc, after.ncollections <= before.ncollections + 8);
+  CuAssertTrue(tc, list_length((struct astnode *) list) == NLIVE);
+}
+
+CuSuite* GcGetSuite() {
+  CuSuite* suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, TestAllocAstnode_NullArg);
+  SUITE_ADD_TEST(suite, TestAllocAstnode_InitsNode);
+  SUITE_ADD_TEST(suite, TestAllocAstnode_Int);
+  SUITE_ADD_TEST(suite, TestAllocAstnode_Boolean);
+  SUITE_ADD_TEST(suite, TestAllocAstnodeSized_Sizes);
+  SUITE_ADD_TEST(suite, TestAllocAstnodeSized_Large);
+  SUITE_ADD_TEST(suite, TestGcAddRoot_NullArg);
+  SUITE_ADD_TEST(suite, TestGcCollect_KeepsReachable);
+  SUITE_ADD_TEST(suite, TestGcCollect_HeapFlattens);
+  SUITE_ADD_TEST(suite, TestGcCollect_BoundedWithLargeLiveSet);
+
+  return suite;
+}
@@ -0,0 +1,132 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "tests/CuTest.h"
+#include "inc/ast.h"
+#include "inc/env.h"
+#include "inc/eval.h"
+#include "inc/gc.h"
+#include "inc/image.h"
+#include "tests/testhelpers.h"
+
+// Places in `path` the name of a new empty file.
+static void make_temp_path(CuTest *tc, char *path, size_t size)
+{
+  int fd;
+
+  snprintf(path, size, "/tmp/imagetestsXXXXXX");
+  fd = mkstemp(path);
+  CuAssertTrue(tc, fd >= 0);
+  close(fd);
+}
+
+static void assert_evals_to(CuTest *tc, const char *src,
+			    struct astnode_env *env, int32_t val)
+{
+  struct astnode *ret;
+  int err;
+
+  err = eval_str(tc, src, env, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, val, fixnum_val(ret));
+}
+
+void TestImage_RoundTrip(CuTest *tc) {
+  enum eval_mode saved_mode = eval_mode;
+  struct astnode_env *loaded;
+  struct astnode_env *env;
+  struct astnode *ret;
+  char path[64];
+  size_t i;
+  int err;
+
+  for (i = 0; i < ntest_modes; i++)
+    {
+      eval_mode = test_modes[i];
+      err = make_top_level_env(&env);
+      CuAssertIntEquals(tc, 0, err);
+
+      // A procedure that already ran (so it may be compiled), a large object,
+      // a numeric vector, a quoted list and a continuation.
+      assert_evals_to(tc,
+		      "(define (fact n) (if (= n 0) 1 (* n (fact (- n 1)))))"
+		      "(define big (make-vector 5000 7))"
+		      "(define nums (make-s64vector 4 3))"
+		      "(define lst (quote (1 2 3)))"
+		      "(define k (call/cc (lambda (c) c)))"
+		      "(fact 5)", env, 120);
+
+      make_temp_path(tc, path, sizeof(path));
+      err = image_save(path, env);
+      CuAssertIntEquals(tc, 0, err);
+      err = image_load(path, &loaded);
+      CuAssertIntEquals(tc, 0, err);
+      unlink(path);
+      CuAssertTrue(tc, loaded != env);
+
+      err = gc_collect();
+      CuAssertIntEquals(tc, 0, err);
+
+      assert_evals_to(tc, "(fact 6)", loaded, 720);
+      assert_evals_to(tc, "(vector-ref big 4999)", loaded, 7);
+      assert_evals_to(tc, "(numvector-sum nums)", loaded, 12);
+      assert_evals_to(tc, "(car (cdr (cdr lst)))", loaded, 3);
+
+      // The two environments are independent
+      assert_evals_to(tc, "(vector-set! big 0 1) (define x 1)"
+		      "(vector-ref big 0)", loaded, 1);
+      assert_evals_to(tc, "(vector-ref big 0)", env, 7);
+      err = eval_str(tc, "x", env, &ret);
+      CuAssertIntEquals(tc, EBADMSG, err);
+    }
+
+  eval_mode = saved_mode;
+}
+
+void TestImage_Errors(CuTest *tc) {
+  struct astnode_env *env;
+  struct astnode_env *frame;
+  struct astnode *root;
+  char path[64];
+  FILE *file;
+  int err;
+
+  err = make_top_level_env(&env);
+  CuAssertIntEquals(tc, 0, err);
+
+  err = image_save(NULL, env);
+  CuAssertIntEquals(tc, EINVAL, err);
+  err = image_load("/nonexistent/image", &env);
+  CuAssertIntEquals(tc, ENOENT, err);
+
+  // Only top-level environments can be saved
+  err = extend_env_array(env, EMPTY_LIST, NULL, 0, &frame);
+  CuAssertIntEquals(tc, 0, err);
+  err = image_save("/tmp/unused", frame);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  make_temp_path(tc, path, sizeof(path));
+  file = fopen(path, "w");
+  CuAssertPtrNotNull(tc, file);
+  fprintf(file, "(define not-an-image #t)\n");
+  fclose(file);
+  err = image_load(path, &env);
+  CuAssertIntEquals(tc, EINVAL, err);
+  unlink(path);
+
+  // Images must be aligned like pages
+  err = gc_load_image((char *) env + 8, GC_PAGE_SIZE, &root);
+  CuAssertIntEquals(tc, EINVAL, err);
+}
+
+CuSuite* ImageGetSuite() {
+  CuSuite* suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, TestImage_RoundTrip);
+  SUITE_ADD_TEST(suite, TestImage_Errors);
+
+  return suite;
+}
@@ -24,13 +24,10 @@ void TestDefine_NormalBinding(CuTest *tc) {
   int err;
   char *sym;
   struct astnode_sym sym_node;
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair first_pair = {
@@ -38,7 +35,7 @@ void TestDefine_NormalBinding(CuTest *tc) {
     .car = (struct astnode *) &sym_node,
     .cdr = (struct astnode *) &sec_pair
   };
-  struct astnode_int *ret;
+  struct astnode *ret;
 
   sym = "z";
   sym_node.type = TYPE_SYM;
@@ -51,8 +48,8 @@ void TestDefine_NormalBinding(CuTest *tc) {
   // The return value of define is undefined; instead we lookup the environment
   err = lookup_env(top_level_env, &sym_node, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, VAL1, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, VAL1, fixnum_val(ret));
 }
 
 void TestDefine_Compproc(CuTest *tc) {
@@ -115,40 +112,31 @@ void TestIf_NormalBindingTruePath(CuTest *tc)
   const int VAL2 = 43;
   const int VAL3 = 44;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
-  struct astnode_int num2 = {
-    .type = TYPE_INT,
-    .intval = VAL2
-  };
-  struct astnode_int num3 = {
-    .type = TYPE_INT,
-    .intval = VAL3
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
+  struct astnode *num3 = make_fixnum(VAL3);
   struct astnode_pair third_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num3,
+    .car = num3,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num2,
+    .car = num2,
     .cdr = (struct astnode *) &third_pair
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
   err = kw_if(&first_pair, top_level_env, (struct astnode **)&ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, VAL2, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, VAL2, fixnum_val(ret));
 }
 
 void TestIf_NormalBindingFalsePath(CuTest *tc)
@@ -156,26 +144,20 @@ void TestIf_NormalBindingFalsePath(CuTest *tc)
   const int VAL1 = 42;
   const int VAL2 = 43;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
-  struct astnode_int num2 = {
-    .type = TYPE_INT,
-    .intval = VAL2
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair third_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num2,
+    .car = num2,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   // We take a shortcut - we should have put the symbol "#f", but who has time
   // for that?
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &third_pair
   };
   struct astnode_pair first_pair = {
@@ -186,23 +168,20 @@ void TestIf_NormalBindingFalsePath(CuTest *tc)
 
   err = kw_if(&first_pair, top_level_env, (struct astnode **)&ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, VAL2, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, VAL2, fixnum_val(ret));
 }
 
 void TestIf_TooFewArgs(CuTest *tc)
 {
   const int VAL1 = 42;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   // We take a shortcut - we should have put the symbol "#f", but who has time
@@ -222,24 +201,18 @@ void TestIf_TooManyArgs(CuTest *tc)
   const int VAL1 = 42;
   const int VAL2 = 43;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
-  struct astnode_int num2 = {
-    .type = TYPE_INT,
-    .intval = VAL2
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair fourth_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num2,
+    .car = num2,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair third_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &fourth_pair
   };
   // We take a shortcut - we should have put the symbol "#f", but who has time
@@ -285,7 +258,7 @@ void TestQuote_ValidObj(CuTest *tc) {
   err = kw_quote(&first_pair, top_level_env, (struct astnode **)&ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_SYM, ret->type);
-  CuAssertPtrEquals(tc, sym_node.symi, ret->symi);
+  CuAssertIntEquals(tc, sym_node.symi, ret->symi);
 }
 
 void TestQuote_TooFewArgs(CuTest *tc)
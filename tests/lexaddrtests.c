@@ -0,0 +1,167 @@
+#include <errno.h>
+
+#include "tests/CuTest.h"
+#include "inc/ast.h"
+#include "inc/env.h"
+#include "inc/eval.h"
+#include "inc/gc.h"
+#include "inc/lexaddr.h"
+#include "inc/symbols.h"
+#include "tests/testhelpers.h"
+
+// Note: We use the top_level_env object defined and initialized in envtests.c
+extern struct astnode_env *top_level_env;
+
+static struct astnode *nth(struct astnode *list, int n)
+{
+  for ( ; n > 0; n--)
+    list = ((struct astnode_pair *) list)->cdr;
+
+  return ((struct astnode_pair *) list)->car;
+}
+
+static void assert_lexaddr(CuTest *tc, struct astnode *node, uint32_t depth,
+			   uint32_t index)
+{
+  CuAssertIntEquals(tc, TYPE_LEXADDR, astnode_type_of(node));
+  CuAssertIntEquals(tc, depth, ((struct astnode_lexaddr *) node)->depth);
+  CuAssertIntEquals(tc, index, ((struct astnode_lexaddr *) node)->index);
+}
+
+void TestResolveLexaddrs_NullArg(CuTest *tc) {
+  int err;
+
+  err = resolve_lexaddrs(NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+}
+
+void TestResolveLexaddrs_Params(CuTest *tc) {
+  // ((lambda (a b) (cons b a)) 1 2)
+  int err;
+  struct astnode *call;
+  struct astnode *ret;
+  struct astnode_compproc *proc;
+  struct astnode *body;
+
+  call = make_list(tc, 3,
+		   make_list(tc, 3, make_sym(tc, "lambda"),
+			     make_list(tc, 2, make_sym(tc, "a"), make_sym(tc, "b")),
+			     make_list(tc, 3, make_sym(tc, "cons"),
+				       make_sym(tc, "b"), make_sym(tc, "a"))),
+		   make_fixnum(1), make_fixnum(2));
+
+  err = eval(nth(call, 0), top_level_env, (struct astnode **) &proc);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_COMPPROC, proc->type);
+
+  body = proc->body->car;
+  CuAssertIntEquals(tc, TYPE_SYM, astnode_type_of(nth(body, 0)));
+  assert_lexaddr(tc, nth(body, 1), 0, 1);
+  assert_lexaddr(tc, nth(body, 2), 0, 0);
+
+  err = eval(call, top_level_env, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_PAIR, astnode_type_of(ret));
+  CuAssertIntEquals(tc, 2, fixnum_val(((struct astnode_pair *) ret)->car));
+  CuAssertIntEquals(tc, 1, fixnum_val(((struct astnode_pair *) ret)->cdr));
+}
+
+void TestResolveLexaddrs_Nested(CuTest *tc) {
+  // (((lambda (a) (lambda (b) (cons a b))) 1) 2)
+  int err;
+  struct astnode *outer;
+  struct astnode *inner;
+  struct astnode *ret;
+
+  inner = make_list(tc, 3, make_sym(tc, "lambda"),
+		    make_list(tc, 1, make_sym(tc, "b")),
+		    make_list(tc, 3, make_sym(tc, "cons"),
+			      make_sym(tc, "a"), make_sym(tc, "b")));
+  outer = make_list(tc, 3, make_sym(tc, "lambda"),
+		    make_list(tc, 1, make_sym(tc, "a")), inner);
+
+  err = eval(make_list(tc, 2, make_list(tc, 2, outer, make_fixnum(1)),
+		       make_fixnum(2)),
+	     top_level_env, &ret);
+  CuAssertIntEquals(tc, 0, err);
+
+  assert_lexaddr(tc, nth(nth(inner, 2), 1), 1, 0);
+  assert_lexaddr(tc, nth(nth(inner, 2), 2), 0, 0);
+
+  CuAssertIntEquals(tc, TYPE_PAIR, astnode_type_of(ret));
+  CuAssertIntEquals(tc, 1, fixnum_val(((struct astnode_pair *) ret)->car));
+  CuAssertIntEquals(tc, 2, fixnum_val(((struct astnode_pair *) ret)->cdr));
+}
+
+void TestResolveLexaddrs_QuoteUntouched(CuTest *tc) {
+  // (lambda (a) (quote a))
+  int err;
+  struct astnode *quoted;
+  struct astnode_compproc *proc;
+
+  quoted = make_list(tc, 2, make_sym(tc, "quote"), make_sym(tc, "a"));
+  err = eval(make_list(tc, 3, make_sym(tc, "lambda"),
+		       make_list(tc, 1, make_sym(tc, "a")), quoted),
+	     top_level_env, (struct astnode **) &proc);
+  CuAssertIntEquals(tc, 0, err);
+
+  CuAssertIntEquals(tc, TYPE_SYM, astnode_type_of(nth(quoted, 1)));
+}
+
+void TestResolveLexaddrs_InternalDefine(CuTest *tc) {
+  // (((lambda (a) (lambda (b) (define a b) a)) 1) 2)
+  int err;
+  struct astnode *define;
+  struct astnode *inner;
+  struct astnode *outer;
+  struct astnode *ret;
+
+  define = make_list(tc, 3, make_sym(tc, "define"),
+		     make_sym(tc, "a"), make_sym(tc, "b"));
+  inner = make_list(tc, 4, make_sym(tc, "lambda"),
+		    make_list(tc, 1, make_sym(tc, "b")), define,
+		    make_sym(tc, "a"));
+  outer = make_list(tc, 3, make_sym(tc, "lambda"),
+		    make_list(tc, 1, make_sym(tc, "a")), inner);
+
+  err = eval(make_list(tc, 2, make_list(tc, 2, outer, make_fixnum(1)),
+		       make_fixnum(2)),
+	     top_level_env, &ret);
+  CuAssertIntEquals(tc, 0, err);
+
+  // The definition target is not a reference, and the inner `a` refers to the
+  // definition rather than to the outer parameter.
+  CuAssertIntEquals(tc, TYPE_SYM, astnode_type_of(nth(define, 1)));
+  assert_lexaddr(tc, nth(define, 2), 0, 0);
+  CuAssertIntEquals(tc, TYPE_SYM, astnode_type_of(nth(inner, 3)));
+
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, 2, fixnum_val(ret));
+}
+
+void TestLookupLexaddr_NoSuchBinding(CuTest *tc) {
+  int err;
+  struct astnode *ret;
+
+  err = lookup_lexaddr(NULL, 0, 0, &ret);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = lookup_lexaddr(top_level_env, 1, 0, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  err = lookup_lexaddr(top_level_env, 0, UINT32_MAX, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+}
+
+CuSuite* LexaddrGetSuite() {
+  CuSuite* suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, TestResolveLexaddrs_NullArg);
+  SUITE_ADD_TEST(suite, TestResolveLexaddrs_Params);
+  SUITE_ADD_TEST(suite, TestResolveLexaddrs_Nested);
+  SUITE_ADD_TEST(suite, TestResolveLexaddrs_QuoteUntouched);
+  SUITE_ADD_TEST(suite, TestResolveLexaddrs_InternalDefine);
+  SUITE_ADD_TEST(suite, TestLookupLexaddr_NoSuchBinding);
+
+  return suite;
+}
@@ -0,0 +1,313 @@
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tests/CuTest.h"
+#include "inc/ast.h"
+#include "inc/eval.h"
+#include "inc/numvec.h"
+#include "tests/testhelpers.h"
+
+// Long enough for a few whole vectors of every width, plus a tail
+#define MAX_LEN 75
+
+void TestNumvec_Alloc(CuTest *tc) {
+  int err;
+  struct astnode_numvector *vec;
+  uint32_t i;
+
+  err = numvec_alloc(NUMVEC_S32, 1, NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = numvec_alloc(NUMVEC_NKINDS, 1, &vec);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = numvec_alloc(NUMVEC_S64, 10, &vec);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_NUMVECTOR, vec->type);
+  CuAssertIntEquals(tc, NUMVEC_S64, vec->kind);
+  CuAssertIntEquals(tc, 10, vec->len);
+  for (i = 0; i < vec->len; i++)
+    CuAssertTrue(tc, ((int64_t *) vec->data)[i] == 0);
+
+  // Bigger than any size class
+  err = numvec_alloc(NUMVEC_F64, 100000, &vec);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertTrue(tc, ((double *) vec->data)[99999] == 0.0);
+}
+
+// Deterministic values with both signs, some of them big enough for integer
+// products to wrap around.
+static int32_t test_value(uint32_t i, uint32_t seed)
+{
+  uint32_t x = (i + 1) * 2654435761u ^ seed;
+
+  return (x & 1) ? (int32_t) x : (int32_t) (x % 1000) - 500;
+}
+
+static void check_s32_kernels(CuTest *tc, const struct numvec_kernels *k,
+			      const int32_t *a, const int32_t *b, uint32_t n)
+{
+  int32_t dst[MAX_LEN];
+  uint32_t dot;
+  uint32_t sum;
+  int32_t min;
+  int32_t max;
+  uint32_t i;
+
+  k->s32.add(dst, a, b, n);
+  for (i = 0; i < n; i++)
+    CuAssertTrue(tc,
+		 dst[i] == (int32_t) ((uint32_t) a[i] + (uint32_t) b[i]));
+  k->s32.mul(dst, a, b, n);
+  for (i = 0; i < n; i++)
+    CuAssertTrue(tc,
+		 dst[i] == (int32_t) ((uint32_t) a[i] * (uint32_t) b[i]));
+  k->s32.scale(dst, a, -7, n);
+  for (i = 0; i < n; i++)
+    CuAssertTrue(tc, dst[i] == (int32_t) ((uint32_t) a[i] * (uint32_t) -7));
+
+  for (dot = 0, sum = 0, i = 0; i < n; i++)
+    {
+      dot += (uint32_t) a[i] * (uint32_t) b[i];
+      sum += (uint32_t) a[i];
+    }
+  CuAssertTrue(tc, k->s32.dot(a, b, n) == (int32_t) dot);
+  CuAssertTrue(tc, k->s32.sum(a, n) == (int32_t) sum);
+
+  if (n == 0)
+    return;
+  for (min = max = a[0], i = 1; i < n; i++)
+    {
+      min = a[i] < min ? a[i] : min;
+      max = a[i] > max ? a[i] : max;
+    }
+  CuAssertTrue(tc, k->s32.min(a, n) == min);
+  CuAssertTrue(tc, k->s32.max(a, n) == max);
+}
+
+static void check_s64_kernels(CuTest *tc, const struct numvec_kernels *k,
+			      const int64_t *a, const int64_t *b, uint32_t n)
+{
+  int64_t dst[MAX_LEN];
+  uint64_t dot;
+  uint64_t sum;
+  int64_t min;
+  int64_t max;
+  uint32_t i;
+
+  k->s64.add(dst, a, b, n);
+  for (i = 0; i < n; i++)
+    CuAssertTrue(tc,
+		 dst[i] == (int64_t) ((uint64_t) a[i] + (uint64_t) b[i]));
+  k->s64.mul(dst, a, b, n);
+  for (i = 0; i < n; i++)
+    CuAssertTrue(tc,
+		 dst[i] == (int64_t) ((uint64_t) a[i] * (uint64_t) b[i]));
+  k->s64.scale(dst, a, 3, n);
+  for (i = 0; i < n; i++)
+    CuAssertTrue(tc, dst[i] == (int64_t) ((uint64_t) a[i] * 3));
+
+  for (dot = 0, sum = 0, i = 0; i < n; i++)
+    {
+      dot += (uint64_t) a[i] * (uint64_t) b[i];
+      sum += (uint64_t) a[i];
+    }
+  CuAssertTrue(tc, k->s64.dot(a, b, n) == (int64_t) dot);
+  CuAssertTrue(tc, k->s64.sum(a, n) == (int64_t) sum);
+
+  if (n == 0)
+    return;
+  for (min = max = a[0], i = 1; i < n; i++)
+    {
+      min = a[i] < min ? a[i] : min;
+      max = a[i] > max ? a[i] : max;
+    }
+  CuAssertTrue(tc, k->s64.min(a, n) == min);
+  CuAssertTrue(tc, k->s64.max(a, n) == max);
+}
+
+// The values are small integers, so that sums are exact in any order.
+static void check_f64_kernels(CuTest *tc, const struct numvec_kernels *k,
+			      const double *a, const double *b, uint32_t n)
+{
+  double dst[MAX_LEN];
+  double dot;
+  double sum;
+  double min;
+  double max;
+  uint32_t i;
+
+  k->f64.add(dst, a, b, n);
+  for (i = 0; i < n; i++)
+    CuAssertTrue(tc, dst[i] == a[i] + b[i]);
+  k->f64.mul(dst, a, b, n);
+  for (i = 0; i < n; i++)
+    CuAssertTrue(tc, dst[i] == a[i] * b[i]);
+  k->f64.scale(dst, a, -2, n);
+  for (i = 0; i < n; i++)
+    CuAssertTrue(tc, dst[i] == a[i] * -2);
+
+  for (dot = 0, sum = 0, i = 0; i < n; i++)
+    {
+      dot += a[i] * b[i];
+      sum += a[i];
+    }
+  CuAssertTrue(tc, k->f64.dot(a, b, n) == dot);
+  CuAssertTrue(tc, k->f64.sum(a, n) == sum);
+
+  if (n == 0)
+    return;
+  for (min = max = a[0], i = 1; i < n; i++)
+    {
+      min = a[i] < min ? a[i] : min;
+      max = a[i] > max ? a[i] : max;
+    }
+  CuAssertTrue(tc, k->f64.min(a, n) == min);
+  CuAssertTrue(tc, k->f64.max(a, n) == max);
+}
+
+// Every kernel set that runs on this CPU must agree with plain loops, for
+// every length (whole vectors and tails) and with misaligned arrays.
+void TestNumvec_Kernels(CuTest *tc) {
+  int32_t a32[MAX_LEN + 1], b32[MAX_LEN + 1];
+  int64_t a64[MAX_LEN + 1], b64[MAX_LEN + 1];
+  double af[MAX_LEN + 1], bf[MAX_LEN + 1];
+  const struct numvec_kernels *k;
+  uint32_t isa;
+  uint32_t off;
+  uint32_t n;
+  uint32_t i;
+
+  for (i = 0; i < MAX_LEN + 1; i++)
+    {
+      a32[i] = test_value(i, 0);
+      b32[i] = test_value(i, 0x5bd1e995);
+      a64[i] = (int64_t) a32[i] * 0x10001;
+      b64[i] = (int64_t) b32[i] * ((int64_t) 1 << 20);
+      af[i] = a32[i] % 1000;
+      bf[i] = b32[i] % 1000;
+    }
+
+  CuAssertPtrNotNull(tc, numvec_kernels_for(NUMVEC_ISA_VEC128));
+  CuAssertPtrNotNull(tc, numvec_kernels());
+
+  for (isa = 0; isa < NUMVEC_NISAS; isa++)
+    {
+      k = numvec_kernels_for(isa);
+      if (k == NULL)
+	continue;
+      for (off = 0; off < 2; off++)
+	{
+	  for (n = 0; n + off <= MAX_LEN; n++)
+	    {
+	      check_s32_kernels(tc, k, a32 + off, b32 + off, n);
+	      check_s64_kernels(tc, k, a64 + off, b64 + off, n);
+	      check_f64_kernels(tc, k, af + off, bf + off, n);
+	    }
+	}
+    }
+}
+
+void TestNumvec_Ref(CuTest *tc) {
+  int err;
+  struct astnode_numvector *vec;
+  struct astnode *ret;
+
+  err = numvec_alloc(NUMVEC_S64, 2, &vec);
+  CuAssertIntEquals(tc, 0, err);
+  numvec_set(vec, 0, -5);
+  err = numvec_ref(vec, 0, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, -5, fixnum_val(ret));
+  err = numvec_ref(vec, 2, &ret);
+  CuAssertIntEquals(tc, EINVAL, err);
+  ((int64_t *) vec->data)[1] = (int64_t) 1 << 40;
+  err = numvec_ref(vec, 1, &ret);
+  CuAssertIntEquals(tc, EOVERFLOW, err);
+
+  // Doubles are truncated, and NaN is never an integer
+  err = numvec_alloc(NUMVEC_F64, 2, &vec);
+  CuAssertIntEquals(tc, 0, err);
+  ((double *) vec->data)[0] = -3.75;
+  ((double *) vec->data)[1] = NAN;
+  err = numvec_ref(vec, 0, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, -3, fixnum_val(ret));
+  err = numvec_ref(vec, 1, &ret);
+  CuAssertIntEquals(tc, EOVERFLOW, err);
+}
+
+static void assert_result(CuTest *tc, enum eval_mode mode, const char *src,
+			  int err_expected, int32_t val_expected)
+{
+  int err;
+  struct astnode *ret;
+
+  err = eval_str_in_mode(tc, mode, src, &ret);
+  CuAssertIntEquals(tc, err_expected, err);
+  if (err == 0)
+    CuAssertIntEquals(tc, val_expected, fixnum_val(ret));
+}
+
+void TestNumvec_Primitives(CuTest *tc) {
+  size_t i;
+
+  for (i = 0; i < ntest_modes; i++)
+    {
+      assert_result(tc, test_modes[i],
+		    "(define v (make-s32vector 5 2))"
+		    "(s32vector-set! v 0 7)"
+		    "(numvector-sum v)", 0, 15);
+      assert_result(tc, test_modes[i],
+		    "(define v (make-s64vector 3))"
+		    "(s64vector-set! v 2 -4)"
+		    "(+ (s64vector-length v) (s64vector-ref v 2))", 0, -1);
+      // (1 2 3) . (2 4 6) = 28
+      assert_result(tc, test_modes[i],
+		    "(define v (make-f64vector 3 1))"
+		    "(f64vector-set! v 1 2)"
+		    "(f64vector-set! v 2 3)"
+		    "(numvector-dot v (numvector-scale v 2))", 0, 28);
+      assert_result(tc, test_modes[i],
+		    "(define v (make-s32vector 3 1))"
+		    "(s32vector-set! v 1 -9)"
+		    "(define w (numvector-mul (numvector-add v v) v))"
+		    "(+ (numvector-min w) (* 1000 (numvector-max w)))",
+		    0, 162002);
+
+      // Kinds and lengths must match
+      assert_result(tc, test_modes[i],
+		    "(numvector-add (make-s32vector 2) (make-s64vector 2))",
+		    EBADMSG, 0);
+      assert_result(tc, test_modes[i],
+		    "(numvector-dot (make-f64vector 2) (make-f64vector 3))",
+		    EBADMSG, 0);
+      assert_result(tc, test_modes[i], "(s64vector-ref (make-s32vector 2) 0)",
+		    EBADMSG, 0);
+      assert_result(tc, test_modes[i], "(s32vector-ref (make-s32vector 2) 2)",
+		    EBADMSG, 0);
+      assert_result(tc, test_modes[i], "(numvector-min (make-s32vector 0))",
+		    EBADMSG, 0);
+      assert_result(tc, test_modes[i], "(numvector-sum (make-s32vector 0))",
+		    0, 0);
+
+      // s64 results that don't fit in a fixnum can't be read
+      assert_result(tc, test_modes[i],
+		    "(numvector-sum"
+		    " (numvector-scale (make-s64vector 2 65536) 65536))",
+		    EOVERFLOW, 0);
+    }
+}
+
+CuSuite* NumvecGetSuite() {
+  CuSuite* suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, TestNumvec_Alloc);
+  SUITE_ADD_TEST(suite, TestNumvec_Kernels);
+  SUITE_ADD_TEST(suite, TestNumvec_Ref);
+  SUITE_ADD_TEST(suite, TestNumvec_Primitives);
+
+  return suite;
+}
@@ -0,0 +1,275 @@
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tests/CuTest.h"
+#include "inc/ast.h"
+#include "inc/env.h"
+#include "inc/eval.h"
+#include "inc/gc.h"
+#include "inc/symbols.h"
+#include "src/parser.tab.h"
+#include "tests/testhelpers.h"
+
+// The parser is tested on its own: the tokens come from the lexer below
+// rather than from flex, and a collection runs every `collect_every` tokens
+// (if not 0), so that the values on the parser's stack are collected if the
+// GC can't see them.
+static const char *input;
+static unsigned collect_every;
+static unsigned ntokens;
+
+int yylex(bool interactive)
+{
+  const char *start;
+
+  if (collect_every != 0 && ++ntokens % collect_every == 0 &&
+      gc_collect() != 0)
+    return 0;
+
+  while (*input == ' ' || *input == '\t' || (*input == '\n' && !interactive))
+    input++;
+  if (*input == '\0')
+    return 0;
+  if (*input == '\n')
+    {
+      input++;
+      return 0;
+    }
+  if (*input == '(' || *input == ')' || *input == '\'')
+    return *input++;
+
+  start = input;
+  while (*input != '\0' && strchr(" \t\n()'", *input) == NULL)
+    input++;
+  if (input - start == 1 && *start == '.')
+    return '.';
+  if (isdigit((unsigned char) *start))
+    {
+      yylval = make_fixnum(atoi(start));
+      return EXP;
+    }
+  if (*start == '#')
+    {
+      yylval = make_boolean(start[1] == 't');
+      return EXP;
+    }
+
+  if (alloc_astnode(TYPE_SYM, &yylval) != 0 ||
+      putsym((char *) start, (char *) input - 1,
+	     &((struct astnode_sym *) yylval)->symi) != 0)
+    return 0;
+
+  return EXP;
+}
+
+// Allocates `n` pairs, which reuse the objects that the last collection
+// freed.
+static void alloc_garbage(CuTest *tc, int n)
+{
+  struct astnode *pair;
+  int err;
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      err = alloc_astnode(TYPE_PAIR, &pair);
+      CuAssertIntEquals(tc, 0, err);
+      ((struct astnode_pair *) pair)->car = make_fixnum(i);
+      ((struct astnode_pair *) pair)->cdr = make_fixnum(i);
+    }
+}
+
+// The elements of an open list wait on the parser's stack until its ')' is
+// read: more of them than fit in the stack's initial array must be safe from
+// collections too.
+void TestParser_LongListSurvivesCollections(CuTest *tc) {
+  enum { LEN = 1000 };
+  struct astnode *exp;
+  struct astnode *end;
+  struct astnode *node;
+  const char *symval;
+  char name[16];
+  char *src;
+  size_t len;
+  int err;
+  int i;
+
+  src = malloc(LEN * sizeof(name) + 3);
+  CuAssertPtrNotNull(tc, src);
+  len = sprintf(src, "(");
+  for (i = 0; i < LEN; i++)
+    len += sprintf(src + len, i % 2 == 0 ? "elt%d " : "%d ", i);
+  sprintf(src + len, ")");
+
+  input = src;
+  collect_every = 50;
+  err = yyparse_one(false, &exp);
+  collect_every = 0;
+  CuAssertIntEquals(tc, 0, err);
+  // The lexer reads `src` until the end of the input is seen
+  err = yyparse_one(false, &end);
+  input = "";
+  free(src);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, NULL, end);
+  alloc_garbage(tc, 100000);
+
+  CuAssertTrue(tc, list_length(exp) == LEN);
+  for (i = 0, node = exp; i < LEN; i++)
+    {
+      struct astnode *elt = ((struct astnode_pair *) node)->car;
+
+      if (i % 2 == 0)
+	{
+	  CuAssertIntEquals(tc, TYPE_SYM, astnode_type_of(elt));
+	  err = getsym(((struct astnode_sym *) elt)->symi, &symval);
+	  CuAssertIntEquals(tc, 0, err);
+	  snprintf(name, sizeof(name), "elt%d", i);
+	  CuAssertStrEquals(tc, name, symval);
+	}
+      else
+	CuAssertIntEquals(tc, i, fixnum_val(elt));
+      node = ((struct astnode_pair *) node)->cdr;
+    }
+}
+
+// In interactive mode, yyparse_one stops at the end of the line, as the REPL
+// expects.
+void TestParser_OneAtATime(CuTest *tc) {
+  struct astnode *exp;
+  int err;
+
+  input = "1 (a) \n2";
+  err = yyparse_one(true, &exp);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 1, fixnum_val(exp));
+  err = yyparse_one(true, &exp);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_PAIR, astnode_type_of(exp));
+  err = yyparse_one(true, &exp);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, NULL, exp);
+  err = yyparse_one(true, &exp);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 2, fixnum_val(exp));
+  err = yyparse_one(true, &exp);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, NULL, exp);
+
+  input = "(1 2";
+  err = yyparse_one(false, &exp);
+  CuAssertTrue(tc, err != 0);
+}
+
+void TestParser_QuoteAndDottedPairs(CuTest *tc) {
+  struct astnode_pair *pair;
+  struct astnode *exp;
+  const char *symval;
+  int err;
+
+  input = "'(1 . 2)";
+  err = yyparse_one(false, &exp);
+  CuAssertIntEquals(tc, 0, err);
+  pair = (struct astnode_pair *) exp;
+  CuAssertIntEquals(tc, TYPE_SYM, astnode_type_of(pair->car));
+  err = getsym(((struct astnode_sym *) pair->car)->symi, &symval);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertStrEquals(tc, "quote", symval);
+  pair = (struct astnode_pair *) pair->cdr;
+  CuAssertPtrEquals(tc, EMPTY_LIST, pair->cdr);
+  pair = (struct astnode_pair *) pair->car;
+  CuAssertIntEquals(tc, 1, fixnum_val(pair->car));
+  CuAssertIntEquals(tc, 2, fixnum_val(pair->cdr));
+
+  input = "(1 2 . 3)";
+  err = yyparse_one(false, &exp);
+  CuAssertIntEquals(tc, 0, err);
+  pair = (struct astnode_pair *) ((struct astnode_pair *) exp)->cdr;
+  CuAssertIntEquals(tc, 2, fixnum_val(pair->car));
+  CuAssertIntEquals(tc, 3, fixnum_val(pair->cdr));
+
+  input = "(. 1)";
+  err = yyparse_one(false, &exp);
+  CuAssertTrue(tc, err != 0);
+  input = "(1 . 2 3)";
+  err = yyparse_one(false, &exp);
+  CuAssertTrue(tc, err != 0);
+  input = "'";
+  err = yyparse_one(false, &exp);
+  CuAssertTrue(tc, err != 0);
+}
+
+// Parsing and evaluating top-level forms one at a time, as the REPL and
+// scripts read from the standard input do, must not leave their parse trees
+// behind, while collections run during the parse: only the quoted list and
+// the body of the last definition of f stay reachable.
+void TestParser_TreesAreReclaimed(CuTest *tc) {
+  const char *src =
+    "(define (f x) (cons x (quote (a b c)))) (f (+ 1 2)) (f #t)";
+  enum eval_mode saved_mode = eval_mode;
+  struct astnode_env *env;
+  struct gc_stats before;
+  struct gc_stats after;
+  struct astnode *exp;
+  struct astnode *val;
+  size_t i;
+  int round;
+  int err;
+
+  for (i = 0; i < ntest_modes; i++)
+    {
+      eval_mode = test_modes[i];
+      err = make_top_level_env(&env);
+      CuAssertIntEquals(tc, 0, err);
+
+      collect_every = 2000;
+      for (round = 0; round < 2000; round++)
+	{
+	  if (round == 100)
+	    {
+	      err = gc_collect();
+	      CuAssertIntEquals(tc, 0, err);
+	      gc_get_stats(&before);
+	    }
+
+	  input = src;
+	  for (;;)
+	    {
+	      err = yyparse_one(false, &exp);
+	      CuAssertIntEquals(tc, 0, err);
+	      if (exp == NULL)
+		break;
+	      err = eval(exp, env, &val);
+	      CuAssertIntEquals(tc, 0, err);
+	    }
+	  // The value of (f #t)
+	  CuAssertPtrEquals(tc, BOOLEAN_TRUE,
+			    ((struct astnode_pair *) val)->car);
+	}
+      collect_every = 0;
+      exp = NULL;
+      val = NULL;
+
+      err = gc_collect();
+      CuAssertIntEquals(tc, 0, err);
+      gc_get_stats(&after);
+      // Each round parses about 30 nodes: keeping them would take 2 MiB.
+      CuAssertTrue(tc, after.bytes_in_use < before.bytes_in_use + (64 << 10));
+    }
+
+  eval_mode = saved_mode;
+}
+
+CuSuite* ParserGetSuite() {
+  CuSuite* suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, TestParser_LongListSurvivesCollections);
+  SUITE_ADD_TEST(suite, TestParser_OneAtATime);
+  SUITE_ADD_TEST(suite, TestParser_QuoteAndDottedPairs);
+  SUITE_ADD_TEST(suite, TestParser_TreesAreReclaimed);
+
+  return suite;
+}
@@ -4,13 +4,35 @@
 
 #include "tests/CuTest.h"
 #include "inc/ast.h"
+#include "inc/gc.h"
 #include "inc/prmt_handlers.h"
 
+#define MAX_TEST_ARGS 8
+
+// Calls `handler` with the elements of the list `args`, laid out in an array
+// like eval lays them out on the argument stack.
+static int call_prmt(prmt_handler handler, struct astnode_pair *args,
+		     struct astnode **ret)
+{
+  struct astnode *array[MAX_TEST_ARGS];
+  uint32_t nargs;
+
+  for (nargs = 0;
+       !is_empty_list((struct astnode *) args);
+       args = (struct astnode_pair *) args->cdr)
+    {
+      if (nargs == MAX_TEST_ARGS)
+	return E2BIG;
+      array[nargs++] = args->car;
+    }
+
+  return handler(array, nargs, ret);
+}
 
 void TestCons_NullArgs(CuTest *tc) {
   int err;
 
-  err = prmt_cons(NULL, NULL);
+  err = prmt_cons(NULL, 0, NULL);
   CuAssertIntEquals(tc, EINVAL, err);
 }
 
@@ -18,38 +40,32 @@ void TestCons_ValidInts(CuTest *tc) {
   const int VAL1 = 42;
   const int VAL2 = 56;
   int err;
-  struct astnode_int num1;
-  struct astnode_int num2;
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair first_pair;
   struct astnode_pair sec_pair;
   struct astnode_pair *ret;
 
-  num1.type = TYPE_INT;
-  num1.intval = VAL1;
-
-  num2.type = TYPE_INT;
-  num2.intval = VAL2;
-
   first_pair.type = TYPE_PAIR;
-  first_pair.car = (struct astnode *) &num1;
+  first_pair.car = num1;
   first_pair.cdr = (struct astnode *) &sec_pair;
 
   sec_pair.type = TYPE_PAIR;
-  sec_pair.car = (struct astnode *) &num2;
+  sec_pair.car = num2;
   sec_pair.cdr = (struct astnode *) EMPTY_LIST;
 
-  err = prmt_cons(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_cons, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
 
   // Should should have received (1 . 2)
   CuAssertIntEquals(tc, TYPE_PAIR, ret->type);
-  CuAssertIntEquals(tc, TYPE_INT, ret->car->type);
-  CuAssertIntEquals(tc, TYPE_INT, ret->cdr->type);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret->car));
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret->cdr));
   CuAssertIntEquals(tc,
-		    ((struct astnode_int *) ret->car)->intval,
+		    fixnum_val(ret->car),
 		    VAL1);
   CuAssertIntEquals(tc,
-		    ((struct astnode_int *) ret->cdr)->intval,
+		    fixnum_val(ret->cdr),
 		    VAL2);
 }
 
@@ -59,25 +75,22 @@ void TestCons_NoArgs(CuTest *tc) {
   struct astnode *ret;
 
   arglist = EMPTY_LIST;
-  err = prmt_cons(arglist, &ret);
+  err = call_prmt(prmt_cons, arglist, &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
 void TestCons_OneArg(CuTest *tc) {
   const int VAL1 = 42;
   int err;
-  struct astnode_int num1;
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair first_pair;
   struct astnode_pair *ret;
 
-  num1.type = TYPE_INT;
-  num1.intval = VAL1;
-
   first_pair.type = TYPE_PAIR;
-  first_pair.car = (struct astnode *) &num1;
+  first_pair.car = num1;
   first_pair.cdr = (struct astnode *) EMPTY_LIST;
 
-  err = prmt_cons(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_cons, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
  }
 
@@ -85,39 +98,33 @@ void TestCons_TooManyArgs(CuTest *tc) {
   const int VAL1 = 42;
   const int VAL2 = 56;
   int err;
-  struct astnode_int num1;
-  struct astnode_int num2;
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair first_pair;
   struct astnode_pair sec_pair;
   struct astnode_pair third_pair;
   struct astnode_pair *ret;
 
-  num1.type = TYPE_INT;
-  num1.intval = VAL1;
-
-  num2.type = TYPE_INT;
-  num2.intval = VAL2;
-
   first_pair.type = TYPE_PAIR;
-  first_pair.car = (struct astnode *) &num1;
+  first_pair.car = num1;
   first_pair.cdr = (struct astnode *) &sec_pair;
 
   sec_pair.type = TYPE_PAIR;
-  sec_pair.car = (struct astnode *) &num2;
+  sec_pair.car = num2;
   sec_pair.cdr = (struct astnode *) &third_pair;
 
   third_pair.type = TYPE_PAIR;
-  third_pair.car = (struct astnode *) &num2;
+  third_pair.car = num2;
   third_pair.cdr = (struct astnode *) EMPTY_LIST;
 
-  err = prmt_cons(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_cons, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
 void TestCar_NullArgs(CuTest *tc) {
   int err;
 
-  err = prmt_car(NULL, NULL);
+  err = prmt_car(NULL, 0, NULL);
   CuAssertIntEquals(tc, EINVAL, err);
 }
 
@@ -125,32 +132,26 @@ void TestCar_ValidObj(CuTest *tc) {
   const int VAL1 = 121;
   const int VAL2 = 232;
   int err;
-  struct astnode_int num1;
-  struct astnode_int num2;
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair obj;
   struct astnode_pair arglist;
-  struct astnode_int *ret;
-
-  num1.type = TYPE_INT;
-  num1.intval = VAL1;
-
-  num2.type = TYPE_INT;
-  num2.intval = VAL2;
+  struct astnode *ret;
 
   obj.type = TYPE_PAIR;
-  obj.car = (struct astnode *) &num1;
-  obj.cdr = (struct astnode *) &num2;
+  obj.car = num1;
+  obj.cdr = num2;
 
   arglist.type = TYPE_PAIR;
   arglist.car = (struct astnode *) &obj;
   arglist.cdr = (struct astnode *) EMPTY_LIST;
 
-  err = prmt_car(&arglist, (struct astnode **) &ret);
+  err = call_prmt(prmt_car, &arglist, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
 
   // Should should have received (1 . 2)
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, VAL1, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, VAL1, fixnum_val(ret));
 }
 
 void TestCar_NoArgs(CuTest *tc) {
@@ -159,7 +160,7 @@ void TestCar_NoArgs(CuTest *tc) {
   struct astnode *ret;
 
   arglist = EMPTY_LIST;
-  err = prmt_car(arglist, &ret);
+  err = call_prmt(prmt_car, arglist, &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
@@ -167,34 +168,28 @@ void TestCar_TooManyArgs(CuTest *tc) {
   const int VAL1 = 42;
   const int VAL2 = 56;
   int err;
-  struct astnode_int num1;
-  struct astnode_int num2;
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair first_pair;
   struct astnode_pair sec_pair;
   struct astnode *ret;
 
-  num1.type = TYPE_INT;
-  num1.intval = VAL1;
-
-  num2.type = TYPE_INT;
-  num2.intval = VAL2;
-
   first_pair.type = TYPE_PAIR;
-  first_pair.car = (struct astnode *) &num1;
+  first_pair.car = num1;
   first_pair.cdr = (struct astnode *) &sec_pair;
 
   sec_pair.type = TYPE_PAIR;
-  sec_pair.car = (struct astnode *) &num2;
+  sec_pair.car = num2;
   sec_pair.cdr = (struct astnode *) EMPTY_LIST;
 
-  err = prmt_car(&first_pair, &ret);
+  err = call_prmt(prmt_car, &first_pair, &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
 void TestCdr_NullArgs(CuTest *tc) {
   int err;
 
-  err = prmt_cdr(NULL, NULL);
+  err = prmt_cdr(NULL, 0, NULL);
   CuAssertIntEquals(tc, EINVAL, err);
 }
 
@@ -204,7 +199,7 @@ void TestCdr_NoArgs(CuTest *tc) {
   struct astnode *ret;
 
   arglist = EMPTY_LIST;
-  err = prmt_cdr(arglist, &ret);
+  err = call_prmt(prmt_cdr, arglist, &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
@@ -212,27 +207,21 @@ void TestCdr_TooManyArgs(CuTest *tc) {
   const int VAL1 = 42;
   const int VAL2 = 56;
   int err;
-  struct astnode_int num1;
-  struct astnode_int num2;
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair first_pair;
   struct astnode_pair sec_pair;
   struct astnode *ret;
 
-  num1.type = TYPE_INT;
-  num1.intval = VAL1;
-
-  num2.type = TYPE_INT;
-  num2.intval = VAL2;
-
   first_pair.type = TYPE_PAIR;
-  first_pair.car = (struct astnode *) &num1;
+  first_pair.car = num1;
   first_pair.cdr = (struct astnode *) &sec_pair;
 
   sec_pair.type = TYPE_PAIR;
-  sec_pair.car = (struct astnode *) &num2;
+  sec_pair.car = num2;
   sec_pair.cdr = (struct astnode *) EMPTY_LIST;
 
-  err = prmt_cdr(&first_pair, &ret);
+  err = call_prmt(prmt_cdr, &first_pair, &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
@@ -241,38 +230,32 @@ void TestCdr_ValidObj(CuTest *tc) {
   const int VAL1 = 121;
   const int VAL2 = 232;
   int err;
-  struct astnode_int num1;
-  struct astnode_int num2;
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair obj;
   struct astnode_pair arglist;
-  struct astnode_int *ret;
-
-  num1.type = TYPE_INT;
-  num1.intval = VAL1;
-
-  num2.type = TYPE_INT;
-  num2.intval = VAL2;
+  struct astnode *ret;
 
   obj.type = TYPE_PAIR;
-  obj.car = (struct astnode *) &num1;
-  obj.cdr = (struct astnode *) &num2;
+  obj.car = num1;
+  obj.cdr = num2;
 
   arglist.type = TYPE_PAIR;
   arglist.car = (struct astnode *) &obj;
   arglist.cdr = (struct astnode *) EMPTY_LIST;
 
-  err = prmt_cdr(&arglist, (struct astnode **) &ret);
+  err = call_prmt(prmt_cdr, &arglist, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
 
   // Should should have received (1 . 2)
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, VAL2, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, VAL2, fixnum_val(ret));
 }
 
 void TestIsPair_NullArgs(CuTest *tc) {
   int err;
 
-  err = prmt_is_pair(NULL, NULL);
+  err = prmt_is_pair(NULL, 0, NULL);
   CuAssertIntEquals(tc, EINVAL, err);
 }
 
@@ -282,7 +265,7 @@ void TestIsPair_NoArgs(CuTest *tc) {
   struct astnode_boolean *ret;
 
   arglist = EMPTY_LIST;
-  err = prmt_is_pair(arglist, (struct astnode **) &ret);
+  err = call_prmt(prmt_is_pair, arglist, (struct astnode **) &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
@@ -290,7 +273,7 @@ void TestIsPair_ValidObj(CuTest *tc) {
   int err;
   struct astnode_pair arglist;
   struct astnode_pair obj;
-  struct astnode_int dummy;
+  struct astnode *dummy = make_fixnum(3);
   struct astnode_boolean *ret;
 
   arglist.type = TYPE_PAIR;
@@ -298,13 +281,10 @@ void TestIsPair_ValidObj(CuTest *tc) {
   arglist.cdr = (struct astnode *) EMPTY_LIST;
 
   obj.type = TYPE_PAIR;
-  obj.car = (struct astnode *) &dummy;
-  obj.cdr = (struct astnode *) &dummy;
-
-  dummy.type = TYPE_INT;
-  dummy.intval = 3;
+  obj.car = dummy;
+  obj.cdr = dummy;
 
-  err = prmt_is_pair(&arglist, (struct astnode **)&ret);
+  err = call_prmt(prmt_is_pair, &arglist, (struct astnode **)&ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_BOOLEAN, ret->type);
   CuAssertIntEquals(tc, 1, (int) ret->boolval);
@@ -320,7 +300,7 @@ void TestIsPair_EmptyList(CuTest *tc) {
   arglist.car = (struct astnode *) EMPTY_LIST;
   arglist.cdr = (struct astnode *) EMPTY_LIST;
 
-  err = prmt_is_pair(&arglist, (struct astnode **)&ret);
+  err = call_prmt(prmt_is_pair, &arglist, (struct astnode **)&ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_BOOLEAN, ret->type);
   CuAssertIntEquals(tc, 0, (int) ret->boolval);
@@ -329,17 +309,14 @@ void TestIsPair_EmptyList(CuTest *tc) {
 void TestIsPair_InvalidObj(CuTest *tc) {
   int err;
   struct astnode_pair arglist;
-  struct astnode_int obj;
+  struct astnode *obj = make_fixnum(3);
   struct astnode_boolean *ret;
 
   arglist.type = TYPE_PAIR;
-  arglist.car = (struct astnode *) &obj;
+  arglist.car = obj;
   arglist.cdr = (struct astnode *) EMPTY_LIST;
 
-  obj.type = TYPE_INT;
-  obj.intval = 3;
-
-  err = prmt_is_pair(&arglist, (struct astnode **)&ret);
+  err = call_prmt(prmt_is_pair, &arglist, (struct astnode **)&ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_BOOLEAN, ret->type);
   CuAssertIntEquals(tc, 0, (int) ret->boolval);
@@ -349,83 +326,71 @@ void TestIsPair_TooManyArgs(CuTest *tc) {
   const int VAL1 = 42;
   const int VAL2 = 56;
   int err;
-  struct astnode_int num1;
-  struct astnode_int num2;
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair first_pair;
   struct astnode_pair sec_pair;
   struct astnode_boolean *ret;
 
-  num1.type = TYPE_INT;
-  num1.intval = VAL1;
-
-  num2.type = TYPE_INT;
-  num2.intval = VAL2;
-
   first_pair.type = TYPE_PAIR;
-  first_pair.car = (struct astnode *) &num1;
+  first_pair.car = num1;
   first_pair.cdr = (struct astnode *) &sec_pair;
 
   sec_pair.type = TYPE_PAIR;
-  sec_pair.car = (struct astnode *) &num2;
+  sec_pair.car = num2;
   sec_pair.cdr = (struct astnode *) EMPTY_LIST;
 
-  err = prmt_is_pair(&first_pair,  (struct astnode **)&ret);
+  err = call_prmt(prmt_is_pair, &first_pair, (struct astnode **)&ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
 void TestPlus_NullArgs(CuTest *tc) {
   int err;
 
-  err = prmt_plus(NULL, NULL);
+  err = prmt_plus(NULL, 0, NULL);
   CuAssertIntEquals(tc, EINVAL, err);
 }
 
 void TestPlus_ValidObj(CuTest *tc) {
   const int VAL1 = 3;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_plus(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_plus, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, VAL1 + VAL1, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, VAL1 + VAL1, fixnum_val(ret));
 }
 
 void TestPlus_NoArgs(CuTest *tc) {
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
   struct astnode_pair *first_pair = EMPTY_LIST;
 
-  err = prmt_plus(first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_plus, first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, 0, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, 0, fixnum_val(ret));
 }
 
 void TestPlus_WrongType(CuTest *tc) {
   const int VAL1 = 3;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
     .car = (struct astnode *) BOOLEAN_FALSE,
@@ -433,86 +398,77 @@ void TestPlus_WrongType(CuTest *tc) {
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_plus(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_plus, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
 void TestMinus_NullArgs(CuTest *tc) {
   int err;
 
-  err = prmt_minus(NULL, NULL);
+  err = prmt_minus(NULL, 0, NULL);
   CuAssertIntEquals(tc, EINVAL, err);
 }
 
 void TestMinus_ValidObj(CuTest *tc) {
   const int VAL1 = 3;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_minus(&first_pair, (struct astnode **)&ret);
+  err = call_prmt(prmt_minus, &first_pair, (struct astnode **)&ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, VAL1 - VAL1, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, VAL1 - VAL1, fixnum_val(ret));
 }
 
 void TestMinus_NoArgs(CuTest *tc) {
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
   struct astnode_pair *first_pair = EMPTY_LIST;
 
-  err = prmt_minus(first_pair, (struct astnode **)&ret);
+  err = call_prmt(prmt_minus, first_pair, (struct astnode **)&ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
 void TestMinus_OneArg(CuTest *tc) {
   const int VAL1 = 3;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) EMPTY_LIST
   };
 
-  err = prmt_minus(&first_pair, (struct astnode **)&ret);
+  err = call_prmt(prmt_minus, &first_pair, (struct astnode **)&ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, -VAL1, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, -VAL1, fixnum_val(ret));
 }
 
 void TestMinus_WrongType(CuTest *tc) {
   const int VAL1 = 3;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
     .car = (struct astnode *) BOOLEAN_FALSE,
@@ -520,11 +476,11 @@ void TestMinus_WrongType(CuTest *tc) {
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_minus(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_minus, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
@@ -532,56 +488,50 @@ void TestMinus_WrongType(CuTest *tc) {
 void TestMult_NullArgs(CuTest *tc) {
   int err;
 
-  err = prmt_mult(NULL, NULL);
+  err = prmt_mult(NULL, 0, NULL);
   CuAssertIntEquals(tc, EINVAL, err);
 }
 
 void TestMult_NoArgs(CuTest *tc) {
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
   struct astnode_pair *first_pair = EMPTY_LIST;
 
-  err = prmt_mult(first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_mult, first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, 1, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, 1, fixnum_val(ret));
 }
 
 void TestMult_ValidObj(CuTest *tc) {
   const int VAL1 = 3;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_mult(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_mult, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, VAL1 * VAL1, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, VAL1 * VAL1, fixnum_val(ret));
 }
 
 void TestMult_WrongType(CuTest *tc) {
   const int VAL1 = 3;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
     .car = (struct astnode *) BOOLEAN_FALSE,
@@ -589,81 +539,101 @@ void TestMult_WrongType(CuTest *tc) {
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_mult(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_mult, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
 void TestDiv_NullArgs(CuTest *tc) {
   int err;
 
-  err = prmt_div(NULL, NULL);
+  err = prmt_div(NULL, 0, NULL);
   CuAssertIntEquals(tc, EINVAL, err);
 }
 
 void TestDiv_NoArgs(CuTest *tc) {
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
   struct astnode_pair *first_pair = EMPTY_LIST;
 
-  err = prmt_div(first_pair, (struct astnode **)&ret);
+  err = call_prmt(prmt_div, first_pair, (struct astnode **)&ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
 void TestDiv_ValidObj(CuTest *tc) {
   const int VAL1 = 3;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_div(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_div, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, VAL1 / VAL1, ret->intval);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, VAL1 / VAL1, fixnum_val(ret));
 }
 
 void TestDiv_OneArg(CuTest *tc) {
   const int VAL1 = 3;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) EMPTY_LIST
   };
 
-  err = prmt_div(&first_pair, (struct astnode **)&ret);
+  err = call_prmt(prmt_div, &first_pair, (struct astnode **)&ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, 1 / VAL1, fixnum_val(ret));
+}
+
+void TestDiv_ZeroAndOverflow(CuTest *tc) {
+  int err;
+  struct astnode *args[2];
+  struct astnode *ret;
+
+  args[0] = make_fixnum(0);
+  err = prmt_div(args, 1, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  args[0] = make_fixnum(5);
+  args[1] = make_fixnum(0);
+  err = prmt_div(args, 2, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  args[0] = make_fixnum(INT32_MIN);
+  args[1] = make_fixnum(-1);
+  err = prmt_div(args, 2, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  args[0] = make_fixnum(INT32_MIN);
+  args[1] = make_fixnum(1);
+  err = prmt_div(args, 2, &ret);
   CuAssertIntEquals(tc, 0, err);
-  CuAssertIntEquals(tc, TYPE_INT, ret->type);
-  CuAssertIntEquals(tc, 1 / VAL1, ret->intval);
+  CuAssertTrue(tc, fixnum_val(ret) == INT32_MIN);
 }
 
 void TestEqual_NullArgs(CuTest *tc) {
   int err;
 
-  err = prmt_equal(NULL, NULL);
+  err = prmt_equal(NULL, 0, NULL);
   CuAssertIntEquals(tc, EINVAL, err);
 }
 
@@ -672,7 +642,7 @@ void TestEqual_NoArgs(CuTest *tc) {
   struct astnode_boolean *ret;
   struct astnode_pair *first_pair = EMPTY_LIST;
 
-  err = prmt_equal(first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_equal, first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_BOOLEAN, ret->type);
   CuAssertIntEquals(tc, 1, (int) ret->boolval);
@@ -683,22 +653,19 @@ void TestEqual_ValidObjTrue(CuTest *tc) {
   int err;
   struct astnode_boolean *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_equal(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_equal, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_BOOLEAN, ret->type);
   CuAssertIntEquals(tc, 1, (int) ret->boolval);
@@ -710,26 +677,20 @@ void TestEqual_ValidObjFalse(CuTest *tc) {
   int err;
   struct astnode_boolean *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
-  struct astnode_int num2 = {
-    .type = TYPE_INT,
-    .intval = VAL2
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num2,
+    .car = num2,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_equal(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_equal, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_BOOLEAN, ret->type);
   CuAssertIntEquals(tc, 0, (int) ret->boolval);
@@ -740,10 +701,7 @@ void TestEqual_WrongType(CuTest *tc) {
   int err;
   struct astnode_boolean *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
     .car = (struct astnode *) BOOLEAN_FALSE,
@@ -751,18 +709,18 @@ void TestEqual_WrongType(CuTest *tc) {
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_equal(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_equal, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
 void TestIsEq_NullArgs(CuTest *tc) {
   int err;
 
-  err = prmt_is_eq(NULL, NULL);
+  err = prmt_is_eq(NULL, 0, NULL);
   CuAssertIntEquals(tc, EINVAL, err);
 }
 
@@ -771,26 +729,23 @@ void TestIsEq_NoArgs(CuTest *tc) {
   struct astnode_boolean *ret;
   struct astnode_pair *first_pair = EMPTY_LIST;
 
-  err = prmt_is_eq(first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_is_eq, first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
 void TestIsEq_OneArg(CuTest *tc) {
   const int VAL1 = 3;
   int err;
-  struct astnode_int *ret;
+  struct astnode *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) EMPTY_LIST
   };
 
-  err = prmt_is_eq(&first_pair, (struct astnode **)&ret);
+  err = call_prmt(prmt_is_eq, &first_pair, (struct astnode **)&ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
@@ -799,22 +754,19 @@ void TestIsEq_ValidObjTrue(CuTest *tc) {
   int err;
   struct astnode_boolean *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) EMPTY_LIST
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_is_eq(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_is_eq, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_BOOLEAN, ret->type);
   CuAssertIntEquals(tc, 1, (int) ret->boolval);
@@ -825,10 +777,7 @@ void TestIsEq_ValidObjFalse(CuTest *tc) {
   int err;
   struct astnode_boolean *ret;
 
-  struct astnode_int num1 = {
-    .type = TYPE_INT,
-    .intval = VAL1
-  };
+  struct astnode *num1 = make_fixnum(VAL1);
   struct astnode_pair sec_pair = {
     .type = TYPE_PAIR,
     .car = (struct astnode *) BOOLEAN_FALSE,
@@ -836,11 +785,11 @@ void TestIsEq_ValidObjFalse(CuTest *tc) {
   };
   struct astnode_pair first_pair = {
     .type = TYPE_PAIR,
-    .car = (struct astnode *) &num1,
+    .car = num1,
     .cdr = (struct astnode *) &sec_pair
   };
 
-  err = prmt_is_eq(&first_pair, (struct astnode **) &ret);
+  err = call_prmt(prmt_is_eq, &first_pair, (struct astnode **) &ret);
   CuAssertIntEquals(tc, 0, err);
   CuAssertIntEquals(tc, TYPE_BOOLEAN, ret->type);
   CuAssertIntEquals(tc, 0, (int) ret->boolval);
@@ -850,36 +799,278 @@ void TestIsEq_TooManyArgs(CuTest *tc) {
   const int VAL1 = 42;
   const int VAL2 = 56;
   int err;
-  struct astnode_int num1;
-  struct astnode_int num2;
+  struct astnode *num1 = make_fixnum(VAL1);
+  struct astnode *num2 = make_fixnum(VAL2);
   struct astnode_pair first_pair;
   struct astnode_pair sec_pair;
   struct astnode_pair third_pair;
   struct astnode_boolean *ret;
 
-  num1.type = TYPE_INT;
-  num1.intval = VAL1;
-
-  num2.type = TYPE_INT;
-  num2.intval = VAL2;
-
   first_pair.type = TYPE_PAIR;
-  first_pair.car = (struct astnode *) &num1;
+  first_pair.car = num1;
   first_pair.cdr = (struct astnode *) &sec_pair;
 
   sec_pair.type = TYPE_PAIR;
-  sec_pair.car = (struct astnode *) &num2;
+  sec_pair.car = num2;
   sec_pair.cdr = (struct astnode *) &third_pair;
 
   third_pair.type = TYPE_PAIR;
-  third_pair.car = (struct astnode *) &num2;
+  third_pair.car = num2;
   third_pair.cdr = (struct astnode *)EMPTY_LIST;
 
-  err = prmt_is_eq(&first_pair,  (struct astnode **)&ret);
+  err = call_prmt(prmt_is_eq, &first_pair, (struct astnode **)&ret);
   CuAssertIntEquals(tc, EBADMSG, err);
 }
 
 
+// Returns the descriptor of the primitive bound to `name`.
+static const struct prmt_desc *find_desc(CuTest *tc, const char *name)
+{
+  uint32_t i;
+
+  for (i = 0; i < prmt_ndescs; i++)
+    {
+      if (strcmp(prmt_descs[i].name, name) == 0)
+	return &prmt_descs[i];
+    }
+
+  CuFail(tc, "No such primitive");
+  return NULL;
+}
+
+void TestPrmtApply_NullArgs(CuTest *tc) {
+  int err;
+  struct astnode *ret;
+
+  err = prmt_apply(NULL, NULL, 0, NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = prmt_apply(find_desc(tc, "car"), NULL, 1, &ret);
+  CuAssertIntEquals(tc, EINVAL, err);
+}
+
+void TestPrmtApply_Descs(CuTest *tc) {
+  uint32_t i;
+  uint32_t j;
+
+  for (i = 0; i < prmt_ndescs; i++)
+    {
+      CuAssertPtrNotNull(tc, prmt_descs[i].handler);
+      CuAssertTrue(tc, prmt_descs[i].min_args <= prmt_descs[i].max_args);
+      for (j = i + 1; j < prmt_ndescs; j++)
+	CuAssertTrue(tc, strcmp(prmt_descs[i].name, prmt_descs[j].name) != 0);
+    }
+}
+
+void TestPrmtApply_Arity(CuTest *tc) {
+  int err;
+  struct astnode *args[3] = { make_fixnum(1), make_fixnum(2), make_fixnum(3) };
+  struct astnode *ret;
+
+  err = prmt_apply(find_desc(tc, "cons"), args, 1, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  err = prmt_apply(find_desc(tc, "cons"), args, 3, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  err = prmt_apply(find_desc(tc, "-"), args, 0, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  err = prmt_apply(find_desc(tc, "+"), args, 0, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 0, fixnum_val(ret));
+
+  err = prmt_apply(find_desc(tc, "+"), args, 3, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 6, fixnum_val(ret));
+}
+
+void TestPrmtApply_Types(CuTest *tc) {
+  int err;
+  struct astnode_pair pair = {
+    .type = TYPE_PAIR,
+    .car = make_fixnum(1),
+    .cdr = make_fixnum(2)
+  };
+  struct astnode *args[4] = {
+    make_fixnum(1), make_fixnum(2), make_fixnum(3), (struct astnode *) &pair
+  };
+  struct astnode *ret;
+
+  // The type of arguments past the last entry is checked too
+  err = prmt_apply(find_desc(tc, "+"), args, 4, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  err = prmt_apply(find_desc(tc, "car"), args, 1, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  err = prmt_apply(find_desc(tc, "cdr"), &args[3], 1, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 2, fixnum_val(ret));
+
+  // Both operands of the element-wise operations are checked by the table
+  CuAssertIntEquals(tc, PRMT_TYPE(TYPE_NUMVECTOR),
+		    find_desc(tc, "numvector-add")->arg_types[1]);
+  CuAssertIntEquals(tc, PRMT_TYPE(TYPE_NUMVECTOR),
+		    find_desc(tc, "numvector-mul")->arg_types[1]);
+  CuAssertIntEquals(tc, PRMT_TYPE(TYPE_NUMVECTOR),
+		    find_desc(tc, "numvector-dot")->arg_types[1]);
+}
+
+void TestPrmtApply_FixedArity(CuTest *tc) {
+  int err;
+  struct astnode *args[2] = { make_fixnum(1), make_fixnum(2) };
+  struct astnode *empty_list = (struct astnode *) EMPTY_LIST;
+  struct astnode_pair *pair;
+  struct astnode *ret;
+
+  err = prmt_apply(find_desc(tc, "cons"), args, 2, (struct astnode **) &pair);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 1, fixnum_val(pair->car));
+  CuAssertIntEquals(tc, 2, fixnum_val(pair->cdr));
+
+  err = prmt_apply(find_desc(tc, "car"), (struct astnode **) &pair, 1, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 1, fixnum_val(ret));
+
+  err = prmt_apply(find_desc(tc, "eq?"), args, 2, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertTrue(tc, !((struct astnode_boolean *) ret)->boolval);
+
+  // The empty list has the pair type, but neither a car nor a cdr
+  err = prmt_apply(find_desc(tc, "car"), &empty_list, 1, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+  err = prmt_apply(find_desc(tc, "cdr"), &empty_list, 1, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+}
+
+void TestPrmt_Vectors(CuTest *tc) {
+  int err;
+  struct astnode *args[3];
+  struct astnode *vector;
+  struct astnode *ret;
+
+  err = prmt_make_vector(NULL, 0, NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  args[0] = make_fixnum(-1);
+  err = prmt_make_vector(args, 1, &vector);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  // Without a fill, the elements are #f
+  args[0] = make_fixnum(3);
+  err = prmt_make_vector(args, 1, &vector);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_VECTOR, astnode_type_of(vector));
+
+  args[0] = vector;
+  err = prmt_vector_length(args, 1, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 3, fixnum_val(ret));
+
+  args[1] = make_fixnum(2);
+  err = prmt_vector_ref(args, 2, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_FALSE, ret);
+
+  args[2] = make_fixnum(42);
+  err = prmt_vector_set(args, 3, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  err = prmt_vector_ref(args, 2, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 42, fixnum_val(ret));
+
+  // Out of range
+  args[1] = make_fixnum(3);
+  err = prmt_vector_ref(args, 2, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+  err = prmt_vector_set(args, 3, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+  args[1] = make_fixnum(-1);
+  err = prmt_vector_ref(args, 2, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  args[1] = make_fixnum(7);
+  err = prmt_vector_fill(args, 2, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  args[1] = make_fixnum(0);
+  err = prmt_vector_ref(args, 2, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 7, fixnum_val(ret));
+
+  // Not a vector
+  args[0] = make_fixnum(1);
+  err = prmt_vector_length(args, 1, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+}
+
+void TestPrmt_Compare(CuTest *tc) {
+  int err;
+  struct astnode *args[3] = { make_fixnum(1), make_fixnum(2), make_fixnum(3) };
+  struct astnode *ret;
+
+  err = prmt_less(args, 3, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_TRUE, ret);
+  err = prmt_greater(args, 3, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_FALSE, ret);
+
+  // Strict: equal arguments aren't ordered
+  args[2] = make_fixnum(2);
+  err = prmt_less(args, 3, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_FALSE, ret);
+
+  args[0] = make_fixnum(5);
+  err = prmt_greater(args, 2, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_TRUE, ret);
+
+  // Every argument is checked, even past the first unordered pair
+  args[2] = (struct astnode *) EMPTY_LIST;
+  err = prmt_less(args, 3, &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+}
+
+void TestPrmt_CanonicalBooleans(CuTest *tc) {
+  int err;
+  struct astnode *args[2] = { make_fixnum(1), make_fixnum(1) };
+  struct astnode *empty_lists[2] = {
+    (struct astnode *) EMPTY_LIST, (struct astnode *) EMPTY_LIST
+  };
+  struct astnode *ret;
+  struct gc_stats before;
+  struct gc_stats after;
+
+  gc_get_stats(&before);
+
+  err = prmt_equal(args, 2, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_TRUE, ret);
+
+  args[1] = make_fixnum(2);
+  err = prmt_equal(args, 2, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_FALSE, ret);
+
+  err = prmt_is_eq(args, 2, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_FALSE, ret);
+
+  err = prmt_is_eq(empty_lists, 2, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_TRUE, ret);
+
+  err = prmt_is_pair(empty_lists, 1, &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_FALSE, ret);
+
+  // Comparisons don't allocate
+  gc_get_stats(&after);
+  CuAssertIntEquals(tc, before.nallocs, after.nallocs);
+}
+
 CuSuite* PrmtGetSuite() {
   CuSuite* suite = CuSuiteNew();
 
@@ -919,6 +1110,7 @@ CuSuite* PrmtGetSuite() {
   SUITE_ADD_TEST(suite, TestDiv_NoArgs);
   SUITE_ADD_TEST(suite, TestDiv_ValidObj);
   SUITE_ADD_TEST(suite, TestDiv_OneArg);
+  SUITE_ADD_TEST(suite, TestDiv_ZeroAndOverflow);
   SUITE_ADD_TEST(suite, TestEqual_NullArgs);
   SUITE_ADD_TEST(suite, TestEqual_NoArgs);
   SUITE_ADD_TEST(suite, TestEqual_ValidObjTrue);
@@ -930,6 +1122,14 @@ CuSuite* PrmtGetSuite() {
   SUITE_ADD_TEST(suite, TestIsEq_ValidObjTrue);
   SUITE_ADD_TEST(suite, TestIsEq_ValidObjFalse);
   SUITE_ADD_TEST(suite, TestIsEq_TooManyArgs);
+  SUITE_ADD_TEST(suite, TestPrmt_Vectors);
+  SUITE_ADD_TEST(suite, TestPrmt_Compare);
+  SUITE_ADD_TEST(suite, TestPrmt_CanonicalBooleans);
+  SUITE_ADD_TEST(suite, TestPrmtApply_NullArgs);
+  SUITE_ADD_TEST(suite, TestPrmtApply_Descs);
+  SUITE_ADD_TEST(suite, TestPrmtApply_Arity);
+  SUITE_ADD_TEST(suite, TestPrmtApply_Types);
+  SUITE_ADD_TEST(suite, TestPrmtApply_FixedArity);
 
   return suite;
 }
@@ -0,0 +1,333 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tests/CuTest.h"
+#include "inc/ast.h"
+#include "inc/env.h"
+#include "inc/eval.h"
+#include "inc/gc.h"
+#include "inc/reader.h"
+#include "inc/symbols.h"
+#include "tests/testhelpers.h"
+
+// Reads the only datum of `src`.
+static int read_str(const char *src, struct astnode **ret)
+{
+  struct reader reader;
+  struct astnode *end;
+  int err;
+
+  reader_init(&reader, src, strlen(src));
+  err = reader_next(&reader, ret);
+  if (err != 0)
+    return err;
+  err = reader_next(&reader, &end);
+  if (err == 0 && end != NULL)
+    return E2BIG;
+
+  return err;
+}
+
+static void assert_sym(CuTest *tc, const char *name, struct astnode *node)
+{
+  const char *symval;
+  int err;
+
+  CuAssertIntEquals(tc, TYPE_SYM, astnode_type_of(node));
+  err = getsym(((struct astnode_sym *) node)->symi, &symval);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertStrEquals(tc, name, symval);
+}
+
+static struct astnode *car(struct astnode *node)
+{
+  return ((struct astnode_pair *) node)->car;
+}
+
+static struct astnode *cdr(struct astnode *node)
+{
+  return ((struct astnode_pair *) node)->cdr;
+}
+
+void TestReader_Atoms(CuTest *tc) {
+  struct astnode *node;
+  int err;
+
+  err = read_str("  42 ", &node);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 42, fixnum_val(node));
+
+  err = read_str("-2147483648", &node);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertTrue(tc, fixnum_val(node) == INT32_MIN);
+  err = read_str("2147483648", &node);
+  CuAssertIntEquals(tc, EOVERFLOW, err);
+
+  err = read_str("#t", &node);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_TRUE, node);
+  err = read_str("#f", &node);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_FALSE, node);
+
+  err = read_str("vector-set!", &node);
+  CuAssertIntEquals(tc, 0, err);
+  assert_sym(tc, "vector-set!", node);
+  err = read_str("-", &node);
+  CuAssertIntEquals(tc, 0, err);
+  assert_sym(tc, "-", node);
+  err = read_str("s32vector", &node);
+  CuAssertIntEquals(tc, 0, err);
+  assert_sym(tc, "s32vector", node);
+
+  // Symbols can't start with a digit
+  err = read_str("1fn", &node);
+  CuAssertIntEquals(tc, EBADMSG, err);
+  err = read_str("#x", &node);
+  CuAssertIntEquals(tc, EBADMSG, err);
+  err = read_str("a.b", &node);
+  CuAssertIntEquals(tc, EBADMSG, err);
+}
+
+void TestReader_Lists(CuTest *tc) {
+  struct astnode *node;
+  int err;
+
+  err = read_str("()", &node);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, EMPTY_LIST, node);
+
+  err = read_str("(a (1 #f) ())", &node);
+  CuAssertIntEquals(tc, 0, err);
+  assert_sym(tc, "a", car(node));
+  CuAssertIntEquals(tc, 1, fixnum_val(car(car(cdr(node)))));
+  CuAssertPtrEquals(tc, BOOLEAN_FALSE, car(cdr(car(cdr(node)))));
+  CuAssertPtrEquals(tc, EMPTY_LIST, car(cdr(cdr(node))));
+  CuAssertPtrEquals(tc, EMPTY_LIST, cdr(cdr(cdr(node))));
+
+  err = read_str("(1 2 . 3)", &node);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 2, fixnum_val(car(cdr(node))));
+  CuAssertIntEquals(tc, 3, fixnum_val(cdr(cdr(node))));
+
+  err = read_str("'(x)", &node);
+  CuAssertIntEquals(tc, 0, err);
+  assert_sym(tc, "quote", car(node));
+  assert_sym(tc, "x", car(car(cdr(node))));
+  CuAssertPtrEquals(tc, EMPTY_LIST, cdr(cdr(node)));
+
+  err = read_str("(1 2", &node);
+  CuAssertIntEquals(tc, EBADMSG, err);
+  err = read_str(")", &node);
+  CuAssertIntEquals(tc, EBADMSG, err);
+  err = read_str("(. 1)", &node);
+  CuAssertIntEquals(tc, EBADMSG, err);
+  err = read_str("(1 . 2 3)", &node);
+  CuAssertIntEquals(tc, EBADMSG, err);
+  err = read_str("'", &node);
+  CuAssertIntEquals(tc, EBADMSG, err);
+}
+
+// Returns a datum of `depth` nested lists (or quotes if `quotes`), which
+// must be freed.
+static char *make_nested(CuTest *tc, size_t depth, bool quotes)
+{
+  char *src;
+
+  src = malloc(2 * depth + 2);
+  CuAssertPtrNotNull(tc, src);
+  if (quotes)
+    {
+      memset(src, '\'', depth);
+      strcpy(src + depth, "x");
+    }
+  else
+    {
+      memset(src, '(', depth);
+      memset(src + depth, ')', depth);
+      src[2 * depth] = '\0';
+    }
+
+  return src;
+}
+
+void TestReader_MaxDepth(CuTest *tc) {
+  static const size_t depths[] = { 1000000, READER_MAX_DEPTH + 1 };
+  struct astnode *node;
+  char *src;
+  size_t i;
+  int err;
+
+  src = make_nested(tc, READER_MAX_DEPTH, false);
+  err = read_str(src, &node);
+  free(src);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_PAIR, astnode_type_of(node));
+
+  src = make_nested(tc, READER_MAX_DEPTH, true);
+  err = read_str(src, &node);
+  free(src);
+  CuAssertIntEquals(tc, 0, err);
+
+  for (i = 0; i < sizeof(depths) / sizeof(depths[0]); i++)
+    {
+      src = make_nested(tc, depths[i], false);
+      err = read_str(src, &node);
+      free(src);
+      CuAssertIntEquals(tc, ENOMEM, err);
+
+      src = make_nested(tc, depths[i], true);
+      err = read_str(src, &node);
+      free(src);
+      CuAssertIntEquals(tc, ENOMEM, err);
+    }
+}
+
+void TestReader_CommentsAndLines(CuTest *tc) {
+  const char *src = "; header\n(a ; inline\n b)\n\n; trailer";
+  struct reader reader;
+  struct astnode *node;
+  int err;
+
+  reader_init(&reader, src, strlen(src));
+  err = reader_next(&reader, &node);
+  CuAssertIntEquals(tc, 0, err);
+  assert_sym(tc, "b", car(cdr(node)));
+  CuAssertIntEquals(tc, 3, reader.line);
+
+  err = reader_next(&reader, &node);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, NULL, node);
+  CuAssertIntEquals(tc, 5, reader.line);
+
+  src = "(a)\n(b\n  #z)";
+  reader_init(&reader, src, strlen(src));
+  err = reader_next(&reader, &node);
+  CuAssertIntEquals(tc, 0, err);
+  err = reader_next(&reader, &node);
+  CuAssertIntEquals(tc, EBADMSG, err);
+  CuAssertIntEquals(tc, 3, reader.line);
+}
+
+// Reads a file big enough for collections to run while its list is built.
+void TestReader_OpenFile(CuTest *tc) {
+  char path[] = "/tmp/readertestsXXXXXX";
+  struct reader reader;
+  struct astnode *node;
+  struct astnode *list;
+  FILE *file;
+  int64_t len;
+  int err;
+  int fd;
+  int i;
+
+  err = reader_open(&reader, "/nonexistent/file.scm");
+  CuAssertIntEquals(tc, ENOENT, err);
+
+  fd = mkstemp(path);
+  CuAssertTrue(tc, fd >= 0);
+  err = reader_open(&reader, path);
+  CuAssertIntEquals(tc, 0, err);
+  err = reader_next(&reader, &node);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, NULL, node);
+  reader_close(&reader);
+
+  file = fdopen(fd, "w");
+  CuAssertPtrNotNull(tc, file);
+  fprintf(file, "(");
+  for (i = 0; i < 200000; i++)
+    fprintf(file, "(elt %d)\n", i);
+  fprintf(file, ") last");
+  fclose(file);
+
+  err = reader_open(&reader, path);
+  unlink(path);
+  CuAssertIntEquals(tc, 0, err);
+  err = reader_next(&reader, &list);
+  CuAssertIntEquals(tc, 0, err);
+  len = list_length(list);
+  CuAssertTrue(tc, len == 200000);
+  for (i = 0, node = list; i < 200000; i++, node = cdr(node))
+    {
+      assert_sym(tc, "elt", car(car(node)));
+      CuAssertIntEquals(tc, i, fixnum_val(car(cdr(car(node)))));
+    }
+  err = reader_next(&reader, &node);
+  CuAssertIntEquals(tc, 0, err);
+  assert_sym(tc, "last", node);
+  reader_close(&reader);
+}
+
+// Reading and evaluating top-level forms one at a time, as the REPL and
+// scripts do, must not leave their parse trees behind: only the quoted list
+// and the body of the last definition of f stay reachable.
+void TestReader_TreesAreReclaimed(CuTest *tc) {
+  const char *src = "(define (f x) (cons x '(a b c))) (f (+ 1 2)) (f #t)";
+  enum eval_mode saved_mode = eval_mode;
+  struct astnode_env *env;
+  struct gc_stats before;
+  struct gc_stats after;
+  struct reader reader;
+  struct astnode *exp;
+  struct astnode *val;
+  size_t i;
+  int round;
+  int err;
+
+  for (i = 0; i < ntest_modes; i++)
+    {
+      eval_mode = test_modes[i];
+      err = make_top_level_env(&env);
+      CuAssertIntEquals(tc, 0, err);
+
+      for (round = 0; round < 5000; round++)
+	{
+	  if (round == 100)
+	    {
+	      err = gc_collect();
+	      CuAssertIntEquals(tc, 0, err);
+	      gc_get_stats(&before);
+	    }
+
+	  reader_init(&reader, src, strlen(src));
+	  for (;;)
+	    {
+	      err = reader_next(&reader, &exp);
+	      CuAssertIntEquals(tc, 0, err);
+	      if (exp == NULL)
+		break;
+	      err = eval(exp, env, &val);
+	      CuAssertIntEquals(tc, 0, err);
+	    }
+	}
+      exp = NULL;
+      val = NULL;
+
+      err = gc_collect();
+      CuAssertIntEquals(tc, 0, err);
+      gc_get_stats(&after);
+      // Each round reads about 30 nodes: keeping them would take 4 MiB.
+      CuAssertTrue(tc, after.bytes_in_use < before.bytes_in_use + (64 << 10));
+    }
+
+  eval_mode = saved_mode;
+}
+
+CuSuite* ReaderGetSuite() {
+  CuSuite* suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, TestReader_Atoms);
+  SUITE_ADD_TEST(suite, TestReader_Lists);
+  SUITE_ADD_TEST(suite, TestReader_MaxDepth);
+  SUITE_ADD_TEST(suite, TestReader_CommentsAndLines);
+  SUITE_ADD_TEST(suite, TestReader_OpenFile);
+  SUITE_ADD_TEST(suite, TestReader_TreesAreReclaimed);
+
+  return suite;
+}
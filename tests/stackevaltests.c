@@ -0,0 +1,114 @@
+#include <errno.h>
+#include <stddef.h>
+
+#include "tests/CuTest.h"
+#include "inc/ast.h"
+#include "inc/env.h"
+#include "inc/eval.h"
+#include "inc/stackeval.h"
+#include "tests/testhelpers.h"
+
+void TestStackeval_NullArgs(CuTest *tc) {
+  int err;
+  struct astnode_env *env;
+  struct astnode *ret;
+
+  err = make_top_level_env(&env);
+  CuAssertIntEquals(tc, 0, err);
+
+  err = stackeval(NULL, env, &ret);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = stackeval(make_fixnum(1), NULL, &ret);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = stackeval(make_fixnum(1), env, NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+}
+
+void TestStackeval_DeepRecursion(CuTest *tc) {
+  int err;
+  struct astnode *ret;
+
+  // Far deeper than the C stack would allow if every call recursed
+  err = eval_str_in_mode(tc, EVAL_MODE_STACK,
+			 "(define (count n) (if (= n 0) 0 (+ 1 (count (- n 1)))))"
+			 "(count 200000)",
+			 &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+  CuAssertIntEquals(tc, 200000, fixnum_val(ret));
+}
+
+void TestStackeval_TailCallsInConstantStack(CuTest *tc) {
+  int err;
+  size_t saved_max;
+  struct astnode *ret;
+
+  // A loop in tail position needs no more stack than a single iteration
+  saved_max = stackeval_max_bytes;
+  stackeval_max_bytes = 64 * 1024;
+  err = eval_str_in_mode(tc, EVAL_MODE_STACK,
+			 "(define (even? n) (if (= n 0) #t (odd? (- n 1))))"
+			 "(define (odd? n) (if (= n 0) #f (even? (- n 1))))"
+			 "(define (f) (even? 1) (even? 100001))"
+			 "(f)",
+			 &ret);
+  stackeval_max_bytes = saved_max;
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, BOOLEAN_FALSE, ret);
+}
+
+void TestStackeval_Limit(CuTest *tc) {
+  int err;
+  size_t saved_max;
+  struct astnode *ret;
+
+  saved_max = stackeval_max_bytes;
+  stackeval_max_bytes = 64 * 1024;
+  err = eval_str_in_mode(tc, EVAL_MODE_STACK,
+			 "(define (count n) (if (= n 0) 0 (+ 1 (count (- n 1)))))"
+			 "(count 200000)",
+			 &ret);
+  stackeval_max_bytes = saved_max;
+  CuAssertIntEquals(tc, ENOMEM, err);
+
+  // The stack is left as it was, and usable again
+  err = eval_str_in_mode(tc, EVAL_MODE_STACK,
+			 "(define (count n) (if (= n 0) 0 (+ 1 (count (- n 1)))))"
+			 "(count 1000)",
+			 &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 1000, fixnum_val(ret));
+}
+
+void TestStackeval_SpecialForms(CuTest *tc) {
+  int err;
+  struct astnode *ret;
+
+  err = eval_str_in_mode(tc, EVAL_MODE_STACK,
+			 "(define x (if #f 1 2))"
+			 "(define (f) (define y (* x 10)) (quote ignored) y)"
+			 "(+ ((lambda (a b) (- a b)) (f) x) (car (quote (3))))",
+			 &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 21, fixnum_val(ret));
+
+  err = eval_str_in_mode(tc, EVAL_MODE_STACK, "(if #t 1)", &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+
+  err = eval_str_in_mode(tc, EVAL_MODE_STACK, "(car 1 2)", &ret);
+  CuAssertIntEquals(tc, EBADMSG, err);
+}
+
+CuSuite* StackevalGetSuite() {
+  CuSuite* suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, TestStackeval_NullArgs);
+  SUITE_ADD_TEST(suite, TestStackeval_DeepRecursion);
+  SUITE_ADD_TEST(suite, TestStackeval_TailCallsInConstantStack);
+  SUITE_ADD_TEST(suite, TestStackeval_Limit);
+  SUITE_ADD_TEST(suite, TestStackeval_SpecialForms);
+
+  return suite;
+}
@@ -8,7 +8,7 @@
 
 void TestPutSym_StartGtEnd(CuTest *tc) {
   char dummybuf[] = "TestPutSym_StartGtEnd";
-  void *index;
+  uint32_t index;
   int err;
 
   err = putsym(&dummybuf[4], dummybuf, &index);
@@ -20,7 +20,7 @@ void TestPutSym_StartGtEnd(CuTest *tc) {
 
 void TestPutSym_StartEqEnd(CuTest *tc) {
   char dummybuf[] = "TestPutSym_StartEqEnd";
-  void *index;
+  uint32_t index;
   int err;
 
   err = putsym(dummybuf, dummybuf, &index);
@@ -32,7 +32,7 @@ void TestPutSym_StartEqEnd(CuTest *tc) {
 
 void TestPutSym_StartEndNull(CuTest *tc) {
   char dummybuf[] = "TestPutSym_StartEndNull";
-  void *index;
+  uint32_t index;
   int err;
 
   err = putsym(NULL, dummybuf, &index);
@@ -48,7 +48,7 @@ void TestPutSym_StartEndNull(CuTest *tc) {
 
 void TestPutSym_BufNoChange(CuTest *tc) {
   char dummybuf[] = "TestPutSym_BufNoChange";
-  void *index;
+  uint32_t index;
   int err;
 
   err = putsym(dummybuf, dummybuf + strlen(dummybuf) - 1, &index);
@@ -72,7 +72,7 @@ void TestPutSym_NullIndex(CuTest *tc) {
 void TestPutSym_AndGet(CuTest *tc) {
   char sym[] = "TestPutSym_AndGet";
   const char *retrieved_sym;
-  void *putindex;
+  uint32_t putindex;
   int err;
 
   err = putsym(sym, sym + strlen(sym) - 1, &putindex);
@@ -88,8 +88,8 @@ void TestPutSym_TwiceAndGetSameVal(CuTest *tc) {
   char sym[] = "TestPutSym_TwiceAndGetSameVal";
   const char *getsym1;
   const char *getsym2;
-  void *putindex1;
-  void *putindex2;
+  uint32_t putindex1;
+  uint32_t putindex2;
   int err;
 
   err = putsym(sym, sym + strlen(sym) - 1, &putindex1);
@@ -104,7 +104,7 @@ void TestPutSym_TwiceAndGetSameVal(CuTest *tc) {
   err = getsym(putindex2, &getsym2);
   CuAssertIntEquals(tc, 0, err);
 
-  CuAssertPtrEquals_Msg(tc, "Putting same symbol twice and getting should give "
+  CuAssertIntEquals_Msg(tc, "Putting same symbol twice and getting should give "
 			"same index", putindex1, putindex2);
   CuAssertStrEquals(tc, sym, getsym1);
   CuAssertStrEquals(tc, sym, getsym2);
@@ -115,8 +115,8 @@ void TestPutSym_TwiceAndGetSameVal(CuTest *tc) {
 void TestPutSym_OffByOneCheck1(CuTest *tc) {
   char sym1[] = "z";
   char sym2[] = "zz";
-  void *index1;
-  void *index2;
+  uint32_t index1;
+  uint32_t index2;
   int err;
 
   err = putsym(sym1, sym1 + strlen(sym1) - 1, &index1);
@@ -125,18 +125,15 @@ void TestPutSym_OffByOneCheck1(CuTest *tc) {
   err = putsym(sym2, sym2 + strlen(sym2) - 1, &index2);
   CuAssertIntEquals(tc, 0, err);
 
-  // Work around CuTest not having "CuAssertPtrNotEquals"
-  if (index1 == index2)
-    index1 = NULL;
-  CuAssertPtrNotNullMsg(tc, "\"z\" and \"zz\" were treated as the same symbol",
-			index1);
+  CuAssert(tc, "\"z\" and \"zz\" were treated as the same symbol",
+	   index1 != index2);
 }
 
 void TestPutSym_OffByOneCheck2(CuTest *tc) {
   char sym1[] = "a";
   char sym2[] = "aa";
-  void *index1;
-  void *index2;
+  uint32_t index1;
+  uint32_t index2;
   int err;
 
   err = putsym(sym2, sym2 + strlen(sym2) - 1, &index2);
@@ -145,21 +142,17 @@ void TestPutSym_OffByOneCheck2(CuTest *tc) {
   err = putsym(sym1, sym1 + strlen(sym1) - 1, &index1);
   CuAssertIntEquals(tc, 0, err);
 
-  // Work around CuTest not having "CuAssertPtrNotEquals"
-  if (index1 == index2)
-    index1 = NULL;
-  CuAssertPtrNotNullMsg(tc, "\"a\" and \"aa\" were treated as the same symbol",
-			index1);
+  CuAssert(tc, "\"a\" and \"aa\" were treated as the same symbol",
+	   index1 != index2);
 }
 
 void TestGetSym_InvalidIndex(CuTest *tc) {
-  char dummyvar;
   const char *inexistant_sym;
   int err;
 
-  // An index pointer should never point in our stack, so it's safe to assume
-  // &dummyvar is an invalid index.
-  err = getsym((void *)&dummyvar, &inexistant_sym);
+  // Indexes are dense, and we never come close to interning UINT32_MAX
+  // symbols, so it's safe to assume UINT32_MAX is an invalid index.
+  err = getsym(UINT32_MAX, &inexistant_sym);
   CuAssertIntEquals(tc, EINVAL, err);
 }
 
@@ -177,7 +170,7 @@ void TestPutSym_SecondPageAndGet(CuTest *tc) {
   char buf[BUFSIZE];
   int i;
   int err;
-  void *index;
+  uint32_t index;
 
   memset(buf, ' ', BUFSIZE);
 
@@ -205,6 +198,113 @@ void TestPutSym_SecondPageAndGet(CuTest *tc) {
   #undef BUFSIZE
 }
 
+void TestPutSym_ManyAndPutAgain(CuTest *tc) {
+  #define NSYMS 2000
+  static uint32_t indexes[NSYMS];
+  char buf[] = "TestPutSym_ManyAndPutAgain-xx";
+  size_t len = strlen(buf);
+  uint32_t index;
+  int i;
+  int err;
+
+  // Enough symbols to resize the intern table a few times.
+  for (i = 0; i < NSYMS; i++)
+    {
+      buf[len - 2] = 'A' + i / 50;
+      buf[len - 1] = 'A' + i % 50;
+      err = putsym(buf, buf + len - 1, &indexes[i]);
+      CuAssertIntEquals(tc, 0, err);
+    }
+
+  for (i = 0; i < NSYMS; i++)
+    {
+      buf[len - 2] = 'A' + i / 50;
+      buf[len - 1] = 'A' + i % 50;
+      err = putsym(buf, buf + len - 1, &index);
+      CuAssertIntEquals(tc, 0, err);
+      CuAssertIntEquals(tc, indexes[i], index);
+    }
+
+  #undef NSYMS
+}
+
+// The symbol table used to be capped at 10 pages of symbols.
+void TestPutSym_NoCapAndDenseIndexes(CuTest *tc) {
+  #define NSYMS 20000
+  char buf[] = "TestPutSym_NoCapAndDenseIndexes-xxx";
+  size_t len = strlen(buf);
+  const char *symval;
+  uint32_t first;
+  uint32_t index;
+  int i;
+  int err;
+
+  for (i = 0; i < NSYMS; i++)
+    {
+      buf[len - 3] = 'A' + i / 2500;
+      buf[len - 2] = 'A' + i / 50 % 50;
+      buf[len - 1] = 'A' + i % 50;
+      err = putsym(buf, buf + len - 1, &index);
+      CuAssertIntEquals(tc, 0, err);
+
+      if (i == 0)
+	first = index;
+      else
+	CuAssertIntEquals(tc, first + i, index);
+    }
+
+  err = getsym(index, &symval);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertStrEquals(tc, buf, symval);
+
+  #undef NSYMS
+}
+
+// Names written by write_symbols can be loaded back: the table is a prefix of
+// them, so only the names appended after it are interned.
+void TestLoadSymbols_AppendsNewNames(CuTest *tc) {
+  static char extra[] = "loadsyms_new1\0loadsyms_new2";
+  const char *symval;
+  char *names;
+  size_t names_size;
+  size_t size;
+  uint32_t index;
+  uint32_t n;
+  FILE *file;
+  int err;
+
+  file = open_memstream(&names, &names_size);
+  CuAssertPtrNotNull(tc, file);
+  err = write_symbols(file, &n, &size);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 0, fwrite(extra, 1, sizeof(extra), file) !=
+		    sizeof(extra));
+  CuAssertIntEquals(tc, 0, fclose(file));
+
+  // Truncated, or not as many names as claimed
+  err = load_symbols(names, size + sizeof(extra) - 1, n + 2);
+  CuAssertIntEquals(tc, EINVAL, err);
+  err = load_symbols(names, size + sizeof(extra), n + 3);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  err = load_symbols(names, size + sizeof(extra), n + 2);
+  CuAssertIntEquals(tc, 0, err);
+  err = getsym(n + 1, &symval);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertStrEquals(tc, "loadsyms_new2", symval);
+  CuAssertPtrEquals(tc, names + size + strlen(extra) + 1, (char *) symval);
+  err = putsym(extra, extra + strlen(extra) - 1, &index);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, n, index);
+
+  // The first names don't match the table anymore
+  names[0] = names[0] == 'x' ? 'y' : 'x';
+  err = load_symbols(names, size + sizeof(extra), n + 2);
+  CuAssertIntEquals(tc, EBUSY, err);
+
+  // `names` is used by the table now, so it's never freed.
+}
+
 CuSuite* SymbolsGetSuite() {
   CuSuite* suite = CuSuiteNew();
 
@@ -220,6 +320,9 @@ CuSuite* SymbolsGetSuite() {
   SUITE_ADD_TEST(suite, TestGetSym_InvalidIndex);
   SUITE_ADD_TEST(suite, TestGetSym_NullSymval);
   SUITE_ADD_TEST(suite, TestPutSym_SecondPageAndGet);
+  SUITE_ADD_TEST(suite, TestPutSym_ManyAndPutAgain);
+  SUITE_ADD_TEST(suite, TestPutSym_NoCapAndDenseIndexes);
+  SUITE_ADD_TEST(suite, TestLoadSymbols_AppendsNewNames);
 
   return suite;
 }
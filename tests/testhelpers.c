@@ -0,0 +1,151 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tests/CuTest.h"
+#include "tests/testhelpers.h"
+#include "inc/ast.h"
+#include "inc/eval.h"
+#include "inc/gc.h"
+#include "inc/symbols.h"
+
+struct astnode *make_sym(CuTest *tc, char *name)
+{
+  int err;
+  struct astnode_sym *node;
+
+  err = alloc_astnode(TYPE_SYM, (struct astnode **) &node);
+  CuAssertIntEquals(tc, 0, err);
+  err = putsym(name, name + strlen(name) - 1, &node->symi);
+  CuAssertIntEquals(tc, 0, err);
+
+  return (struct astnode *) node;
+}
+
+struct astnode *make_list(CuTest *tc, int n, ...)
+{
+  int err;
+  int i;
+  va_list elems;
+  struct astnode *head;
+  struct astnode **tail;
+
+  head = (struct astnode *) EMPTY_LIST;
+  tail = &head;
+
+  va_start(elems, n);
+  for (i = 0; i < n; i++)
+    {
+      struct astnode_pair *pair;
+
+      err = alloc_astnode(TYPE_PAIR, (struct astnode **) &pair);
+      CuAssertIntEquals(tc, 0, err);
+      pair->car = va_arg(elems, struct astnode *);
+      pair->cdr = (struct astnode *) EMPTY_LIST;
+      *tail = (struct astnode *) pair;
+      tail = &pair->cdr;
+    }
+  va_end(elems);
+
+  return head;
+}
+
+static void skip_spaces(const char **src)
+{
+  while (**src == ' ' || **src == '\n' || **src == '\t')
+    (*src)++;
+}
+
+static struct astnode *read_next(CuTest *tc, const char **src)
+{
+  const char *start;
+  char buffer[64];
+  size_t len;
+  int err;
+
+  skip_spaces(src);
+
+  if (**src == '(')
+    {
+      struct astnode *head;
+      struct astnode **tail;
+
+      (*src)++;
+      head = (struct astnode *) EMPTY_LIST;
+      tail = &head;
+      for (skip_spaces(src); **src != ')'; skip_spaces(src))
+	{
+	  struct astnode_pair *pair;
+
+	  CuAssertTrue(tc, **src != '\0');
+	  err = alloc_astnode(TYPE_PAIR, (struct astnode **) &pair);
+	  CuAssertIntEquals(tc, 0, err);
+	  pair->cdr = (struct astnode *) EMPTY_LIST;
+	  *tail = (struct astnode *) pair;
+	  tail = &pair->cdr;
+	  pair->car = read_next(tc, src);
+	}
+      (*src)++;
+
+      return head;
+    }
+
+  start = *src;
+  while (**src != '\0' && **src != ' ' && **src != '\n' && **src != '\t' &&
+	 **src != '(' && **src != ')')
+    (*src)++;
+  len = *src - start;
+  CuAssertTrue(tc, len > 0 && len < sizeof(buffer));
+  memcpy(buffer, start, len);
+  buffer[len] = '\0';
+
+  if ((buffer[0] >= '0' && buffer[0] <= '9') ||
+      (buffer[0] == '-' && len > 1))
+    return make_fixnum(atoi(buffer));
+
+  if (strcmp(buffer, "#t") == 0 || strcmp(buffer, "#f") == 0)
+    return make_boolean(buffer[1] == 't');
+
+  return make_sym(tc, buffer);
+}
+
+const enum eval_mode test_modes[] = {
+  EVAL_MODE_AST,
+  EVAL_MODE_BYTECODE,
+  EVAL_MODE_ANALYZE,
+  EVAL_MODE_STACK,
+};
+const size_t ntest_modes = sizeof(test_modes) / sizeof(test_modes[0]);
+
+int eval_str(CuTest *tc, const char *src, struct astnode_env *env,
+	     struct astnode **ret)
+{
+  int err;
+
+  for (skip_spaces(&src); *src != '\0'; skip_spaces(&src))
+    {
+      err = eval(read_next(tc, &src), env, ret);
+      if (err != 0)
+	return err;
+    }
+
+  return 0;
+}
+
+int eval_str_in_mode(CuTest *tc, enum eval_mode mode, const char *src,
+		     struct astnode **ret)
+{
+  enum eval_mode saved_mode;
+  struct astnode_env *env;
+  int err;
+
+  err = make_top_level_env(&env);
+  CuAssertIntEquals(tc, 0, err);
+
+  saved_mode = eval_mode;
+  eval_mode = mode;
+  err = eval_str(tc, src, env, ret);
+  eval_mode = saved_mode;
+
+  return err;
+}
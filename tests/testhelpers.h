@@ -0,0 +1,33 @@
+#ifndef TESTHELPERS_H
+#define TESTHELPERS_H
+
+#include "tests/CuTest.h"
+#include "inc/ast.h"
+#include "inc/eval.h"
+
+// Helpers to build expressions on the gc heap. They fail the test on error.
+
+// Returns a new symbol node for `name`.
+struct astnode *make_sym(CuTest *tc, char *name);
+
+// Returns a proper list of the `n` nodes that follow.
+struct astnode *make_list(CuTest *tc, int n, ...);
+
+// Evaluates in `env`, one after the other, the expressions written in `src`,
+// and places the value of the last one in `ret`. The syntax is limited to
+// lists, integers, booleans and symbols.
+// Possible errors:
+// See eval.
+int eval_str(CuTest *tc, const char *src, struct astnode_env *env,
+	     struct astnode **ret);
+
+// Every evaluation mode, for tests that check that they all agree: loop with
+// `for (i = 0; i < ntest_modes; i++)` over test_modes[i].
+extern const enum eval_mode test_modes[];
+extern const size_t ntest_modes;
+
+// Like eval_str, in a new top-level environment, with eval_mode set to `mode`.
+int eval_str_in_mode(CuTest *tc, enum eval_mode mode, const char *src,
+		     struct astnode **ret);
+
+#endif
@@ -0,0 +1,180 @@
+#include <errno.h>
+#include <stddef.h>
+
+#include "tests/CuTest.h"
+#include "inc/ast.h"
+#include "inc/env.h"
+#include "inc/eval.h"
+#include "inc/symbols.h"
+#include "inc/vm.h"
+#include "tests/testhelpers.h"
+
+// Every test runs its program in each mode, each time in a fresh top-level
+// environment, and checks that they all give the same result.
+static void assert_int_result(CuTest *tc, const char *src, int expected)
+{
+  struct astnode *ret;
+  size_t i;
+  int err;
+
+  for (i = 0; i < ntest_modes; i++)
+    {
+      err = eval_str_in_mode(tc, test_modes[i], src, &ret);
+      CuAssertIntEquals(tc, 0, err);
+      CuAssertIntEquals(tc, TYPE_INT, astnode_type_of(ret));
+      CuAssertIntEquals(tc, expected, fixnum_val(ret));
+    }
+}
+
+void TestVm_NullArgs(CuTest *tc) {
+  int err;
+  struct astnode_compproc proc = {
+    .type = TYPE_COMPPROC,
+    .code = NULL
+  };
+  struct astnode *ret;
+
+  err = vm_apply(NULL, NULL, 0, NULL);
+  CuAssertIntEquals(tc, EINVAL, err);
+
+  // Procedures that were not compiled can't run on the VM
+  err = vm_apply(&proc, NULL, 0, &ret);
+  CuAssertIntEquals(tc, EINVAL, err);
+}
+
+void TestVm_CompilesTopLevelProcs(CuTest *tc) {
+  int err;
+  struct astnode *ret;
+
+  err = eval_str_in_mode(tc, EVAL_MODE_BYTECODE, "(define (id x) x)",
+			 &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, TYPE_COMPPROC, astnode_type_of(ret));
+  CuAssertTrue(tc, ((struct astnode_compproc *) ret)->code != NULL);
+
+  err = eval_str_in_mode(tc, EVAL_MODE_AST, "(define (id x) x)", &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertPtrEquals(tc, NULL, ((struct astnode_compproc *) ret)->code);
+}
+
+void TestVm_Recursion(CuTest *tc) {
+  assert_int_result(tc,
+		    "(define (fact n) (if (= n 0) 1 (* n (fact (- n 1)))))"
+		    "(fact 10)",
+		    3628800);
+}
+
+void TestVm_TailCalls(CuTest *tc) {
+  assert_int_result(tc,
+		    "(define (loop n acc)"
+		    "  (if (= n 0) acc (loop (- n 1) (+ acc 1))))"
+		    "(loop 100000 0)",
+		    100000);
+}
+
+void TestVm_DeepRecursion(CuTest *tc) {
+  // Calls between compiled procedures don't use the C stack
+  int err;
+  struct astnode *ret;
+
+  err = eval_str_in_mode(tc, EVAL_MODE_BYTECODE,
+			 "(define (sum n) (if (= n 0) 0 (+ n (sum (- n 1)))))"
+			 "(sum 50000)",
+			 &ret);
+  CuAssertIntEquals(tc, 0, err);
+  CuAssertIntEquals(tc, 1250025000, fixnum_val(ret));
+}
+
+void TestVm_Closures(CuTest *tc) {
+  assert_int_result(tc,
+		    "(define (make-adder a) (lambda (b) (+ a b)))"
+		    "(define add3 (make-adder 3))"
+		    "(add3 4)",
+		    7);
+}
+
+void TestVm_InternalDefines(CuTest *tc) {
+  assert_int_result(tc,
+		    "(define (f x)"
+		    "  (define y (+ x 1))"
+		    "  (define (g z) (* y z))"
+		    "  (g 2))"
+		    "(f 4)",
+		    10);
+}
+
+void TestVm_QuoteAndPrimitives(CuTest *tc) {
+  assert_int_result(tc,
+		    "(define (second ls) (car (cdr ls)))"
+		    "(define (f) (second (quote (1 2 3))))"
+		    "(f)",
+		    2);
+}
+
+void TestVm_ShadowedKeyword(CuTest *tc) {
+  // `if` is an ordinary parameter here
+  assert_int_result(tc,
+		    "(define (f if) (if 1 2))"
+		    "(f (lambda (a b) (+ a b)))",
+		    3);
+}
+
+void TestVm_Vectors(CuTest *tc) {
+  // Fibonacci numbers from a table
+  assert_int_result(tc,
+		    "(define (fib n)"
+		    "  (define v (make-vector (+ n 1) 0))"
+		    "  (define (loop i)"
+		    "    (if (= i (+ n 1)) (vector-ref v n) (step i)))"
+		    "  (define (step i)"
+		    "    (vector-set! v i (+ (vector-ref v (- i 1))"
+		    "                        (vector-ref v (- i 2))))"
+		    "    (loop (+ i 1)))"
+		    "  (vector-set! v 1 1)"
+		    "  (loop 2))"
+		    "(fib 30)",
+		    832040);
+}
+
+void TestVm_Errors(CuTest *tc) {
+  size_t i;
+  int err;
+  struct astnode *ret;
+
+  for (i = 0; i < ntest_modes; i++)
+    {
+      // Wrong number of arguments
+      err = eval_str_in_mode(tc, test_modes[i], "(define (f x) x) (f 1 2)",
+			     &ret);
+      CuAssertIntEquals(tc, EBADMSG, err);
+
+      // Unbound variable
+      err = eval_str_in_mode(tc, test_modes[i], "(define (f) unbound-var) (f)",
+			     &ret);
+      CuAssertIntEquals(tc, EBADMSG, err);
+
+      // A malformed body isn't compiled, and fails like in the AST
+      // interpreter.
+      err = eval_str_in_mode(tc, test_modes[i], "(define (f x) (if x)) (f 1)",
+			     &ret);
+      CuAssertIntEquals(tc, EBADMSG, err);
+    }
+}
+
+CuSuite* VmGetSuite() {
+  CuSuite* suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, TestVm_NullArgs);
+  SUITE_ADD_TEST(suite, TestVm_CompilesTopLevelProcs);
+  SUITE_ADD_TEST(suite, TestVm_Recursion);
+  SUITE_ADD_TEST(suite, TestVm_TailCalls);
+  SUITE_ADD_TEST(suite, TestVm_DeepRecursion);
+  SUITE_ADD_TEST(suite, TestVm_Closures);
+  SUITE_ADD_TEST(suite, TestVm_InternalDefines);
+  SUITE_ADD_TEST(suite, TestVm_QuoteAndPrimitives);
+  SUITE_ADD_TEST(suite, TestVm_ShadowedKeyword);
+  SUITE_ADD_TEST(suite, TestVm_Vectors);
+  SUITE_ADD_TEST(suite, TestVm_Errors);
+
+  return suite;
+}